@@ -9,7 +9,6 @@
 #include <cmath>
 #include <deque>
 #include <limits>
-#include <filesystem>
 #include <libgen.h> // For dirname
 #include <unistd.h> // For readlink
 #include <linux/limits.h> // For PATH_MAX
@@ -18,17 +17,13 @@
 #include "snake.hpp"
 #include "DQNAgent.h"
 #include "mnist_app.h" // Include the new header for MNIST functions
+#include "snake_app.h"
 
 // Forward declarations for snake functions
-void run_snake_training();
+void prompt_snake_training(bool actor_learner);
 void run_snake_visualization();
 void show_menu();
 
-// Helper function for snake distance calculation
-float distance(Position p1, Position p2) {
-    return std::sqrt(std::pow(p1.x - p2.x, 2) + std::pow(p1.y - p2.y, 2));
-}
-
 int main() {
     // Get the path to the executable
     char result[PATH_MAX];
@@ -46,7 +41,7 @@ int main() {
 
 
     int choice = 0;
-    while (choice != 5) {
+    while (choice != 7) {
         show_menu();
         std::cin >> choice;
 
@@ -67,19 +62,25 @@ int main() {
                 run_mnist_testing(mnist_path);
                 break;
             case 3:
-                run_snake_training();
+                prompt_snake_training(false);
                 break;
             case 4:
-                run_snake_visualization();
+                prompt_snake_training(true);
                 break;
             case 5:
+                run_snake_visualization();
+                break;
+            case 6:
+                run_mnist_quantization(mnist_path);
+                break;
+            case 7:
                 std::cout << "Exiting..." << std::endl;
                 break;
             default:
                 std::cout << "Invalid choice. Please try again." << std::endl;
                 break;
         }
-        if (choice != 5) {
+        if (choice != 7) {
             std::cout << "\nPress Enter to continue...";
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
             std::cin.get();
@@ -95,114 +96,42 @@ void show_menu() {
     std::cout << "1. Train MNIST Model\n";
     std::cout << "2. Test MNIST Model\n";
     std::cout << "3. Train Snake Agent\n";
-    std::cout << "4. Visualize Snake Agent\n";
-    std::cout << "5. Exit\n";
+    std::cout << "4. Train Snake Agent (actor-learner, multithreaded)\n";
+    std::cout << "5. Visualize Snake Agent\n";
+    std::cout << "6. Quantize MNIST Model (int8)\n";
+    std::cout << "7. Exit\n";
     std::cout << "Enter your choice: ";
 }
 
-void run_snake_training() {
-    int minutes;
+void prompt_snake_training(bool actor_learner) {
+    SnakeTrainingOptions options;
     std::cout << "Enter number of minutes to train for: ";
-    std::cin >> minutes;
-    if (minutes <= 0) {
+    std::cin >> options.minutes;
+    if (options.minutes <= 0) {
         std::cout << "Invalid duration." << std::endl;
         return;
     }
-    
-    const int BATCH_SIZE = 32;
-    const int STATE_SIZE = 8;
-    const int ACTION_SIZE = 3;
-
-    SnakeConfig config;
-    config.width = 30;
-    config.height = 30;
-    config.initial_length = 5;
-    config.max_steps_without_food = 100;
-
-    SnakeGame game(config);
-    DQNAgent agent(STATE_SIZE, ACTION_SIZE);
-
-    std::deque<int> recent_scores;
-    const int scores_window = 100;
-
-    auto training_start_time = std::chrono::high_resolution_clock::now();
-    auto training_end_time = training_start_time + std::chrono::minutes(minutes);
-    int episode = 0;
-
-    std::cout << "\n--- Snake Training for " << minutes << " minute(s) ---\n" << std::endl;
-
-    while (std::chrono::high_resolution_clock::now() < training_end_time) {
-        episode++;
-        game.reset();
-        auto state = game.get_state<float>();
-        int score_before_move = 0;
 
-        for (int time = 0; time < 5000; ++time) {
-            int action = agent.act(state);
-
-            Position head_before = game.get_head_position();
-            Position food_pos = game.returnFoodPlace();
-            float dist_before = distance(head_before, food_pos);
-            score_before_move = game.returnScore();
-
-            game.update_direction(action);
-            game.update_without_render();
-
-            bool done = game.is_over();
-            auto next_state = game.get_state<float>();
-            int score_after_move = game.returnScore();
-
-            float reward = 0.0f;
-            if (done) {
-                reward = -10.0f;
-            } else if (score_after_move > score_before_move) {
-                reward = 10.0f;
-            } else {
-                Position head_after = game.get_head_position();
-                float dist_after = distance(head_after, food_pos);
-                reward = (dist_after < dist_before) ? 0.1f : -0.2f;
-            }
-
-            agent.remember(state, action, reward, next_state, done);
-            state = next_state;
-
-            if (done) break;
-        }
-
-        agent.replay(BATCH_SIZE);
-
-        recent_scores.push_back(game.returnScore());
-        if (recent_scores.size() > scores_window) {
-            recent_scores.pop_front();
-        }
-        double avg_score = std::accumulate(recent_scores.begin(), recent_scores.end(), 0.0) / recent_scores.size();
-
-        std::cout << "Episode " << std::setw(5) << episode
-                  << " | Score: " << std::setw(3) << game.returnScore()
-                  << " | Avg Score: " << std::fixed << std::setprecision(2) << std::setw(5) << avg_score
-                  << std::endl;
-
-        if (episode % 5 == 0) {
-            agent.update_target_model();
-        }
+    if (!actor_learner) {
+        run_snake_training(options);
+        return;
     }
 
-    std::cout << "\n--- Training Finished ---" << std::endl;
-
-    // Create directory if it doesn't exist
-    std::string weights_dir = "weights";
-    if (!std::filesystem::exists(weights_dir)) {
-        std::filesystem::create_directories(weights_dir);
+    int default_actors = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    std::cout << "Enter number of actor threads (" << default_actors << " recommended): ";
+    std::cin >> options.actors;
+    if (options.actors <= 0) {
+        std::cout << "Invalid number of actors." << std::endl;
+        return;
     }
-
-    agent.save("weights/snake-dqn-final.bin");
+    run_snake_training_async(options);
 }
 
 void run_snake_visualization() {
     std::cout << "\n--- Snake Visualization ---\n" << std::endl;
     const std::string model_path = "weights/snake-dqn-final.bin";
     
-    const int STATE_SIZE = 8;
+    const int STATE_SIZE = SnakeGame::STATE_SIZE;
     const int ACTION_SIZE = 3;
 
     SnakeConfig config;
@@ -217,7 +146,7 @@ void run_snake_visualization() {
         agent.load(model_path);
     } catch (const std::exception& e) {
         std::cerr << "Error loading model: " << e.what() << std::endl;
-        std::cerr << "Please train a model first (Option 3)." << std::endl;
+        std::cerr << "Please train a model first (Option 3 or 4)." << std::endl;
         return;
     }
 
@@ -243,7 +172,7 @@ void run_snake_visualization() {
 
                 game.update_direction(action);
                 game.update();
-                game.draw();
+                SnakeRenderer::draw(game);
 
                 int ch = getch();
                 if (ch == 'q') {
@@ -19,6 +19,7 @@
 #include "Loss.h"
 #include "Optimizer.h"
 #include "Trainer.h"
+#include "Quantization.h"
 
 // Helper function to print a 28x28 MNIST image tensor as ASCII art
 void print_ascii_image(const Tensor& image) {
@@ -70,8 +71,9 @@ void run_mnist_training(const std::string& mnist_path) {
         model.add(std::make_unique<ReLULayer>());
         model.add(std::make_unique<DenseLayer>(84, 10));
         model.add(std::make_unique<SoftmaxLayer>());
+        int fused = model.fuse();
 
-        std::cout << "Model Architecture:" << std::endl;
+        std::cout << "Model Architecture (" << fused << " fused blocks):" << std::endl;
         model.summary();
         std::cout << std::endl;
 
@@ -79,6 +81,19 @@ void run_mnist_training(const std::string& mnist_path) {
         auto optimizer = std::make_unique<Adam>(0.001f);
         Trainer trainer(model, std::move(optimizer), loss_fn);
 
+        CheckpointConfig checkpoint_config;
+        checkpoint_config.directory = "checkpoints/mnist";
+        checkpoint_config.every_n_steps = 200;
+        trainer.enable_checkpointing(checkpoint_config);
+        if (!Checkpoint::list(checkpoint_config.directory, checkpoint_config.prefix).empty()) {
+            char answer = 'n';
+            std::cout << "Resume from the latest checkpoint? (y/n): ";
+            std::cin >> answer;
+            if (answer == 'y' || answer == 'Y') {
+                trainer.resume_from_latest();
+            }
+        }
+
         int batch_size = 64;
 
         std::cout << "Starting training for " << epochs << " epochs..." << std::endl;
@@ -130,7 +145,7 @@ void run_mnist_testing(const std::string& mnist_path) {
 
         model.eval(); // Set model to evaluation mode
 
-        std::mt19937 rng(std::random_device{}());
+        Random::Stream rng = Random::stream("mnist_app");
         char user_choice = 'y';
 
         while (user_choice == 'y' || user_choice == 'Y') {
@@ -216,3 +231,83 @@ void run_mnist_testing(const std::string& mnist_path) {
         std::cerr << "An error occurred during MNIST testing: " << e.what() << std::endl;
     }
 }
+
+// Packs samples [begin, end) of `samples` into one batch tensor
+static Tensor make_batch(const std::vector<Tensor>& samples, size_t begin, size_t end) {
+    std::vector<int> shape = samples[begin].shape;
+    shape[0] = static_cast<int>(end - begin);
+    Tensor batch(shape);
+    size_t sample_size = samples[begin].data.size();
+    for (size_t j = begin; j < end; ++j) {
+        std::copy(samples[j].data.begin(), samples[j].data.end(), batch.data.begin() + (j - begin) * sample_size);
+    }
+    return batch;
+}
+
+void run_mnist_quantization(const std::string& mnist_path) {
+    std::cout << "\n--- MNIST int8 Quantization ---\n" << std::endl;
+    const std::string model_path = "weights/mnist_cnn_model.bin";
+
+    try {
+        Sequential model;
+        model.load_model(model_path);
+        model.eval();
+        std::cout << "Model loaded successfully from " << model_path << std::endl;
+
+        std::cout << "Loading MNIST dataset..." << std::endl;
+        auto X_train = MNISTDataLoader::load_images(mnist_path + "train-images-idx3-ubyte");
+        auto X_test = MNISTDataLoader::load_images(mnist_path + "t10k-images-idx3-ubyte");
+        auto y_test = MNISTDataLoader::load_labels(mnist_path + "t10k-labels-idx1-ubyte");
+        std::cout << "Dataset loaded successfully.\n" << std::endl;
+
+        // Activation ranges come from a few hundred training images
+        const size_t batch_size = 64;
+        const size_t calibration_samples = std::min<size_t>(512, X_train.size());
+        std::vector<Tensor> calibration;
+        for (size_t i = 0; i < calibration_samples; i += batch_size) {
+            calibration.push_back(make_batch(X_train, i, std::min(i + batch_size, calibration_samples)));
+        }
+        QuantizedSequential quantized = QuantizedSequential::quantize(model, calibration);
+        quantized.summary();
+
+        size_t fp32_bytes = 0;
+        for (const auto& layer : model.layers) {
+            for (Tensor* p : layer->parameters()) fp32_bytes += p->data.size() * sizeof(float);
+        }
+
+        int fp32_correct = 0, int8_correct = 0;
+        double fp32_seconds = 0.0, int8_seconds = 0.0;
+        for (size_t i = 0; i < X_test.size(); i += batch_size) {
+            size_t end = std::min(i + batch_size, X_test.size());
+            Tensor X_batch = make_batch(X_test, i, end);
+
+            auto t0 = std::chrono::high_resolution_clock::now();
+            Tensor fp32_pred = model.forward(X_batch);
+            auto t1 = std::chrono::high_resolution_clock::now();
+            Tensor int8_pred = quantized.forward(X_batch);
+            auto t2 = std::chrono::high_resolution_clock::now();
+            fp32_seconds += std::chrono::duration<double>(t1 - t0).count();
+            int8_seconds += std::chrono::duration<double>(t2 - t1).count();
+
+            int classes = fp32_pred.shape[1];
+            for (size_t j = i; j < end; ++j) {
+                const float* label = y_test[j].data.data();
+                int true_idx = std::max_element(label, label + classes) - label;
+                const float* a = fp32_pred.data.data() + (j - i) * classes;
+                const float* b = int8_pred.data.data() + (j - i) * classes;
+                if (std::max_element(a, a + classes) - a == true_idx) fp32_correct++;
+                if (std::max_element(b, b + classes) - b == true_idx) int8_correct++;
+            }
+        }
+
+        double total = static_cast<double>(X_test.size());
+        std::cout << "\n--- Quantization Results ---" << std::endl;
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "Test accuracy:  fp32 " << 100.0 * fp32_correct / total << "%, int8 " << 100.0 * int8_correct / total << "%" << std::endl;
+        std::cout << "Throughput:     fp32 " << total / fp32_seconds << " img/s, int8 " << total / int8_seconds << " img/s" << std::endl;
+        std::cout << "Weight memory:  fp32 " << fp32_bytes << " B, int8 " << quantized.weight_bytes() << " B" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "An error occurred during MNIST quantization: " << e.what() << std::endl;
+    }
+}
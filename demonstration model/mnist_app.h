@@ -2,4 +2,5 @@
 #include <string>
 
 void run_mnist_training(const std::string& mnist_path);
-void run_mnist_testing(const std::string& mnist_path);
\ No newline at end of file
+void run_mnist_testing(const std::string& mnist_path);
+void run_mnist_quantization(const std::string& mnist_path);
\ No newline at end of file
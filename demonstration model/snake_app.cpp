@@ -0,0 +1,283 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <numeric>
+#include <iomanip>
+#include <cmath>
+#include <deque>
+#include <filesystem>
+#include <atomic>
+#include <mutex>
+#include <random>
+
+#include "snake_app.h"
+#include "snake_env.hpp"
+#include "DQNAgent.h"
+
+// Helper function for snake distance calculation
+float distance(Position p1, Position p2) {
+    return std::sqrt(std::pow(p1.x - p2.x, 2) + std::pow(p1.y - p2.y, 2));
+}
+
+// Applies the action to the game and returns the shaped reward for it
+float step_with_reward(SnakeGame& game, int action) {
+    Position food_pos = game.returnFoodPlace();
+    float dist_before = distance(game.get_head_position(), food_pos);
+    int score_before_move = game.returnScore();
+
+    game.update_direction(action);
+    game.update_without_render();
+
+    if (game.is_over()) {
+        return -10.0f;
+    }
+    if (game.returnScore() > score_before_move) {
+        return 10.0f;
+    }
+    float dist_after = distance(game.get_head_position(), food_pos);
+    return (dist_after < dist_before) ? 0.1f : -0.2f;
+}
+
+// Prints how long it took to reach options.target_score
+static void report_target_reached(double target_score, long long env_steps,
+                                  std::chrono::steady_clock::time_point start_time) {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "Target average score " << target_score << " reached after "
+              << env_steps << " env steps in " << std::fixed << std::setprecision(1) << seconds << " s" << std::endl;
+}
+
+// Creates the parent directory if it doesn't exist and saves the agent
+static void save_agent(DQNAgent& agent, const std::string& path) {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty() && !std::filesystem::exists(parent)) {
+        std::filesystem::create_directories(parent);
+    }
+    agent.save(path);
+}
+
+void run_snake_training(const SnakeTrainingOptions& options) {
+    const int minutes = options.minutes;
+
+    const int BATCH_SIZE = 32;
+    const int STATE_SIZE = SnakeGame::STATE_SIZE;
+    const int ACTION_SIZE = 3;
+
+    SnakeConfig config;
+    config.width = 30;
+    config.height = 30;
+    config.initial_length = 5;
+    config.max_steps_without_food = 100;
+
+    SnakeGame game(config);
+    DQNAgent agent(STATE_SIZE, ACTION_SIZE, options.agent);
+    std::vector<float> state(STATE_SIZE), next_state(STATE_SIZE);
+
+    std::deque<int> recent_scores;
+    const int scores_window = 100;
+
+    auto training_start_time = std::chrono::steady_clock::now();
+    auto training_end_time = training_start_time + std::chrono::minutes(minutes);
+    int episode = 0;
+    long long env_steps = 0;
+
+    std::cout << "\n--- Snake Training for " << minutes << " minute(s) ---\n" << std::endl;
+
+    while (std::chrono::steady_clock::now() < training_end_time) {
+        episode++;
+        game.reset();
+        game.get_state(state.data());
+
+        for (int time = 0; time < 5000; ++time) {
+            int action = agent.act(state.data(), state.size());
+            float reward = step_with_reward(game, action);
+            bool done = game.is_over();
+            game.get_state(next_state.data());
+
+            agent.remember(state.data(), action, reward, next_state.data(), done);
+            std::swap(state, next_state);
+            env_steps++;
+
+            if (done) break;
+        }
+        if (!game.is_over()) {
+            agent.end_episode();
+        }
+
+        agent.replay(BATCH_SIZE);
+
+        recent_scores.push_back(game.returnScore());
+        if (recent_scores.size() > scores_window) {
+            recent_scores.pop_front();
+        }
+        double avg_score = std::accumulate(recent_scores.begin(), recent_scores.end(), 0.0) / recent_scores.size();
+
+        std::cout << "Episode " << std::setw(5) << episode
+                  << " | Score: " << std::setw(3) << game.returnScore()
+                  << " | Avg Score: " << std::fixed << std::setprecision(2) << std::setw(5) << avg_score
+                  << std::endl;
+
+        if (episode % 5 == 0) {
+            agent.update_target_model();
+        }
+
+        if (options.target_score > 0 && recent_scores.size() >= scores_window && avg_score >= options.target_score) {
+            report_target_reached(options.target_score, env_steps, training_start_time);
+            break;
+        }
+    }
+
+    std::cout << "\n--- Training Finished ---" << std::endl;
+
+    save_agent(agent, options.output_path);
+}
+
+void run_snake_training_async(const SnakeTrainingOptions& options) {
+    const int minutes = options.minutes;
+    const int num_actors = options.actors;
+
+    const int BATCH_SIZE = 32;
+    const int STATE_SIZE = SnakeGame::STATE_SIZE;
+    const int ACTION_SIZE = 3;
+    const int POLICY_REFRESH_STEPS = 1000;   // env steps between actor policy refreshes
+    const int TARGET_UPDATE_STEPS = 500;     // gradient steps between target network updates
+    const int EPSILON_DECAY_STEPS = 100;     // gradient steps between epsilon decays
+
+    SnakeConfig config;
+    config.width = 30;
+    config.height = 30;
+    config.initial_length = 5;
+    config.max_steps_without_food = 100;
+
+    DQNAgent agent(STATE_SIZE, ACTION_SIZE, options.agent);
+
+    std::atomic<bool> stop{false};
+    std::atomic<long long> env_steps{0};
+    std::atomic<long long> grad_steps{0};
+    std::atomic<int> episodes{0};
+
+    std::mutex scores_mutex;
+    std::deque<int> recent_scores;
+    const int scores_window = 100;
+
+    std::cout << "\n--- Snake Actor-Learner Training for " << minutes << " minute(s), "
+              << num_actors << " actor(s) + 1 learner ---\n" << std::endl;
+
+    std::vector<std::thread> actors;
+    for (int a = 0; a < num_actors; ++a) {
+        actors.emplace_back([&, a]() {
+            // Streams by actor index: thread start order does not matter
+            SnakeGame game(config, Random::stream("SnakeGame/actor", a));
+            DQNActor actor(agent, a);
+            std::vector<float> state(STATE_SIZE), next_state(STATE_SIZE);
+            int steps_since_refresh = 0;
+
+            while (!stop.load(std::memory_order_relaxed)) {
+                game.reset();
+                game.get_state(state.data());
+                int steps = 0;
+
+                while (steps < 5000 && !stop.load(std::memory_order_relaxed)) {
+                    int action = actor.act(state.data(), state.size());
+                    float reward = step_with_reward(game, action);
+                    bool done = game.is_over();
+                    game.get_state(next_state.data());
+
+                    actor.remember(state.data(), action, reward, next_state.data(), done);
+                    std::swap(state, next_state);
+                    steps++;
+
+                    if (++steps_since_refresh >= POLICY_REFRESH_STEPS) {
+                        actor.refresh_policy();
+                        steps_since_refresh = 0;
+                    }
+                    if (done) break;
+                }
+                if (!game.is_over()) {
+                    actor.end_episode();
+                }
+
+                env_steps.fetch_add(steps, std::memory_order_relaxed);
+                episodes.fetch_add(1, std::memory_order_relaxed);
+
+                std::lock_guard<std::mutex> lock(scores_mutex);
+                recent_scores.push_back(game.returnScore());
+                if (recent_scores.size() > scores_window) {
+                    recent_scores.pop_front();
+                }
+            }
+        });
+    }
+
+    std::thread learner([&]() {
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (!agent.train_step(BATCH_SIZE)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            long long done_steps = grad_steps.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (done_steps % TARGET_UPDATE_STEPS == 0) {
+                agent.update_target_model();
+            }
+            // Exploration follows learning progress, not the number of
+            // actors: it does not decay before the first gradient step
+            if (done_steps % EPSILON_DECAY_STEPS == 0) {
+                agent.decay_epsilon();
+            }
+        }
+    });
+
+    auto training_start_time = std::chrono::steady_clock::now();
+    auto training_end_time = training_start_time + std::chrono::minutes(minutes);
+    auto last_report_time = training_start_time;
+    long long last_env_steps = 0;
+    long long last_grad_steps = 0;
+
+    while (std::chrono::steady_clock::now() < training_end_time) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - last_report_time).count();
+        long long env_now = env_steps.load(std::memory_order_relaxed);
+        long long grad_now = grad_steps.load(std::memory_order_relaxed);
+
+        double avg_score = 0.0;
+        bool window_full = false;
+        {
+            std::lock_guard<std::mutex> lock(scores_mutex);
+            if (!recent_scores.empty()) {
+                avg_score = std::accumulate(recent_scores.begin(), recent_scores.end(), 0.0) / recent_scores.size();
+            }
+            window_full = recent_scores.size() >= scores_window;
+        }
+
+        std::cout << "Episodes " << std::setw(6) << episodes.load(std::memory_order_relaxed)
+                  << " | Env steps/s: " << std::setw(8) << static_cast<long long>((env_now - last_env_steps) / elapsed)
+                  << " | Grad steps/s: " << std::setw(6) << static_cast<long long>((grad_now - last_grad_steps) / elapsed)
+                  << " | Epsilon: " << std::fixed << std::setprecision(3) << agent.get_epsilon()
+                  << " | Avg Score: " << std::setprecision(2) << std::setw(5) << avg_score
+                  << std::endl;
+
+        last_report_time = now;
+        last_env_steps = env_now;
+        last_grad_steps = grad_now;
+
+        if (options.target_score > 0 && window_full && avg_score >= options.target_score) {
+            report_target_reached(options.target_score, env_now, training_start_time);
+            break;
+        }
+    }
+
+    stop = true;
+    for (auto& actor : actors) actor.join();
+    learner.join();
+
+    double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - training_start_time).count();
+    std::cout << "\n--- Training Finished ---" << std::endl;
+    std::cout << "Env steps: " << env_steps.load() << " (" << static_cast<long long>(env_steps.load() / total_seconds) << "/s)"
+              << " | Grad steps: " << grad_steps.load() << " (" << static_cast<long long>(grad_steps.load() / total_seconds) << "/s)"
+              << std::endl;
+
+    save_agent(agent, options.output_path);
+}
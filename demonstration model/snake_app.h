@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include "DQNAgent.h"
+
+class SnakeGame;
+
+struct SnakeTrainingOptions {
+    int minutes = 1;
+    int actors = 1;   // actor threads, used by run_snake_training_async only
+    std::string output_path = "weights/snake-dqn-final.bin";
+    DQNConfig agent;
+    // Stop early once the average score over the last 100 episodes reaches
+    // this value (<= 0 disables); env steps and time to reach it are reported
+    double target_score = 0.0;
+};
+
+// Applies the action to the game and returns the shaped reward for it
+float step_with_reward(SnakeGame& game, int action);
+
+// Single-threaded training: episodes and replay alternate on one thread
+void run_snake_training(const SnakeTrainingOptions& options);
+
+// Actor-learner training: options.actors game threads feed one learner thread
+void run_snake_training_async(const SnakeTrainingOptions& options);
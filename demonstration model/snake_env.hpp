@@ -0,0 +1,361 @@
+#pragma once
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <functional>
+#include "Random.h"
+
+struct Position {
+    int x, y;
+    Position(int col = 0, int row = 0) : x(col), y(row) {}
+    bool operator==(const Position& other) const {
+        return x == other.x && y == other.y;
+    }
+};
+
+struct SnakeConfig {
+    int width = 30;
+    int height = 30;
+    int initial_length = 15;
+    int max_steps = 1000000000;
+    int max_steps_without_food = 300000;
+    char head_char = '@';
+    char body_char = 'O';
+    char food_char = 'F';
+    char wall_char = '#';
+    int food_score = 1;
+    unsigned int seed = 0;   // food placement; 0 uses the stream passed to SnakeGame
+    std::function<void()> on_game_over = [](){};
+    std::function<void(int)> on_score_change = [](int){};
+};
+
+class SnakeGame {
+public:
+    static constexpr int STATE_SIZE = 8;
+
+private:
+    SnakeConfig config;
+    Position food;
+    std::deque<Position> snake;
+    int direction; 
+    int steps_without_food{0};
+    bool game_over;
+    int score;
+    Random::Stream gen;
+    int step_count;
+
+    // Occupancy grid of the snake body (width*height, row-major) kept in sync
+    // with every push_front/pop_back, so collision checks are O(1).
+    std::vector<unsigned char> occupied;
+    // Interior cells not covered by the snake; free_slot maps a cell to its
+    // position in free_cells (-1 if occupied) for O(1) removal.
+    std::vector<int> free_cells;
+    std::vector<int> free_slot;
+
+    int cell_index(const Position& p) const { return p.y * config.width + p.x; }
+
+    bool inside(const Position& p) const {
+        return p.x >= 0 && p.x < config.width && p.y >= 0 && p.y < config.height;
+    }
+
+    bool is_interior(const Position& p) const {
+        return p.x > 0 && p.x < config.width - 1 && p.y > 0 && p.y < config.height - 1;
+    }
+
+    bool is_occupied(const Position& p) const {
+        return inside(p) && occupied[cell_index(p)];
+    }
+
+    void occupy(const Position& p) {
+        if (!inside(p)) return;
+        int idx = cell_index(p);
+        occupied[idx] = 1;
+        int slot = free_slot[idx];
+        if (slot < 0) return;
+        int last = free_cells.back();
+        free_cells[slot] = last;
+        free_slot[last] = slot;
+        free_cells.pop_back();
+        free_slot[idx] = -1;
+    }
+
+    void vacate(const Position& p) {
+        if (!inside(p)) return;
+        int idx = cell_index(p);
+        occupied[idx] = 0;
+        if (is_interior(p) && free_slot[idx] < 0) {
+            free_slot[idx] = static_cast<int>(free_cells.size());
+            free_cells.push_back(idx);
+        }
+    }
+
+    void push_head(const Position& head) {
+        snake.push_front(head);
+        occupy(head);
+    }
+
+    void pop_tail() {
+        vacate(snake.back());
+        snake.pop_back();
+    }
+
+    void build_snake() {
+        snake.clear();
+        occupied.assign(config.width * config.height, 0);
+        free_slot.assign(config.width * config.height, -1);
+        free_cells.clear();
+        for (int y = 1; y < config.height - 1; ++y) {
+            for (int x = 1; x < config.width - 1; ++x) {
+                int idx = y * config.width + x;
+                free_slot[idx] = static_cast<int>(free_cells.size());
+                free_cells.push_back(idx);
+            }
+        }
+
+        int start_x = config.width / 2;
+        int start_y = config.height / 2;
+        for (int i = 0; i < config.initial_length; ++i) {
+            snake.emplace_back(start_x - i, start_y);
+            occupy(snake.back());
+        }
+    }
+
+    void place_food() {
+        if (free_cells.empty()) {
+            game_over = true;
+            config.on_game_over();
+            return;
+        }
+        std::uniform_int_distribution<int> dist(0, static_cast<int>(free_cells.size()) - 1);
+        int idx = free_cells[dist(gen)];
+        food.x = idx % config.width;
+        food.y = idx / config.width;
+    }
+
+public:
+    void update_without_render() {
+        steps_without_food++; 
+        step_count++;
+        if (step_count > config.max_steps) {
+            game_over = true;
+            config.on_game_over();
+            return;
+        }
+        
+        Position head = snake.front();
+        switch (direction) {
+            case 0: head.y--; break;
+            case 1: head.x++; break;
+            case 2: head.y++; break;
+            case 3: head.x--; break;
+        }
+        
+        if (head.x <= 0 || head.x >= config.width-1 || 
+            head.y <= 0 || head.y >= config.height-1) {
+            game_over = true;
+            config.on_game_over();
+            return;
+        }
+        
+        if (is_occupied(head)) {
+            game_over = true;
+            config.on_game_over();
+            return;
+        }
+
+        push_head(head);
+        if (steps_without_food >= config.max_steps_without_food) {
+            game_over = true;
+            config.on_game_over();
+            return;
+    }
+
+        if (head == food) {
+            steps_without_food = 0;
+            score += config.food_score;
+            config.on_score_change(score);
+            place_food();
+        } else {
+            pop_tail();
+        }
+    }
+    SnakeGame(const SnakeConfig& cfg = {}, Random::Stream stream = Random::stream("SnakeGame"))
+        : config(cfg),
+          food(0, 0), 
+          direction(1), 
+          game_over(false), 
+          score(0),
+          gen(cfg.seed ? Random::seeded(cfg.seed) : stream),
+          step_count(0) {
+        
+        if (config.width < 5 || config.height < 5) {
+            throw std::invalid_argument("Game area too small (minimum 5x5)");
+        }
+
+        build_snake();
+        place_food();
+    }
+
+    int returnScore() const {
+        return score;
+    }
+
+    Position returnFoodPlace() const {
+        return food;
+    }
+
+    void update_direction(int action) {
+        if (action == 1) {
+            direction = (direction + 1) % 4;
+        } else if (action == 2) {
+            direction = (direction + 3) % 4;
+        }
+    }
+
+    template<typename T>
+    std::vector<T> get_state() const {
+        std::vector<T> state(STATE_SIZE);
+        get_state(state.data());
+        return state;
+    }
+
+    // Writes the STATE_SIZE state features into `state` without allocating
+    template<typename T>
+    void get_state(T* state) const {
+        Position head = snake.front();
+
+        int dx_current, dy_current;
+        switch (direction) {
+            case 0: dx_current = 0; dy_current = -1; break;
+            case 1: dx_current = 1; dy_current = 0; break;
+            case 2: dx_current = 0; dy_current = 1; break;
+            case 3: dx_current = -1; dy_current = 0; break;
+            default: dx_current = 0; dy_current = 0; break;
+        }
+
+        auto get_distance = [&](int dx, int dy) -> T {
+            if (dx == 0 && dy == 0) return T(0);
+            
+            Position pos = head;
+            int steps = 0;
+            while (true) {
+                pos.x += dx;
+                pos.y += dy;
+                steps++;
+                
+                if (pos.x < 0 || pos.x >= config.width || 
+                    pos.y < 0 || pos.y >= config.height) {
+                    break;
+                }
+                
+                if (occupied[cell_index(pos)]) break;
+            }
+            
+            return T(1) / T(steps);
+        };
+
+        state[0] = get_distance(dx_current, dy_current);
+        state[1] = get_distance(dy_current, -dx_current);
+        state[2] = get_distance(-dy_current, dx_current);
+
+        state[3] = static_cast<T>(food.x - head.x) / (config.width - 2);
+        state[4] = static_cast<T>(food.y - head.y) / (config.height - 2);
+        
+        state[5] = static_cast<T>(dx_current);
+        state[6] = static_cast<T>(dy_current);
+        
+        state[7] = static_cast<T>(snake.size() - config.initial_length) / 
+                  ((config.width-2)*(config.height-2) - config.initial_length);
+    }
+
+    void update() {
+        Position head = snake.front();
+        steps_without_food++; 
+        step_count++;
+        switch (direction) {
+            case 0: head.y--; break;
+            case 1: head.x++; break;
+            case 2: head.y++; break;
+            case 3: head.x--; break;
+        }
+        
+        if (head.x <= 0 || head.x >= config.width-1 || 
+            head.y <= 0 || head.y >= config.height-1) {
+            game_over = true;
+            config.on_game_over();
+            return;
+        }
+        
+        if (is_occupied(head)) {
+            game_over = true;
+            config.on_game_over();
+            return;
+        }
+
+        push_head(head);
+
+        if (head == food) {
+            score += config.food_score;
+            config.on_score_change(score);
+            place_food();
+        } else {
+            pop_tail();
+        }
+
+        if (steps_without_food >= config.max_steps_without_food) {
+            game_over = true;
+            config.on_game_over();
+            return;
+         }
+    }
+
+    bool is_over() const {
+        return game_over;
+    }
+
+    // Ends the episode immediately (e.g. the player quit)
+    void stop() {
+        game_over = true;
+    }
+
+    // Sets an absolute direction (0 up, 1 right, 2 down, 3 left); reversing
+    // straight into the body is ignored.
+    void steer(int new_direction) {
+        if ((new_direction + 2) % 4 != direction) {
+            direction = new_direction;
+        }
+    }
+
+    const SnakeConfig& get_config() const {
+        return config;
+    }
+
+    const std::deque<Position>& get_body() const {
+        return snake;
+    }
+
+    int get_step_count() const {
+        return step_count;
+    }
+
+    Position get_head_position() const {
+        return snake.front();
+    }
+
+    void reset() {
+        build_snake();
+        
+        direction = 1;
+        score = 0;
+        steps_without_food = 0;
+        step_count = 0;
+        game_over = false;
+        
+        place_food();
+        config.on_score_change(score);
+    }
+};
+
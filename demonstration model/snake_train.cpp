@@ -0,0 +1,77 @@
+// Headless snake DQN training: no ncurses, no interactive menu.
+// Usage: snake_train [--minutes N] [--actors N] [--output PATH] [--n-step N]
+//                    [--double-dqn 0|1] [--target-score X] [--seed N]
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include "snake_app.h"
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --minutes N    training duration in minutes (default 1)\n"
+              << "  --actors N     actor threads; 0 trains single-threaded (default 0)\n"
+              << "  --output PATH  where to save the trained agent (default weights/snake-dqn-final.bin)\n"
+              << "  --n-step N     n-step return length (default 3)\n"
+              << "  --double-dqn B 1 selects next actions with the online net, 0 uses plain max-Q (default 1)\n"
+              << "  --target-score X  stop once the 100-episode average score reaches X\n"
+              << "  --seed N       seed of weights, exploration and food (default: EDUNET_SEED or random)\n"
+              << "  --help         show this message\n";
+}
+
+int main(int argc, char** argv) {
+    SnakeTrainingOptions options;
+    options.actors = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next_value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        try {
+            if (arg == "--minutes") {
+                options.minutes = std::stoi(next_value());
+            } else if (arg == "--actors") {
+                options.actors = std::stoi(next_value());
+            } else if (arg == "--output") {
+                options.output_path = next_value();
+            } else if (arg == "--n-step") {
+                options.agent.n_step = std::stoi(next_value());
+            } else if (arg == "--double-dqn") {
+                options.agent.double_dqn = std::stoi(next_value()) != 0;
+            } else if (arg == "--target-score") {
+                options.target_score = std::stod(next_value());
+            } else if (arg == "--seed") {
+                Random::seed(std::stoull(next_value()));
+            } else if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return 0;
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                print_usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.minutes <= 0 || options.actors < 0 || options.agent.n_step <= 0) {
+        std::cerr << "--minutes and --n-step must be positive and --actors non-negative" << std::endl;
+        return 1;
+    }
+
+    if (options.actors == 0) {
+        run_snake_training(options);
+    } else {
+        run_snake_training_async(options);
+    }
+    return 0;
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include "Layer.h"
+#include <vector>
+#include <fstream>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Mean of every pool_size x pool_size window. Each output row first sums
+// its pool_size input rows over their whole width (contiguous adds that
+// vectorize), then adds the columns of every window; for 2x2 windows with
+// stride 2 that is one AVX2 hadd per eight outputs. Backward spreads each
+// gradient evenly over its window the same way round: one expanded row per
+// output row, added to its pool_size input rows. Only the input shape is
+// kept for backward.
+class AveragePooling2DLayer : public Layer {
+private:
+    int pool_size = 0;
+    int stride = 0;
+    std::vector<int> last_input_shape;
+    std::vector<float> row;    // column sums in forward, the expanded gradient in backward
+
+public:
+    AveragePooling2DLayer(int p_size, int s = -1) : pool_size(p_size) {
+        this->stride = (s == -1) ? pool_size : s;
+    }
+    AveragePooling2DLayer() = default;
+
+    Tensor forward(const Tensor& input) override {
+        Tensor output;
+        forward_into(input, output);
+        last_input_shape = input.shape;
+        return output;
+    }
+
+    void forward_into(const Tensor& input, Tensor& output) override {
+        if (input.shape.size() != 4 || input.shape[2] < pool_size || input.shape[3] < pool_size) {
+            throw std::runtime_error("AveragePooling2DLayer expects an N x C x H x W input of at least the pool size");
+        }
+        const int N = input.shape[0], C = input.shape[1], H_in = input.shape[2], W_in = input.shape[3];
+        const int H_out = (H_in - pool_size) / stride + 1;
+        const int W_out = (W_in - pool_size) / stride + 1;
+        output.resize({N, C, H_out, W_out});
+        const float scale = 1.0f / (pool_size * pool_size);
+        row.resize(W_in);
+        float* sums = row.data();
+        for (size_t plane = 0; plane < static_cast<size_t>(N) * C; ++plane) {
+            const float* x = input.data.data() + plane * H_in * W_in;
+            float* y = output.data.data() + plane * H_out * W_out;
+            for (int h = 0; h < H_out; ++h) {
+                const float* first = x + static_cast<size_t>(h) * stride * W_in;
+                std::copy(first, first + W_in, sums);
+                for (int ph = 1; ph < pool_size; ++ph) {
+                    const float* r = first + static_cast<size_t>(ph) * W_in;
+                    for (int i = 0; i < W_in; ++i) sums[i] += r[i];
+                }
+                pool_row(sums, y + static_cast<size_t>(h) * W_out, W_out, scale);
+            }
+        }
+    }
+
+    Tensor backward(const Tensor& output_gradient) override {
+        if (last_input_shape.size() != 4) {
+            throw std::runtime_error("AveragePooling2DLayer::backward called without a forward pass");
+        }
+        const int N = last_input_shape[0], C = last_input_shape[1], H_in = last_input_shape[2], W_in = last_input_shape[3];
+        const int H_out = (H_in - pool_size) / stride + 1;
+        const int W_out = (W_in - pool_size) / stride + 1;
+        if (output_gradient.shape != std::vector<int>{N, C, H_out, W_out}) {
+            throw std::runtime_error("AveragePooling2DLayer::backward: gradient shape does not match the last forward pass");
+        }
+        Tensor input_gradient(last_input_shape);
+        const float scale = 1.0f / (pool_size * pool_size);
+        row.resize(W_in);
+        float* expanded = row.data();
+        for (size_t plane = 0; plane < static_cast<size_t>(N) * C; ++plane) {
+            const float* g = output_gradient.data.data() + plane * H_out * W_out;
+            float* dx = input_gradient.data.data() + plane * H_in * W_in;
+            for (int h = 0; h < H_out; ++h) {
+                expand_row(g + static_cast<size_t>(h) * W_out, expanded, W_out, W_in, scale);
+                for (int ph = 0; ph < pool_size; ++ph) {
+                    float* dst = dx + (static_cast<size_t>(h) * stride + ph) * W_in;
+                    for (int i = 0; i < W_in; ++i) dst[i] += expanded[i];
+                }
+            }
+        }
+        return input_gradient;
+    }
+
+    std::unique_ptr<Layer> clone() const override { return std::make_unique<AveragePooling2DLayer>(*this); }
+
+    double forward_flops(const std::vector<int>& input_shape, const std::vector<int>& output_shape) const override {
+        return Layer::forward_flops(input_shape, output_shape) * pool_size * pool_size;
+    }
+
+    void save_weights(const std::string& filename) const override {
+        std::ofstream file(filename + "_avgpool.meta");
+        file << pool_size << " " << stride;
+        file.close();
+    }
+
+    void load_weights(const std::string& filename) override {
+        std::ifstream file(filename + "_avgpool.meta");
+        if (!file) throw std::runtime_error("Cannot open meta file: " + filename + "_avgpool.meta");
+        file >> pool_size >> stride;
+        file.close();
+    }
+
+    std::string get_layer_type() const override { return "AveragePooling2DLayer"; }
+
+    std::string get_config_string() const override { return get_weights_string(); }
+
+    void set_config_from_string(const std::string& config) override {
+        pool_size = std::stoi(config_value(config, "pool_size"));
+        stride = std::stoi(config_value(config, "stride"));
+    }
+
+    std::string get_weights_string() const override {
+        return "pool_size:" + std::to_string(pool_size) + ";stride:" + std::to_string(stride);
+    }
+
+    void set_weights_from_string(const std::string& data) override { set_config_from_string(data); }
+
+private:
+    // out[w] = scale * (sums[w * stride] + ... + sums[w * stride + pool_size - 1])
+    void pool_row(const float* sums, float* out, int W_out, float scale) const {
+        int w = 0;
+#if defined(__AVX2__)
+        if (pool_size == 2 && stride == 2) {
+            const __m256 vscale = _mm256_set1_ps(scale);
+            for (; w + 8 <= W_out; w += 8) {
+                // hadd pairs within 128-bit lanes: a01 a23 b01 b23 | a45 a67 b45 b67
+                __m256 pairs = _mm256_hadd_ps(_mm256_loadu_ps(sums + 2 * w), _mm256_loadu_ps(sums + 2 * w + 8));
+                pairs = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(pairs), 0xD8));
+                _mm256_storeu_ps(out + w, _mm256_mul_ps(pairs, vscale));
+            }
+        }
+#endif
+        for (; w < W_out; ++w) {
+            float sum = 0.0f;
+            for (int pw = 0; pw < pool_size; ++pw) sum += sums[w * stride + pw];
+            out[w] = sum * scale;
+        }
+    }
+
+    // expanded[w * stride + pw] gets scale * g[w] from every window covering
+    // it; columns past the last window stay 0
+    void expand_row(const float* g, float* expanded, int W_out, int W_in, float scale) const {
+        std::fill(expanded, expanded + W_in, 0.0f);
+        int w = 0;
+#if defined(__AVX2__)
+        if (pool_size == 2 && stride == 2) {
+            const __m256 vscale = _mm256_set1_ps(scale);
+            for (; w + 8 <= W_out; w += 8) {
+                __m256 v = _mm256_mul_ps(_mm256_loadu_ps(g + w), vscale);
+                __m256 lo = _mm256_unpacklo_ps(v, v);    // v0 v0 v1 v1 | v4 v4 v5 v5
+                __m256 hi = _mm256_unpackhi_ps(v, v);    // v2 v2 v3 v3 | v6 v6 v7 v7
+                _mm256_storeu_ps(expanded + 2 * w, _mm256_permute2f128_ps(lo, hi, 0x20));
+                _mm256_storeu_ps(expanded + 2 * w + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+            }
+        }
+#endif
+        for (; w < W_out; ++w) {
+            const float v = g[w] * scale;
+            for (int pw = 0; pw < pool_size; ++pw) expanded[w * stride + pw] += v;
+        }
+    }
+};
@@ -0,0 +1,315 @@
+#pragma once
+#include "Layer.h"
+#include "VectorOps.h"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// Batch normalization over axis 1: per feature of an {N, F} input, per
+// channel (over N, H and W) of an {N, C, H, W} input. In training the batch
+// statistics normalize the input and update running averages (weighted by
+// `momentum`, unbiased variance); eval mode normalizes with the running
+// averages, i.e. y = x * scale + shift per channel. Sequential's
+// fold_batch_norm() merges that into a preceding Dense or (grouped)
+// convolution layer.
+//
+// parameters() ends with the running mean and variance so that they are
+// saved with the model; gradients() covers only gamma and beta, the
+// parameters the optimizers train.
+class BatchNormLayer : public Layer {
+public:
+    Tensor gamma;
+    Tensor beta;
+    Tensor grad_gamma;
+    Tensor grad_beta;
+    Tensor running_mean;
+    Tensor running_var;
+
+private:
+    int channels = 0;
+    float momentum = 0.1f;
+    float epsilon = 1e-5f;
+    bool is_training = true;
+    bool recomputing = false;
+    Tensor x_hat;                  // normalized input of the last training forward
+    std::vector<float> inv_std;    // per channel, of the same pass
+
+public:
+    BatchNormLayer(int num_channels, float running_momentum = 0.1f, float eps = 1e-5f)
+        : channels(num_channels), momentum(running_momentum), epsilon(eps) {
+        allocate();
+    }
+    BatchNormLayer() = default;
+
+    void train() override { is_training = true; }
+    void eval() override { is_training = false; }
+    void set_recomputing(bool on) override { recomputing = on; }
+
+    Tensor forward(const Tensor& input) override {
+        if (!is_training) {
+            Tensor output;
+            forward_into(input, output);
+            return output;
+        }
+        check_input(input);
+        const int N = input.shape[0];
+        const size_t inner = inner_size(input.shape);
+        const double count = static_cast<double>(N) * inner;
+        const float* x = input.data.data();
+
+        // Two passes over the batch: mean, then the squared deviations
+        std::vector<double> mean(channels, 0.0), var(channels, 0.0);
+        for (int n = 0; n < N; ++n) {
+            const float* row = x + static_cast<size_t>(n) * channels * inner;
+            if (inner == 1) {
+                for (int c = 0; c < channels; ++c) mean[c] += row[c];
+            } else {
+                for (int c = 0; c < channels; ++c) mean[c] += VectorOps::sum(row + c * inner, inner);
+            }
+        }
+        for (int c = 0; c < channels; ++c) mean[c] /= count;
+        for (int n = 0; n < N; ++n) {
+            const float* row = x + static_cast<size_t>(n) * channels * inner;
+            if (inner == 1) {
+                for (int c = 0; c < channels; ++c) var[c] += (row[c] - mean[c]) * (row[c] - mean[c]);
+            } else {
+                for (int c = 0; c < channels; ++c) var[c] += VectorOps::squared_deviation(row + c * inner, inner, static_cast<float>(mean[c]));
+            }
+        }
+
+        inv_std.resize(channels);
+        std::vector<float> mean_f(channels), scale(channels);
+        for (int c = 0; c < channels; ++c) {
+            var[c] /= count;
+            mean_f[c] = static_cast<float>(mean[c]);
+            inv_std[c] = static_cast<float>(1.0 / std::sqrt(var[c] + epsilon));
+            scale[c] = gamma.data[c];
+        }
+        // A recomputed pass (gradient checkpointing) sees the same batch again
+        if (!recomputing) {
+            const double unbiased = count > 1 ? count / (count - 1) : 1.0;
+            for (int c = 0; c < channels; ++c) {
+                running_mean.data[c] = (1.0f - momentum) * running_mean.data[c] + momentum * mean_f[c];
+                running_var.data[c] = (1.0f - momentum) * running_var.data[c] + momentum * static_cast<float>(var[c] * unbiased);
+            }
+        }
+
+        x_hat.resize(input.shape);
+        Tensor output(input.shape);
+        float* xh = x_hat.data.data();
+        float* y = output.data.data();
+        for (int n = 0; n < N; ++n) {
+            const size_t base = static_cast<size_t>(n) * channels * inner;
+            if (inner == 1) {
+                for (int c = 0; c < channels; ++c) {
+                    const float v = (x[base + c] - mean_f[c]) * inv_std[c];
+                    xh[base + c] = v;
+                    y[base + c] = v * scale[c] + beta.data[c];
+                }
+                continue;
+            }
+            for (int c = 0; c < channels; ++c) {
+                const size_t off = base + c * inner;
+                const float m = mean_f[c], s = inv_std[c], g = scale[c], b = beta.data[c];
+                for (size_t i = 0; i < inner; ++i) {
+                    const float v = (x[off + i] - m) * s;
+                    xh[off + i] = v;
+                    y[off + i] = v * g + b;
+                }
+            }
+        }
+        return output;
+    }
+
+    // Eval mode: the running statistics as a per-channel scale and shift
+    void forward_into(const Tensor& input, Tensor& output) override {
+        if (is_training) {
+            output = forward(input);
+            return;
+        }
+        check_input(input);
+        std::vector<float> scale, shift;
+        folded_scale_shift(scale, shift);
+        const int N = input.shape[0];
+        const size_t inner = inner_size(input.shape);
+        output.resize(input.shape);
+        const float* x = input.data.data();
+        float* y = output.data.data();
+        for (int n = 0; n < N; ++n) {
+            const size_t base = static_cast<size_t>(n) * channels * inner;
+            if (inner == 1) {
+                for (int c = 0; c < channels; ++c) y[base + c] = x[base + c] * scale[c] + shift[c];
+                continue;
+            }
+            for (int c = 0; c < channels; ++c) {
+                const size_t off = base + c * inner;
+                for (size_t i = 0; i < inner; ++i) y[off + i] = x[off + i] * scale[c] + shift[c];
+            }
+        }
+    }
+
+    Tensor backward(const Tensor& output_gradient) override {
+        if (output_gradient.shape != x_hat.shape) {
+            throw std::runtime_error("BatchNormLayer::backward: gradient shape does not match the last training forward pass");
+        }
+        const int N = output_gradient.shape[0];
+        const size_t inner = inner_size(output_gradient.shape);
+        const double count = static_cast<double>(N) * inner;
+        const float* dy = output_gradient.data.data();
+        const float* xh = x_hat.data.data();
+
+        std::vector<double> dbeta(channels, 0.0), dgamma(channels, 0.0);
+        for (int n = 0; n < N; ++n) {
+            const size_t base = static_cast<size_t>(n) * channels * inner;
+            if (inner == 1) {
+                for (int c = 0; c < channels; ++c) {
+                    dbeta[c] += dy[base + c];
+                    dgamma[c] += dy[base + c] * xh[base + c];
+                }
+            } else {
+                for (int c = 0; c < channels; ++c) {
+                    dbeta[c] += VectorOps::sum(dy + base + c * inner, inner);
+                    dgamma[c] += VectorOps::dot(dy + base + c * inner, xh + base + c * inner, inner);
+                }
+            }
+        }
+        start_gradient(grad_gamma, gamma.shape);
+        start_gradient(grad_beta, beta.shape);
+        for (int c = 0; c < channels; ++c) {
+            grad_gamma.data[c] += static_cast<float>(dgamma[c]);
+            grad_beta.data[c] += static_cast<float>(dbeta[c]);
+        }
+
+        // dx = gamma / std * (dy - mean(dy) - x_hat * mean(dy * x_hat))
+        Tensor input_gradient(output_gradient.shape);
+        float* dx = input_gradient.data.data();
+        std::vector<float> k(channels), mean_dy(channels), mean_dyxh(channels);
+        for (int c = 0; c < channels; ++c) {
+            k[c] = gamma.data[c] * inv_std[c];
+            mean_dy[c] = static_cast<float>(dbeta[c] / count);
+            mean_dyxh[c] = static_cast<float>(dgamma[c] / count);
+        }
+        for (int n = 0; n < N; ++n) {
+            const size_t base = static_cast<size_t>(n) * channels * inner;
+            if (inner == 1) {
+                for (int c = 0; c < channels; ++c) {
+                    dx[base + c] = k[c] * (dy[base + c] - mean_dy[c] - xh[base + c] * mean_dyxh[c]);
+                }
+                continue;
+            }
+            for (int c = 0; c < channels; ++c) {
+                const size_t off = base + c * inner;
+                for (size_t i = 0; i < inner; ++i) {
+                    dx[off + i] = k[c] * (dy[off + i] - mean_dy[c] - xh[off + i] * mean_dyxh[c]);
+                }
+            }
+        }
+        return input_gradient;
+    }
+
+    // The eval-mode transform y = x * scale + shift of every channel
+    void folded_scale_shift(std::vector<float>& scale, std::vector<float>& shift) const {
+        scale.resize(channels);
+        shift.resize(channels);
+        for (int c = 0; c < channels; ++c) {
+            scale[c] = gamma.data[c] / std::sqrt(running_var.data[c] + epsilon);
+            shift[c] = beta.data[c] - running_mean.data[c] * scale[c];
+        }
+    }
+
+    int get_channels() const { return channels; }
+
+    std::unique_ptr<Layer> clone() const override { return std::make_unique<BatchNormLayer>(*this); }
+
+    size_t activation_bytes() const override { return x_hat.data.size() * sizeof(float); }
+
+    void release_activations() override { x_hat = Tensor(); }
+
+    double forward_flops(const std::vector<int>& input_shape, const std::vector<int>& output_shape) const override {
+        (void)output_shape;
+        double n = 1.0;
+        for (int d : input_shape) n *= d;
+        return (is_training ? 7.0 : 2.0) * n;
+    }
+
+    void save_weights(const std::string& filename) const override {
+        std::ofstream meta_file(filename + "_batchnorm.meta");
+        meta_file << channels << " " << momentum << " " << epsilon;
+        meta_file.close();
+        gamma.save_to_file(filename + "_gamma.bin");
+        beta.save_to_file(filename + "_beta.bin");
+        running_mean.save_to_file(filename + "_running_mean.bin");
+        running_var.save_to_file(filename + "_running_var.bin");
+    }
+
+    void load_weights(const std::string& filename) override {
+        std::ifstream meta_file(filename + "_batchnorm.meta");
+        if (!meta_file) throw std::runtime_error("Cannot open meta file: " + filename + "_batchnorm.meta");
+        meta_file >> channels >> momentum >> epsilon;
+        meta_file.close();
+        allocate();
+        gamma.load_from_file(filename + "_gamma.bin");
+        beta.load_from_file(filename + "_beta.bin");
+        running_mean.load_from_file(filename + "_running_mean.bin");
+        running_var.load_from_file(filename + "_running_var.bin");
+    }
+
+    std::string get_layer_type() const override { return "BatchNormLayer"; }
+
+    std::string get_config_string() const override {
+        std::ostringstream ss;
+        ss.precision(9);
+        ss << "channels:" << channels << ";momentum:" << momentum << ";epsilon:" << epsilon;
+        return ss.str();
+    }
+
+    void set_config_from_string(const std::string& config) override {
+        channels = std::stoi(config_value(config, "channels"));
+        momentum = std::stof(config_value(config, "momentum"));
+        epsilon = std::stof(config_value(config, "epsilon"));
+        allocate();
+    }
+
+    std::vector<Tensor*> parameters() override { return {&gamma, &beta, &running_mean, &running_var}; }
+    std::vector<Tensor*> gradients() override { return {&grad_gamma, &grad_beta}; }
+
+    std::string get_weights_string() const override {
+        std::ostringstream ss;
+        ss << get_config_string() << ";gamma:" << gamma.to_string() << ";beta:" << beta.to_string()
+           << ";running_mean:" << running_mean.to_string() << ";running_var:" << running_var.to_string();
+        return ss.str();
+    }
+
+    void set_weights_from_string(const std::string& data) override {
+        set_config_from_string(data);
+        gamma.from_string(config_value(data, "gamma"));
+        beta.from_string(config_value(data, "beta"));
+        running_mean.from_string(config_value(data, "running_mean"));
+        running_var.from_string(config_value(data, "running_var"));
+    }
+
+private:
+    void allocate() {
+        gamma = Tensor({channels});
+        beta = Tensor({channels});
+        running_mean = Tensor({channels});
+        running_var = Tensor({channels});
+        std::fill(gamma.data.begin(), gamma.data.end(), 1.0f);
+        std::fill(running_var.data.begin(), running_var.data.end(), 1.0f);
+        grad_gamma = Tensor(gamma.shape);
+        grad_beta = Tensor(beta.shape);
+    }
+
+    void check_input(const Tensor& input) const {
+        if (input.shape.size() < 2 || input.shape[1] != channels) {
+            throw std::runtime_error("BatchNormLayer expects " + std::to_string(channels) + " channels in axis 1");
+        }
+    }
+
+    static size_t inner_size(const std::vector<int>& shape) {
+        size_t n = 1;
+        for (size_t d = 2; d < shape.size(); ++d) n *= shape[d];
+        return n;
+    }
+};
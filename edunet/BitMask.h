@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// One-bit-per-element masks saved by forward passes for backward (ReLU,
+// the fused ReLU layers, Dropout): bit i%32 of word i/32 belongs to
+// element i. Packing and applying a mask take eight elements per AVX2
+// compare/movemask, instead of keeping a float copy of the activations.
+namespace BitMask {
+
+    inline size_t words(size_t n) { return (n + 31) / 32; }
+
+    inline bool test(const uint32_t* bits, size_t i) { return bits[i / 32] >> (i % 32) & 1u; }
+
+    // y = ReLU(x) (negative values become 0, as in ReLULayer) and bit i set
+    // where the ReLU passes the gradient, i.e. !(x[i] <= 0). y may alias x.
+    inline void relu_pack(const float* x, float* y, size_t n, uint32_t* bits) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256 zero = _mm256_setzero_ps();
+        for (; i + 32 <= n; i += 32) {
+            uint32_t word = 0;
+            for (int w = 0; w < 4; ++w) {
+                __m256 v = _mm256_loadu_ps(x + i + 8 * w);
+                _mm256_storeu_ps(y + i + 8 * w, _mm256_andnot_ps(_mm256_cmp_ps(v, zero, _CMP_LT_OQ), v));
+                word |= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(v, zero, _CMP_NLE_UQ))) << (8 * w);
+            }
+            bits[i / 32] = word;
+        }
+#endif
+        if (i < n) bits[i / 32] = 0;
+        for (; i < n; ++i) {
+            const float v = x[i];
+            if (!(v <= 0)) bits[i / 32] |= 1u << (i % 32);
+            y[i] = v < 0 ? 0.0f : v;
+        }
+    }
+
+    // relu_pack without the mask, for inference: the same values (NaN and
+    // -0.0 pass through) so forward() and forward_into() agree
+    inline void relu(const float* x, float* y, size_t n) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256 zero = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8) {
+            __m256 v = _mm256_loadu_ps(x + i);
+            _mm256_storeu_ps(y + i, _mm256_andnot_ps(_mm256_cmp_ps(v, zero, _CMP_LT_OQ), v));
+        }
+#endif
+        for (; i < n; ++i) y[i] = x[i] < 0 ? 0.0f : x[i];
+    }
+
+    // Bit i set where !(v[i] <= 0)
+    inline void pack_positive(const float* v, size_t n, uint32_t* bits) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256 zero = _mm256_setzero_ps();
+        for (; i + 32 <= n; i += 32) {
+            uint32_t word = 0;
+            for (int w = 0; w < 4; ++w) {
+                __m256 keep = _mm256_cmp_ps(_mm256_loadu_ps(v + i + 8 * w), zero, _CMP_NLE_UQ);
+                word |= static_cast<uint32_t>(_mm256_movemask_ps(keep)) << (8 * w);
+            }
+            bits[i / 32] = word;
+        }
+#endif
+        if (i < n) bits[i / 32] = 0;
+        for (; i < n; ++i) {
+            if (!(v[i] <= 0)) bits[i / 32] |= 1u << (i % 32);
+        }
+    }
+
+    // out[i] = bit i ? g[i] * scale : 0. out may alias g.
+    inline void apply(const uint32_t* bits, const float* g, float* out, size_t n, float scale = 1.0f) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i select = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        const __m256 vscale = _mm256_set1_ps(scale);
+        for (; i + 32 <= n; i += 32) {
+            const uint32_t word = bits[i / 32];
+            for (int w = 0; w < 4; ++w) {
+                __m256i byte = _mm256_set1_epi32(static_cast<int>((word >> (8 * w)) & 0xFFu));
+                __m256 keep = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(byte, select), select));
+                __m256 v = _mm256_mul_ps(_mm256_loadu_ps(g + i + 8 * w), vscale);
+                _mm256_storeu_ps(out + i + 8 * w, _mm256_and_ps(v, keep));
+            }
+        }
+#endif
+        for (; i < n; ++i) out[i] = test(bits, i) ? g[i] * scale : 0.0f;
+    }
+
+} // namespace BitMask
@@ -0,0 +1,406 @@
+#pragma once
+#include "Sequential.h"
+#include "Optimizer.h"
+#include "ModelFormat.h"
+#include <vector>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#if defined(EDUNET_HAS_ZLIB)
+#include <zlib.h>
+#endif
+
+struct CheckpointConfig {
+    std::string directory = "checkpoints";
+    std::string prefix = "ckpt";
+    int every_n_steps = 0;   // 0 disables periodic checkpoints
+    int keep_last = 3;       // older checkpoints are deleted, 0 keeps all
+    bool compress = true;    // byte-shuffle + deflate (needs zlib)
+};
+
+// Checkpoint file:
+//
+//   Header (40 bytes)   magic "EDNC", version, flags (bit 0: compressed),
+//                       training step, raw and stored payload sizes and a
+//                       CRC-32C of the stored payload
+//   Payload             section count, then per section a name, a size and
+//                       the bytes: "model" (a ModelFormat file),
+//                       "optimizer" (type name + Optimizer::write_state) and
+//                       "trainer" (opaque caller state, e.g. Trainer's data
+//                       position and random generators)
+//
+// Compressed payloads are byte-shuffled first (byte k of every 4-byte word
+// goes to plane k), which lets deflate exploit the similar float exponents.
+namespace Checkpoint {
+
+    constexpr char MAGIC[4] = {'E', 'D', 'N', 'C'};
+    // 2: Adam state stores a variable number of moments per layer
+    constexpr uint32_t VERSION = 2;
+    constexpr size_t HEADER_SIZE = 40;
+    constexpr uint32_t FLAG_COMPRESSED = 1;
+
+    using Sections = std::vector<std::pair<std::string, std::vector<char>>>;
+
+    inline bool compression_available() {
+#if defined(EDUNET_HAS_ZLIB)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    inline void shuffle_bytes(const char* in, size_t n, char* out) {
+        size_t words = n / 4;
+        for (size_t i = 0; i < words; ++i) {
+            for (size_t k = 0; k < 4; ++k) out[k * words + i] = in[4 * i + k];
+        }
+        std::copy(in + 4 * words, in + n, out + 4 * words);
+    }
+
+    inline void unshuffle_bytes(const char* in, size_t n, char* out) {
+        size_t words = n / 4;
+        for (size_t i = 0; i < words; ++i) {
+            for (size_t k = 0; k < 4; ++k) out[4 * i + k] = in[k * words + i];
+        }
+        std::copy(in + 4 * words, in + n, out + 4 * words);
+    }
+
+    // Starts a section in `payload` and returns the position of its size
+    // field, to be passed to end_section() once the bytes are appended
+    inline size_t begin_section(std::vector<char>& payload, const std::string& name) {
+        ModelFormat::put_string(payload, name);
+        size_t size_pos = payload.size();
+        ModelFormat::put_u64(payload, 0);
+        return size_pos;
+    }
+
+    inline void end_section(std::vector<char>& payload, size_t size_pos) {
+        ModelFormat::patch_u64(payload, size_pos, payload.size() - size_pos - 8);
+    }
+
+    inline std::string file_name(const std::string& prefix, long long step) {
+        std::ostringstream ss;
+        ss << prefix << "-" << std::setw(10) << std::setfill('0') << step << ".ckpt";
+        return ss.str();
+    }
+
+    // Checkpoints of `prefix` in `directory`, oldest step first
+    inline std::vector<std::pair<long long, std::filesystem::path>> list(const std::string& directory,
+                                                                          const std::string& prefix) {
+        std::vector<std::pair<long long, std::filesystem::path>> found;
+        if (!std::filesystem::is_directory(directory)) return found;
+        const std::string head = prefix + "-";
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            std::string name = entry.path().filename().string();
+            if (name.size() <= head.size() + 5 || name.compare(0, head.size(), head) != 0 ||
+                name.compare(name.size() - 5, 5, ".ckpt") != 0) continue;
+            std::string digits = name.substr(head.size(), name.size() - head.size() - 5);
+            if (digits.empty() || !std::all_of(digits.begin(), digits.end(), ::isdigit)) continue;
+            found.emplace_back(std::stoll(digits), entry.path());
+        }
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+
+    // Writes header + payload to `path` through a temporary file that is
+    // renamed into place once complete, so readers never see a partial
+    // checkpoint. `shuffled` and `compressed` are scratch buffers reused
+    // between calls.
+    inline void write(const std::string& path, long long step, const std::vector<char>& payload, bool compress,
+                      std::vector<char>& shuffled, std::vector<char>& compressed) {
+        const char* stored = payload.data();
+        size_t stored_size = payload.size();
+        uint32_t flags = 0;
+#if defined(EDUNET_HAS_ZLIB)
+        if (compress) {
+            shuffled.resize(payload.size());
+            shuffle_bytes(payload.data(), payload.size(), shuffled.data());
+            uLongf bound = compressBound(static_cast<uLong>(shuffled.size()));
+            compressed.resize(bound);
+            if (compress2(reinterpret_cast<Bytef*>(compressed.data()), &bound,
+                          reinterpret_cast<const Bytef*>(shuffled.data()), static_cast<uLong>(shuffled.size()),
+                          Z_BEST_SPEED) != Z_OK) {
+                throw std::runtime_error("Checkpoint compression failed");
+            }
+            stored = compressed.data();
+            stored_size = bound;
+            flags |= FLAG_COMPRESSED;
+        }
+#else
+        (void)compress; (void)shuffled; (void)compressed;
+#endif
+
+        std::vector<char> header;
+        header.insert(header.end(), MAGIC, MAGIC + 4);
+        ModelFormat::put_u32(header, VERSION);
+        ModelFormat::put_u32(header, flags);
+        ModelFormat::put_u64(header, static_cast<uint64_t>(step));
+        ModelFormat::put_u64(header, payload.size());
+        ModelFormat::put_u64(header, stored_size);
+        ModelFormat::put_u32(header, ModelFormat::crc32c(0, stored, stored_size));
+
+        const std::string tmp_path = path + ".tmp";
+        FILE* file = std::fopen(tmp_path.c_str(), "wb");
+        if (!file) throw std::runtime_error("Cannot open file for writing: " + tmp_path);
+        bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size() &&
+                  std::fwrite(stored, 1, stored_size, file) == stored_size &&
+                  std::fflush(file) == 0;
+#if defined(EDUNET_HAS_MMAP)
+        ok = ok && ::fsync(::fileno(file)) == 0;
+#endif
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok) {
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("Failed to write checkpoint: " + tmp_path);
+        }
+        std::filesystem::rename(tmp_path, path);
+    }
+
+    // Reads and verifies a checkpoint, returning its sections
+    inline Sections read(const std::string& path, long long& step) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) throw std::runtime_error("Cannot open file for reading: " + path);
+        char header[HEADER_SIZE];
+        if (!file.read(header, HEADER_SIZE) || std::memcmp(header, MAGIC, 4) != 0) {
+            throw std::runtime_error("Not an edunet checkpoint: " + path);
+        }
+        ModelFormat::Reader h(header + 4, HEADER_SIZE - 4);
+        uint32_t version = h.u32();
+        if (version != VERSION) throw std::runtime_error("Unsupported checkpoint version " + std::to_string(version));
+        uint32_t flags = h.u32();
+        step = static_cast<long long>(h.u64());
+        uint64_t raw_size = h.u64();
+        uint64_t stored_size = h.u64();
+        uint32_t checksum = h.u32();
+
+        std::vector<char> stored(stored_size);
+        if (!file.read(stored.data(), stored.size())) throw std::runtime_error("Truncated checkpoint: " + path);
+        if (ModelFormat::crc32c(0, stored.data(), stored.size()) != checksum) {
+            throw std::runtime_error("Checksum mismatch in checkpoint: " + path);
+        }
+
+        std::vector<char> payload;
+        if (flags & FLAG_COMPRESSED) {
+#if defined(EDUNET_HAS_ZLIB)
+            std::vector<char> shuffled(raw_size);
+            uLongf size = static_cast<uLongf>(raw_size);
+            if (uncompress(reinterpret_cast<Bytef*>(shuffled.data()), &size,
+                           reinterpret_cast<const Bytef*>(stored.data()), static_cast<uLong>(stored.size())) != Z_OK ||
+                size != raw_size) {
+                throw std::runtime_error("Corrupt compressed checkpoint: " + path);
+            }
+            payload.resize(raw_size);
+            unshuffle_bytes(shuffled.data(), shuffled.size(), payload.data());
+#else
+            throw std::runtime_error("Checkpoint is compressed but edunet was built without zlib: " + path);
+#endif
+        } else {
+            if (raw_size != stored_size) throw std::runtime_error("Corrupt checkpoint: " + path);
+            payload = std::move(stored);
+        }
+
+        Sections sections;
+        ModelFormat::Reader r(payload.data(), payload.size());
+        uint32_t count = r.u32();
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string name = r.str();
+            uint64_t size = r.u64();
+            const char* bytes = r.bytes(size);
+            sections.emplace_back(name, std::vector<char>(bytes, bytes + size));
+        }
+        return sections;
+    }
+
+    // Bytes of section `name`, or nullptr if the checkpoint has none
+    inline const std::vector<char>* find(const Sections& sections, const std::string& name) {
+        for (const auto& section : sections) {
+            if (section.first == name) return &section.second;
+        }
+        return nullptr;
+    }
+
+} // namespace Checkpoint
+
+// Periodic checkpointing without stalling training. snapshot() copies the
+// parameters and optimizer state into a staging buffer on the training
+// thread; a background thread then checksums, compresses and writes it, and
+// prunes old checkpoints. While a write is still in flight, further
+// snapshots are skipped rather than waited for.
+class Checkpointer {
+public:
+    struct Stats {
+        int written = 0;
+        int skipped = 0;
+        int failed = 0;
+        double snapshot_ms = 0.0;   // total time spent on the training thread
+        double write_ms = 0.0;      // total time spent in the background
+        size_t last_raw_bytes = 0;
+        size_t last_file_bytes = 0;
+    };
+
+    explicit Checkpointer(const CheckpointConfig& config) : config(config) {
+        worker = std::thread([this]() { run(); });
+    }
+
+    ~Checkpointer() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return !pending; });
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // True every config.every_n_steps steps
+    bool due(long long step) const {
+        return config.every_n_steps > 0 && step % config.every_n_steps == 0;
+    }
+
+    // Stages a checkpoint of `step` for the background writer. Returns false
+    // (and counts a skip) if the previous checkpoint is still being written.
+    bool snapshot(long long step, const Sequential& model, const Optimizer& optimizer,
+                  const std::vector<char>& trainer_state) {
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pending) {
+                stats.skipped++;
+                return false;
+            }
+        }
+
+        // The writer is idle, so the staging buffer is ours until `pending`
+        staging.clear();
+        ModelFormat::put_u32(staging, 3);
+        size_t model_size_pos = Checkpoint::begin_section(staging, "model");
+        model_offset = staging.size();
+        model_size = ModelFormat::encode(model.layers, staging);
+        Checkpoint::end_section(staging, model_size_pos);
+
+        size_t optimizer_size_pos = Checkpoint::begin_section(staging, "optimizer");
+        ModelFormat::put_string(staging, optimizer.get_optimizer_type());
+        optimizer.write_state(staging);
+        Checkpoint::end_section(staging, optimizer_size_pos);
+
+        size_t trainer_size_pos = Checkpoint::begin_section(staging, "trainer");
+        staging.insert(staging.end(), trainer_state.begin(), trainer_state.end());
+        Checkpoint::end_section(staging, trainer_size_pos);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            staged_step = step;
+            pending = true;
+            stats.snapshot_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        wake.notify_one();
+        return true;
+    }
+
+    // Blocks until the staged checkpoint, if any, is on disk
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return !pending; });
+    }
+
+    Stats get_stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    const CheckpointConfig& get_config() const { return config; }
+
+    void print_summary() const {
+        Stats s = get_stats();
+        int taken = s.written + s.failed;
+        std::cout << "Checkpoints: " << s.written << " written, " << s.skipped << " skipped";
+        if (s.failed) std::cout << ", " << s.failed << " failed";
+        if (taken > 0) {
+            std::cout << " | snapshot " << std::fixed << std::setprecision(2) << s.snapshot_ms / taken << " ms avg"
+                      << " | background write " << s.write_ms / taken << " ms avg"
+                      << " | " << s.last_file_bytes / 1024 << " KiB (" << s.last_raw_bytes / 1024 << " KiB raw)";
+        }
+        std::cout << std::endl;
+    }
+
+private:
+    CheckpointConfig config;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool pending = false;
+    bool stopping = false;
+    Stats stats;
+    std::thread worker;
+
+    // Written by snapshot() while the worker is idle, read by the worker
+    // while `pending` is set
+    std::vector<char> staging;
+    size_t model_offset = 0;
+    size_t model_size = 0;
+    long long staged_step = 0;
+
+    // Worker-only scratch
+    std::vector<char> shuffled;
+    std::vector<char> compressed;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return pending || stopping; });
+            if (!pending) return;
+            long long step = staged_step;
+            lock.unlock();
+
+            auto start = std::chrono::steady_clock::now();
+            bool ok = true;
+            size_t file_bytes = 0;
+            try {
+                ModelFormat::seal(staging.data() + model_offset, model_size);
+                std::filesystem::create_directories(config.directory);
+                std::filesystem::path path = std::filesystem::path(config.directory) / Checkpoint::file_name(config.prefix, step);
+                Checkpoint::write(path.string(), step, staging, config.compress, shuffled, compressed);
+                file_bytes = std::filesystem::file_size(path);
+                prune();
+            } catch (const std::exception& e) {
+                std::cerr << "Checkpoint at step " << step << " failed: " << e.what() << std::endl;
+                ok = false;
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            lock.lock();
+            if (ok) {
+                stats.written++;
+                stats.last_raw_bytes = staging.size();
+                stats.last_file_bytes = file_bytes;
+            } else {
+                stats.failed++;
+            }
+            stats.write_ms += ms;
+            pending = false;
+            done.notify_all();
+        }
+    }
+
+    void prune() {
+        if (config.keep_last <= 0) return;
+        auto existing = Checkpoint::list(config.directory, config.prefix);
+        for (size_t i = 0; i + config.keep_last < existing.size(); ++i) {
+            std::filesystem::remove(existing[i].second);
+        }
+    }
+};
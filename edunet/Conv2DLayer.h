@@ -1,5 +1,6 @@
 #pragma once
 #include "Layer.h"
+#include "VectorOps.h"
 #include <random>
 #include <fstream>
 #include <sstream>
@@ -10,10 +11,21 @@ public:
     Tensor biases;  
     Tensor grad_kernels;
     Tensor grad_biases;
-private:
+protected:
     int in_channels, out_channels;
     int kernel_size, stride, padding;
     Tensor last_input;
+
+    // 16-bit mode, as in DenseLayer: kernels packed as a
+    // (in_channels * k * k) x out_channels matrix for the im2col GEMM
+    Half::DType precision = Half::DType::F32;
+    Half::PackedWeights half_kernels;
+    Half::HalfTensor half_input;
+    bool half_stale = true;
+    // im2col patches and transposed GEMM output of forward_half, kept
+    // between calls so inference does not allocate per sample
+    std::vector<float> half_columns;
+    std::vector<float> half_output;
 public:
     Conv2DLayer(int input_channels, int output_channels, int k_size, int s = 1, int p = 0)
         : in_channels(input_channels), out_channels(output_channels), 
@@ -24,9 +36,7 @@ public:
         grad_biases = Tensor(biases.shape);
         
         // Xavier initialization
-        // ИСПРАВЛЕНО: Правильная инициализация ГСЧ
-        std::random_device rd;
-        std::mt19937 generator(rd());
+        Random::Stream generator = Random::stream("Conv2DLayer");
         float range = std::sqrt(6.0f / (in_channels * kernel_size * kernel_size + out_channels * kernel_size * kernel_size));
         std::uniform_real_distribution<float> distribution(-range, range);
         for (auto& w : kernels.data) w = distribution(generator);
@@ -34,11 +44,20 @@ public:
     Conv2DLayer() = default;
 
     Tensor forward(const Tensor& input) override {
-        last_input = input;
         int N = input.shape[0], C_in = input.shape[1], H_in = input.shape[2], W_in = input.shape[3];
         int H_out = (H_in + 2 * padding - kernel_size) / stride + 1;
         int W_out = (W_in + 2 * padding - kernel_size) / stride + 1;
         Tensor output({N, out_channels, H_out, W_out});
+        if (precision != Half::DType::F32) {
+            forward_half(input, output);
+            Half::convert(input, precision, half_input);
+            return output;
+        }
+        last_input = input;
+        if (is_pointwise()) {
+            forward_pointwise(input, output);
+            return output;
+        }
         for (int n = 0; n < N; ++n) {
             for (int c_out = 0; c_out < out_channels; ++c_out) {
                 for (int h = 0; h < H_out; ++h) {
@@ -64,11 +83,21 @@ public:
     }
 
     Tensor backward(const Tensor& output_gradient) override {
-        int N = last_input.shape[0], H_in = last_input.shape[2], W_in = last_input.shape[3];
+        Tensor input_fp32;
+        if (precision != Half::DType::F32) {
+            Half::convert(half_input, input_fp32);
+            half_stale = true;
+        }
+        const Tensor& input = precision != Half::DType::F32 ? input_fp32 : last_input;
+        int N = input.shape[0], H_in = input.shape[2], W_in = input.shape[3];
         int H_out = output_gradient.shape[2], W_out = output_gradient.shape[3];
-        Tensor input_gradient(last_input.shape);
-        grad_kernels = Tensor(kernels.shape);
-        grad_biases = Tensor(biases.shape);
+        Tensor input_gradient(input.shape);
+        start_gradient(grad_kernels, kernels.shape);
+        start_gradient(grad_biases, biases.shape);
+        if (is_pointwise()) {
+            backward_pointwise(input, output_gradient, input_gradient);
+            return input_gradient;
+        }
         for (int n = 0; n < N; ++n) {
             for (int c_out = 0; c_out < out_channels; ++c_out) {
                 for (int h = 0; h < H_out; ++h) {
@@ -81,7 +110,7 @@ public:
                                     int h_in_idx = h * stride + kh - padding;
                                     int w_in_idx = w * stride + kw - padding;
                                     if (h_in_idx >= 0 && h_in_idx < H_in && w_in_idx >= 0 && w_in_idx < W_in) {
-                                        grad_kernels.at(c_out, c_in, kh, kw) += last_input.at(n, c_in, h_in_idx, w_in_idx) * grad_out_val;
+                                        grad_kernels.at(c_out, c_in, kh, kw) += input.at(n, c_in, h_in_idx, w_in_idx) * grad_out_val;
                                         input_gradient.at(n, c_in, h_in_idx, w_in_idx) += kernels.at(c_out, c_in, kh, kw) * grad_out_val;
                                     }
                                 }
@@ -95,6 +124,27 @@ public:
     }
 
     std::unique_ptr<Layer> clone() const override { return std::make_unique<Conv2DLayer>(*this); }
+
+    void set_precision(Half::DType dtype) override {
+        precision = dtype;
+        half_kernels.clear();
+        half_input.clear();
+        last_input = Tensor();
+        half_stale = true;
+    }
+
+    Half::DType get_precision() const { return precision; }
+
+    size_t activation_bytes() const override { return last_input.data.size() * sizeof(float) + half_input.bytes(); }
+
+    void release_activations() override {
+        last_input = Tensor();
+        half_input = Half::HalfTensor();
+        std::vector<float>().swap(half_columns);
+        std::vector<float>().swap(half_output);
+    }
+
+    void parameters_changed() override { half_stale = true; }
     
     void save_weights(const std::string& filename) const override {
         std::ofstream meta_file(filename + "_conv2d.meta");
@@ -111,10 +161,41 @@ public:
         meta_file.close();
         kernels.load_from_file(filename + "_kernels.bin");
         biases.load_from_file(filename + "_biases.bin");
+        half_stale = true;
     }
     
     std::string get_layer_type() const override { return "Conv2DLayer"; }
     
+    std::string get_config_string() const override {
+        std::stringstream ss;
+        ss << "in_channels:" << in_channels << ";out_channels:" << out_channels << ";kernel_size:" << kernel_size
+           << ";stride:" << stride << ";padding:" << padding;
+        return ss.str();
+    }
+
+    void set_config_from_string(const std::string& config) override {
+        in_channels = std::stoi(config_value(config, "in_channels"));
+        out_channels = std::stoi(config_value(config, "out_channels"));
+        kernel_size = std::stoi(config_value(config, "kernel_size"));
+        stride = std::stoi(config_value(config, "stride"));
+        padding = std::stoi(config_value(config, "padding"));
+        kernels = Tensor({out_channels, in_channels, kernel_size, kernel_size});
+        biases = Tensor({out_channels});
+        grad_kernels = Tensor(kernels.shape);
+        grad_biases = Tensor(biases.shape);
+        half_stale = true;
+    }
+
+    std::vector<Tensor*> parameters() override { return {&kernels, &biases}; }
+    std::vector<Tensor*> gradients() override { return {&grad_kernels, &grad_biases}; }
+
+    double forward_flops(const std::vector<int>& input_shape, const std::vector<int>& output_shape) const override {
+        (void)output_shape;
+        const int h_out = (input_shape[2] + 2 * padding - kernel_size) / stride + 1;
+        const int w_out = (input_shape[3] + 2 * padding - kernel_size) / stride + 1;
+        return 2.0 * input_shape[0] * out_channels * h_out * w_out * in_channels * kernel_size * kernel_size;
+    }
+
     std::string get_weights_string() const override {
         std::stringstream ss;
         ss << "in_channels:" << in_channels << ";out_channels:" << out_channels << ";kernel_size:" << kernel_size
@@ -138,5 +219,100 @@ public:
         size_t biases_pos = data.find("biases:");
         kernels.from_string(data.substr(kernels_pos + 8, biases_pos - kernels_pos - 9));
         biases.from_string(data.substr(biases_pos + 7));
+        half_stale = true;
+    }
+
+private:
+    // A 1x1 convolution with stride 1 and no padding is, per sample, the
+    // GEMM of the out_channels x in_channels kernels with the in_channels x
+    // (H * W) input. Rows are updated in place, so every output still adds
+    // its terms in c_in order after the bias.
+    bool is_pointwise() const { return kernel_size == 1 && stride == 1 && padding == 0; }
+
+    void forward_pointwise(const Tensor& input, Tensor& output) const {
+        const int N = input.shape[0];
+        const size_t positions = static_cast<size_t>(input.shape[2]) * input.shape[3];
+        const float* k = kernels.data.data();
+        for (int n = 0; n < N; ++n) {
+            const float* x = input.data.data() + static_cast<size_t>(n) * in_channels * positions;
+            float* y = output.data.data() + static_cast<size_t>(n) * out_channels * positions;
+            for (int co = 0; co < out_channels; ++co) {
+                float* y_row = y + co * positions;
+                std::fill(y_row, y_row + positions, biases.data[co]);
+                for (int ci = 0; ci < in_channels; ++ci) {
+                    const float wv = k[co * in_channels + ci];
+                    const float* x_row = x + ci * positions;
+                    for (size_t p = 0; p < positions; ++p) y_row[p] += x_row[p] * wv;
+                }
+            }
+        }
+    }
+
+    // Kernel gradient: dY . X^T as dot products of rows; input gradient:
+    // K^T . dY, again by rows
+    void backward_pointwise(const Tensor& input, const Tensor& output_gradient, Tensor& input_gradient) {
+        const int N = input.shape[0];
+        const size_t positions = static_cast<size_t>(input.shape[2]) * input.shape[3];
+        const float* k = kernels.data.data();
+        float* gk = grad_kernels.data.data();
+        for (int n = 0; n < N; ++n) {
+            const float* x = input.data.data() + static_cast<size_t>(n) * in_channels * positions;
+            const float* g = output_gradient.data.data() + static_cast<size_t>(n) * out_channels * positions;
+            float* gx = input_gradient.data.data() + static_cast<size_t>(n) * in_channels * positions;
+            for (int co = 0; co < out_channels; ++co) {
+                const float* g_row = g + co * positions;
+                grad_biases.data[co] += VectorOps::sum(g_row, positions);
+                for (int ci = 0; ci < in_channels; ++ci) {
+                    gk[co * in_channels + ci] += VectorOps::dot(x + ci * positions, g_row, positions);
+                }
+            }
+            for (int ci = 0; ci < in_channels; ++ci) {
+                float* gx_row = gx + ci * positions;
+                for (int co = 0; co < out_channels; ++co) {
+                    const float wv = k[co * in_channels + ci];
+                    const float* g_row = g + co * positions;
+                    for (size_t p = 0; p < positions; ++p) gx_row[p] += wv * g_row[p];
+                }
+            }
+        }
+    }
+
+    // im2col of each sample: one row of in_channels * k * k inputs per output
+    // position, multiplied by the packed kernels
+    void forward_half(const Tensor& input, Tensor& output) {
+        int N = input.shape[0], H_in = input.shape[2], W_in = input.shape[3];
+        int H_out = output.shape[2], W_out = output.shape[3];
+        int patch = in_channels * kernel_size * kernel_size;
+        int positions = H_out * W_out;
+        if (half_stale) {
+            half_kernels.pack(kernels.data.data(), patch, out_channels, precision, true);
+            half_stale = false;
+        }
+        half_columns.resize(static_cast<size_t>(positions) * patch);
+        half_output.resize(static_cast<size_t>(positions) * out_channels);
+        for (int n = 0; n < N; ++n) {
+            for (int h = 0; h < H_out; ++h) {
+                for (int w = 0; w < W_out; ++w) {
+                    float* row = half_columns.data() + static_cast<size_t>(h * W_out + w) * patch;
+                    for (int c_in = 0; c_in < in_channels; ++c_in) {
+                        for (int kh = 0; kh < kernel_size; ++kh) {
+                            for (int kw = 0; kw < kernel_size; ++kw) {
+                                int h_in_idx = h * stride + kh - padding;
+                                int w_in_idx = w * stride + kw - padding;
+                                bool inside = h_in_idx >= 0 && h_in_idx < H_in && w_in_idx >= 0 && w_in_idx < W_in;
+                                *row++ = inside ? input.at(n, c_in, h_in_idx, w_in_idx) : 0.0f;
+                            }
+                        }
+                    }
+                }
+            }
+            Half::gemm(half_columns.data(), positions, patch, half_kernels, biases.data.data(), half_output.data(), out_channels);
+            float* out = output.data.data() + static_cast<size_t>(n) * out_channels * positions;
+            for (int p = 0; p < positions; ++p) {
+                for (int c = 0; c < out_channels; ++c) {
+                    out[static_cast<size_t>(c) * positions + p] = half_output[static_cast<size_t>(p) * out_channels + c];
+                }
+            }
+        }
     }
 };
\ No newline at end of file
@@ -1,24 +1,39 @@
 #include "DQNAgent.h"
 #include <iostream>
 #include <fstream>
-#include <algorithm> // For std::sample
-#include <iterator>  // For std::back_inserter
+#include <algorithm>
+#include <stdexcept>
+
+// Index of the largest Q-value predicted by `net` for a single state. Uses
+// `input` and `workspace` as scratch so steady-state calls don't allocate.
+static int greedy_action(Sequential& net, const float* state, int state_size,
+                         Tensor& input, std::vector<Tensor>& workspace) {
+    input.resize({1, state_size});
+    std::copy(state, state + state_size, input.data.begin());
+    const Tensor& q_values_tensor = net.forward_into(input, workspace);
+    
+    const auto& q_values = q_values_tensor.data;
+    return std::distance(q_values.begin(), std::max_element(q_values.begin(), q_values.end()));
+}
 
-// Helper to create a Tensor from a flat vector
-Tensor vector_to_tensor(const std::vector<float>& vec, const std::vector<int>& shape) {
-    Tensor t(shape);
-    t.data = vec;
-    return t;
+static void check_state_size(size_t size, int state_size) {
+    if (size != static_cast<size_t>(state_size)) {
+        throw std::invalid_argument("State size mismatch in DQNAgent::act");
+    }
 }
 
-DQNAgent::DQNAgent(int state_size, int action_size)
+DQNAgent::DQNAgent(int state_size, int action_size, const DQNConfig& config)
     : state_size(state_size),
       action_size(action_size),
-      gen(std::random_device()()) {
+      config(config),
+      memory(config.memory_size),
+      n_step_buffer(config.n_step, config.gamma, state_size),
+      epsilon(config.epsilon),
+      gen(config.seed ? Random::seeded(config.seed) : Random::stream("DQNAgent")) {
     
     model = build_model();
     target_model = build_model();
-    optimizer = std::make_unique<Adam>(learning_rate);
+    optimizer = std::make_unique<Adam>(config.learning_rate);
 
     update_target_model();
 }
@@ -34,91 +49,104 @@ Sequential DQNAgent::build_model() {
 }
 
 void DQNAgent::update_target_model() {
-    const std::string temp_path = "temp_agent_weights.bin";
-    model.save_model(temp_path);
-    target_model.load_model(temp_path);
+    std::lock_guard<std::mutex> lock(model_mutex);
+    target_model = model;
+}
+
+void DQNAgent::copy_policy(Sequential& policy) const {
+    std::lock_guard<std::mutex> lock(model_mutex);
+    policy = model;
 }
 
 void DQNAgent::remember(const std::vector<float>& state, int action, float reward, const std::vector<float>& next_state, bool done) {
-    if (memory.size() >= memory_size) {
-        memory.pop_front();
-    }
-    memory.push_back({state, action, reward, next_state, done});
+    remember(state.data(), action, reward, next_state.data(), done);
+}
+
+void DQNAgent::remember(const float* state, int action, float reward, const float* next_state, bool done) {
+    n_step_buffer.add(state, action, reward, next_state, done, memory);
+}
+
+void DQNAgent::end_episode() {
+    n_step_buffer.flush(memory);
 }
 
 int DQNAgent::act(const std::vector<float>& state) {
+    return act(state.data(), state.size());
+}
+
+int DQNAgent::act(const float* state, size_t size) {
+    check_state_size(size, state_size);
+    std::lock_guard<std::mutex> lock(model_mutex);
     std::uniform_real_distribution<float> dis(0.0, 1.0);
-    if (dis(gen) <= epsilon) {
+    if (dis(gen) <= get_epsilon()) {
         std::uniform_int_distribution<> distrib(0, action_size - 1);
         return distrib(gen);
     }
 
-    Tensor state_tensor = vector_to_tensor(state, {1, state_size});
-    Tensor q_values_tensor = model.forward(state_tensor);
-    
-    const auto& q_values = q_values_tensor.data;
-    return std::distance(q_values.begin(), std::max_element(q_values.begin(), q_values.end()));
+    return greedy_action(model, state, state_size, act_input, act_workspace);
 }
 
 void DQNAgent::replay(int batch_size) {
-    if (memory.size() < batch_size) {
-        return;
+    if (train_step(batch_size)) {
+        decay_epsilon();
     }
+}
 
-    std::vector<Transition> minibatch;
-    std::sample(memory.begin(), memory.end(), std::back_inserter(minibatch),
-                batch_size, gen);
-
-    std::vector<float> states_flat;
-    std::vector<float> targets_flat;
-
-    for (const auto& transition : minibatch) {
-        // Get current Q values from the main model
-        Tensor state_tensor = vector_to_tensor(transition.state, {1, state_size});
-        Tensor current_q_tensor = model.forward(state_tensor);
-        std::vector<float> target_q = current_q_tensor.data;
-
-        float target_val;
-        if (transition.done) {
-            target_val = transition.reward;
-        } else {
-            // Get next Q values from the target model
-            Tensor next_state_tensor = vector_to_tensor(transition.next_state, {1, state_size});
-            Tensor next_q_tensor = target_model.forward(next_state_tensor);
-            const auto& next_q_values = next_q_tensor.data;
-            target_val = transition.reward + gamma * (*std::max_element(next_q_values.begin(), next_q_values.end()));
-        }
-
-        // Update the Q value for the action that was taken
-        target_q[transition.action] = target_val;
+void DQNAgent::decay_epsilon() {
+    float current = epsilon.load(std::memory_order_relaxed);
+    while (current > config.epsilon_min &&
+           !epsilon.compare_exchange_weak(current, current * config.epsilon_decay, std::memory_order_relaxed)) {
+    }
+}
 
-        // Add to the batch data
-        states_flat.insert(states_flat.end(), transition.state.begin(), transition.state.end());
-        targets_flat.insert(targets_flat.end(), target_q.begin(), target_q.end());
+bool DQNAgent::train_step(int batch_size) {
+    if (memory.size() < static_cast<size_t>(batch_size)) {
+        return false;
     }
 
-    // Create batch tensors
-    Tensor states_batch = vector_to_tensor(states_flat, {batch_size, state_size});
-    Tensor targets_batch = vector_to_tensor(targets_flat, {batch_size, action_size});
+    std::lock_guard<std::mutex> lock(model_mutex);
+    memory.sample(batch_size, gen, batch);
+
+    // Bootstrap values for the whole batch: one target-net pass and, for
+    // Double DQN, one online-net pass over all next states.
+    const Tensor& next_q_target = target_model.forward_into(batch.next_states, target_workspace);
+    const Tensor& next_q_select = config.double_dqn
+        ? model.forward_into(batch.next_states, online_workspace)
+        : next_q_target;
+
+    // The training forward pass must come last, layers cache its inputs
+    Tensor y_pred = model.forward(batch.states);
+
+    targets.resize(y_pred.shape);
+    std::copy(y_pred.data.begin(), y_pred.data.end(), targets.data.begin());
+    for (int i = 0; i < batch_size; ++i) {
+        float target_val = batch.rewards[i];
+        if (!batch.dones[i]) {
+            const float* select_row = next_q_select.data.data() + i * action_size;
+            int best_action = std::max_element(select_row, select_row + action_size) - select_row;
+            target_val += batch.discounts[i] * next_q_target.data[i * action_size + best_action];
+        }
+        // Only the Q value of the action that was taken gets a gradient
+        targets.data[i * action_size + batch.actions[i]] = target_val;
+    }
 
-    // Perform a single training step
-    Tensor y_pred = model.forward(states_batch);
-    Tensor loss_grad = loss_fn.derivative(y_pred, targets_batch);
+    last_loss.store(loss_fn.calculate(y_pred, targets), std::memory_order_relaxed);
+    Tensor loss_grad = loss_fn.derivative(y_pred, targets);
     model.backward(loss_grad);
     optimizer->step(model);
-
-    // Decay epsilon
-    if (epsilon > epsilon_min) {
-        epsilon *= epsilon_decay;
-    }
+    return true;
 }
 
 void DQNAgent::save(const std::string& path) {
+    std::lock_guard<std::mutex> lock(model_mutex);
     model.save_model(path);
 }
 
 void DQNAgent::load(const std::string& path) {
-    model.load_model(path);
+    {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        model.load_model(path);
+    }
     update_target_model();
 }
 
@@ -126,6 +154,43 @@ void DQNAgent::set_evaluation_mode(bool eval) {
     if (eval) {
         epsilon = 0.0f;
     } else {
-        epsilon = 1.0f; // Reset to default exploration rate for training
+        epsilon = config.epsilon; // Reset to default exploration rate for training
     }
-}
\ No newline at end of file
+}
+
+DQNActor::DQNActor(DQNAgent& learner, unsigned int actor_index)
+    : learner(learner), gen(Random::stream("DQNActor", actor_index)),
+      n_step_buffer(learner.get_config().n_step, learner.get_config().gamma, learner.get_state_size()) {
+    refresh_policy();
+}
+
+void DQNActor::refresh_policy() {
+    learner.copy_policy(policy);
+}
+
+int DQNActor::act(const std::vector<float>& state) {
+    return act(state.data(), state.size());
+}
+
+int DQNActor::act(const float* state, size_t size) {
+    check_state_size(size, learner.get_state_size());
+    std::uniform_real_distribution<float> dis(0.0, 1.0);
+    if (dis(gen) <= learner.get_epsilon()) {
+        std::uniform_int_distribution<> distrib(0, learner.get_action_size() - 1);
+        return distrib(gen);
+    }
+
+    return greedy_action(policy, state, learner.get_state_size(), act_input, act_workspace);
+}
+
+void DQNActor::remember(const std::vector<float>& state, int action, float reward, const std::vector<float>& next_state, bool done) {
+    remember(state.data(), action, reward, next_state.data(), done);
+}
+
+void DQNActor::remember(const float* state, int action, float reward, const float* next_state, bool done) {
+    n_step_buffer.add(state, action, reward, next_state, done, learner.get_memory());
+}
+
+void DQNActor::end_episode() {
+    n_step_buffer.flush(learner.get_memory());
+}
@@ -6,36 +6,60 @@
 #include "Optimizer.h"
 #include "Loss.h"
 #include "Tensor.h"
+#include "ReplayBuffer.h"
 #include <vector>
-#include <deque>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 
-// A transition in the environment
-struct Transition {
-    std::vector<float> state;
-    int action;
-    float reward;
-    std::vector<float> next_state;
-    bool done;
+// Hyper-parameters of DQNAgent
+struct DQNConfig {
+    size_t memory_size = 10000;
+    float gamma = 0.95f;          // discount rate
+    float epsilon = 1.0f;         // initial exploration rate
+    float epsilon_min = 0.01f;
+    float epsilon_decay = 0.995f;
+    float learning_rate = 0.001f;
+    int n_step = 3;               // rewards accumulated into each stored return
+    bool double_dqn = true;       // argmax from the online net, value from the target net
+    unsigned int seed = 0;        // exploration and replay sampling; 0 uses the global context (Random.h)
 };
 
 class DQNAgent {
 public:
-    DQNAgent(int state_size, int action_size);
+    DQNAgent(int state_size, int action_size, const DQNConfig& config = {});
 
     // Choose an action based on the current state using epsilon-greedy policy
     int act(const std::vector<float>& state);
 
-    // Store a transition in the replay memory
+    // Allocation-free variant: `state` points to state_size floats. Q-values
+    // are computed in a persistent per-agent workspace.
+    int act(const float* state, size_t size);
+
+    // Store a transition in the replay memory. Transitions are folded into
+    // n-step returns; call end_episode() if an episode stops without `done`.
+    // Single producer only: actor threads go through DQNActor.
     void remember(const std::vector<float>& state, int action, float reward, const std::vector<float>& next_state, bool done);
+    void remember(const float* state, int action, float reward, const float* next_state, bool done);
+    void end_episode();
 
-    // Train the model by replaying a batch of experiences
+    // Train the model by replaying a batch of experiences, then decay epsilon
     void replay(int batch_size);
 
+    // Single gradient step on a sampled batch without touching epsilon.
+    // Returns false if the replay memory does not hold a full batch yet.
+    bool train_step(int batch_size);
+
+    // Multiply epsilon by epsilon_decay, down to epsilon_min (thread-safe)
+    void decay_epsilon();
+
     // Update the target network weights
     void update_target_model();
 
+    // Copy the online network into `policy` (thread-safe snapshot for actors)
+    void copy_policy(Sequential& policy) const;
+
     // Save the model weights
     void save(const std::string& path);
 
@@ -45,23 +69,68 @@ public:
     // Set the agent to evaluation or training mode
     void set_evaluation_mode(bool eval);
 
+    float get_epsilon() const { return epsilon.load(std::memory_order_relaxed); }
+    // Mean squared TD error of the last train_step batch
+    float get_last_loss() const { return last_loss.load(std::memory_order_relaxed); }
+    int get_state_size() const { return state_size; }
+    int get_action_size() const { return action_size; }
+    const DQNConfig& get_config() const { return config; }
+    ReplayBuffer& get_memory() { return memory; }
+
 private:
     int state_size;
     int action_size;
-    std::deque<Transition> memory;
-    size_t memory_size = 10000;
-    float gamma = 0.95f;    // discount rate
-    float epsilon = 1.0f;   // exploration rate
-    float epsilon_min = 0.01f;
-    float epsilon_decay = 0.995f;
-    float learning_rate = 0.001f;
+    DQNConfig config;
+    ReplayBuffer memory;
+    NStepAccumulator n_step_buffer;
+    std::atomic<float> epsilon;   // exploration rate
+    std::atomic<float> last_loss{0.0f};
 
+    // Guards model, target_model, optimizer, gen and the replay workspaces
+    mutable std::mutex model_mutex;
     Sequential model;
     Sequential target_model;
     std::unique_ptr<Adam> optimizer;
     MeanSquaredError loss_fn;
 
-    std::mt19937 gen;
+    Random::Stream gen;
+
+    // Inference buffers reused by act()
+    Tensor act_input;
+    std::vector<Tensor> act_workspace;
+
+    // Buffers reused by train_step()
+    TransitionBatch batch;
+    std::vector<Tensor> online_workspace;
+    std::vector<Tensor> target_workspace;
+    Tensor targets;
 
     Sequential build_model();
 };
+
+// Actor side of actor-learner training: acts epsilon-greedily with a private
+// copy of the learner's online network, refreshed on demand, and feeds
+// n-step transitions into the learner's shared replay memory.
+class DQNActor {
+public:
+    // Actors with distinct indices explore with distinct random streams
+    DQNActor(DQNAgent& learner, unsigned int actor_index);
+
+    int act(const std::vector<float>& state);
+    int act(const float* state, size_t size);
+
+    void remember(const std::vector<float>& state, int action, float reward, const std::vector<float>& next_state, bool done);
+    void remember(const float* state, int action, float reward, const float* next_state, bool done);
+    void end_episode();
+
+    // Pull the latest online weights from the learner
+    void refresh_policy();
+
+private:
+    DQNAgent& learner;
+    Sequential policy;
+    Random::Stream gen;
+    NStepAccumulator n_step_buffer;
+    Tensor act_input;
+    std::vector<Tensor> act_workspace;
+};
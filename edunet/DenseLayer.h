@@ -4,6 +4,7 @@
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <algorithm>
 
 class DenseLayer : public Layer {
 public:
@@ -12,10 +13,17 @@ public:
     Tensor grad_weights;
     Tensor grad_bias;
     
-private:
+protected:
     Tensor last_input;
     int input_size;
     int output_size;
+
+    // 16-bit mode: weights packed from the fp32 masters, refreshed after
+    // they change, and the forward input kept for backward in 16 bits
+    Half::DType precision = Half::DType::F32;
+    Half::PackedWeights half_weights;
+    Half::HalfTensor half_input;
+    bool half_stale = true;
     
 public:
     DenseLayer(int input_size, int output_size) 
@@ -32,6 +40,12 @@ public:
     DenseLayer() : input_size(0), output_size(0) {}
     
     Tensor forward(const Tensor& input) override {
+        if (precision != Half::DType::F32) {
+            Tensor output;
+            forward_into(input, output);
+            Half::convert(input, precision, half_input);
+            return output;
+        }
         last_input = input;
         
         if (input.shape.size() != 2) {
@@ -52,23 +66,77 @@ public:
         return output;
     }
     
+    void forward_into(const Tensor& input, Tensor& output) override {
+        if (input.shape.size() != 2) {
+            throw std::runtime_error("DenseLayer expects 2D input");
+        }
+        if (input.shape[1] != input_size) {
+            throw std::runtime_error("Input size mismatch in DenseLayer");
+        }
+
+        int batch_size = input.shape[0];
+        output.resize({batch_size, output_size});
+        if (precision != Half::DType::F32) {
+            if (half_stale) {
+                half_weights.pack(weights.data.data(), input_size, output_size, precision);
+                half_stale = false;
+            }
+            Half::gemm(input.data.data(), batch_size, input_size, half_weights, bias.data.data(),
+                       output.data.data(), output_size);
+            return;
+        }
+        const float* w = weights.data.data();
+        for (int i = 0; i < batch_size; ++i) {
+            const float* in_row = input.data.data() + i * input_size;
+            float* out_row = output.data.data() + i * output_size;
+            std::copy(bias.data.begin(), bias.data.end(), out_row);
+            for (int k = 0; k < input_size; ++k) {
+                float a = in_row[k];
+                const float* w_row = w + k * output_size;
+                for (int j = 0; j < output_size; ++j) {
+                    out_row[j] += a * w_row[j];
+                }
+            }
+        }
+    }
+
     Tensor backward(const Tensor& output_gradient) override {
         if (output_gradient.shape.size() != 2) {
             throw std::runtime_error("DenseLayer expects 2D output gradient");
         }
         
         int batch_size = output_gradient.shape[0];
+
+        // 16-bit mode saved the input in 16 bits. The optimizer updates the
+        // weights after backward, so the packed copy is rebuilt next forward.
+        Tensor input_fp32;
+        if (precision != Half::DType::F32) {
+            Half::convert(half_input, input_fp32);
+            half_stale = true;
+        }
+        const Tensor& input = precision != Half::DType::F32 ? input_fp32 : last_input;
         
-        Tensor last_input_T = transpose(last_input);
-        grad_weights = Tensor::dot(last_input_T, output_gradient);
+        if (accumulate_gradients && grad_weights.shape == weights.shape) {
+            // The sums of input^T . output_gradient, added in place
+            for (int k = 0; k < input_size; ++k) {
+                for (int j = 0; j < output_size; ++j) {
+                    float sum = 0.0f;
+                    for (int i = 0; i < batch_size; ++i) sum += input.at(i, k) * output_gradient.at(i, j);
+                    grad_weights.at(k, j) += sum;
+                }
+            }
+        } else {
+            Tensor last_input_T = transpose(input);
+            grad_weights = Tensor::dot(last_input_T, output_gradient);
+        }
         
-        grad_bias = Tensor({1, output_size});
+        start_gradient(grad_bias, {1, output_size});
         for (int j = 0; j < output_size; ++j) {
             float sum = 0.0f;
             for (int i = 0; i < batch_size; ++i) {
                 sum += output_gradient.at(i, j);
             }
-            grad_bias.data[j] = sum;
+            grad_bias.data[j] += sum;
         }
         
         Tensor weights_T = transpose(weights);
@@ -78,18 +146,30 @@ public:
     }
     
     std::unique_ptr<Layer> clone() const override {
-        auto new_layer = std::make_unique<DenseLayer>(input_size, output_size);
-        new_layer->weights = this->weights;
-        new_layer->bias = this->bias;
-        new_layer->input_size = this->input_size;
-        new_layer->output_size = this->output_size;
-        return new_layer;
+        return std::make_unique<DenseLayer>(*this);
+    }
+
+    void set_precision(Half::DType dtype) override {
+        precision = dtype;
+        half_weights.clear();
+        half_input.clear();
+        last_input = Tensor();
+        half_stale = true;
+    }
+
+    Half::DType get_precision() const { return precision; }
+
+    size_t activation_bytes() const override { return last_input.data.size() * sizeof(float) + half_input.bytes(); }
+
+    void release_activations() override {
+        last_input = Tensor();
+        half_input = Half::HalfTensor();
     }
+
+    void parameters_changed() override { half_stale = true; }
     
     void initialize_xavier() {
-        // ИСПРАВЛЕНО: Правильная инициализация ГСЧ для случайных весов при каждом запуске
-        std::random_device rd;
-        std::mt19937 generator(rd());
+        Random::Stream generator = Random::stream("DenseLayer");
         
         float range = std::sqrt(6.0f / (input_size + output_size));
         std::uniform_real_distribution<float> distribution(-range, range);
@@ -101,12 +181,11 @@ public:
         for (auto& b : bias.data) {
             b = 0.0f;
         }
+        half_stale = true;
     }
     
     void initialize_he() {
-        // ИСПРАВЛЕНО: Правильная инициализация ГСЧ
-        std::random_device rd;
-        std::mt19937 generator(rd());
+        Random::Stream generator = Random::stream("DenseLayer");
 
         float stddev = std::sqrt(2.0f / input_size);
         std::normal_distribution<float> distribution(0.0f, stddev);
@@ -118,6 +197,7 @@ public:
         for (auto& b : bias.data) {
             b = 0.0f;
         }
+        half_stale = true;
     }
     
     Tensor transpose(const Tensor& tensor) const {
@@ -156,10 +236,33 @@ public:
         
         grad_weights = Tensor(weights.shape);
         grad_bias = Tensor(bias.shape);
+        half_stale = true;
     }
     
     std::string get_layer_type() const override { return "DenseLayer"; }
     
+    std::string get_config_string() const override {
+        return "input_size:" + std::to_string(input_size) + ";output_size:" + std::to_string(output_size);
+    }
+
+    void set_config_from_string(const std::string& config) override {
+        input_size = std::stoi(config_value(config, "input_size"));
+        output_size = std::stoi(config_value(config, "output_size"));
+        weights = Tensor({input_size, output_size});
+        bias = Tensor({1, output_size});
+        grad_weights = Tensor(weights.shape);
+        grad_bias = Tensor(bias.shape);
+        half_stale = true;
+    }
+
+    std::vector<Tensor*> parameters() override { return {&weights, &bias}; }
+    std::vector<Tensor*> gradients() override { return {&grad_weights, &grad_bias}; }
+
+    double forward_flops(const std::vector<int>& input_shape, const std::vector<int>& output_shape) const override {
+        (void)output_shape;
+        return 2.0 * input_shape[0] * input_size * output_size;
+    }
+
     std::string get_weights_string() const override {
         std::stringstream ss;
         ss << "input_size:" << input_size << ";output_size:" << output_size << ";";
@@ -186,5 +289,6 @@ public:
         
         grad_weights = Tensor(weights.shape);
         grad_bias = Tensor(bias.shape);
+        half_stale = true;
     }
 };
\ No newline at end of file
@@ -1,22 +1,56 @@
 
 #pragma once
 #include "Layer.h"
-#include <random>
+#include "BitMask.h"
+#include <cmath>
+#include <cstdint>
 #include <vector>
-#include <chrono>
 #include <fstream>
 #include <string>
+#include <sstream>
 
+// Inverted dropout. The keep/drop decisions come from a counter-based
+// Philox stream: element i of training step `step` is decided by the
+// layer's key, the step and i alone, so a mask can be regenerated anywhere
+// and a run is deterministic given the seed and the step. The mask is kept
+// as one bit per element (BitMask.h); forward and backward are one pass each.
+//
+// Elements are taken in groups of 32: Philox counter 8*g + l (l < 8),
+// under substream `step`, gives output words w = 0..3 that decide
+// elements 32*g + 8*w + l. Eight counters fill one AVX2 register per word,
+// so a group needs a single vectorized Philox call.
 class DropoutLayer : public Layer {
 private:
     float rate;
-    Tensor mask;
     bool is_training = true;
-    std::default_random_engine generator;
-public:
-    DropoutLayer(float dropout_rate = 0.5) : rate(dropout_rate) {
-        generator.seed(std::chrono::system_clock::now().time_since_epoch().count());
+    uint64_t key;
+    uint64_t step = 0;                 // training forward calls so far
+    std::vector<uint32_t> mask_bits;   // kept elements, BitMask.h layout
+    size_t mask_size = 0;
+
+    float scale() const { return (rate < 1.0f) ? (1.0f / (1.0f - rate)) : 0.0f; }
+
+    // An element is kept when its 32-bit random word is below this
+    uint32_t keep_threshold() const {
+        if (rate >= 1.0f) return 0;
+        double t = std::ldexp(1.0 - static_cast<double>(rate), 32);
+        return t >= 4294967295.0 ? 0xFFFFFFFFu : static_cast<uint32_t>(t);
+    }
+
+    // Keep bits of group g, scalar version of the layout above
+    static uint32_t group_bits(const Random::Stream& stream, uint64_t g, uint32_t threshold) {
+        uint32_t bits = 0;
+        for (int l = 0; l < 8; ++l) {
+            Random::Philox4x32::Block block = stream.block(8 * g + l);
+            for (int w = 0; w < 4; ++w) {
+                if (block[w] < threshold) bits |= 1u << (8 * w + l);
+            }
+        }
+        return bits;
     }
+
+public:
+    DropoutLayer(float dropout_rate = 0.5) : rate(dropout_rate), key(Random::stream("DropoutLayer").get_key()) {}
     void train() override { is_training = true; }
     void eval() override { is_training = false; }
 
@@ -25,21 +59,65 @@ public:
             return input;
         }
 
-        mask = Tensor(input.shape);
-        std::bernoulli_distribution distribution(1.0f - rate);
-        
-        float scale = (rate < 1.0f) ? (1.0f / (1.0f - rate)) : 0.0f;
-        
-        Tensor output = input;
-        for (size_t i = 0; i < mask.data.size(); ++i) {
-            if (distribution(generator)) {
-                mask.data[i] = 1.0f;
-                output.data[i] *= scale; 
-            } else {
-                mask.data[i] = 0.0f;
-                output.data[i] = 0.0f;
+        const size_t n = input.data.size();
+        const size_t groups = (n + 31) / 32;
+        const float s = scale();
+        const uint32_t threshold = keep_threshold();
+        const Random::Stream stream(key, step++);
+        mask_bits.resize(groups);
+        mask_size = n;
+
+        Tensor output(input.shape);
+        const float* x = input.data.data();
+        float* y = output.data.data();
+        size_t g = 0;
+#if defined(__AVX2__)
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i sign = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+        const __m256i limit = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(threshold)), sign);
+        const __m256 vscale = _mm256_set1_ps(s);
+        const uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+        const __m256i sub_lo = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream.get_substream())));
+        const __m256i sub_hi = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream.get_substream() >> 32)));
+        for (; g < groups; ++g) {
+            const uint64_t first = 8 * g;
+            __m256i c[4] = {_mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(first))), lane),
+                            _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(first >> 32))), sub_lo, sub_hi};
+            Random::Philox4x32::generate8(c, k0, k1);
+            uint32_t bits = 0;
+            __m256 keep[4];
+            for (int w = 0; w < 4; ++w) {
+                // unsigned c < threshold, as a signed compare with flipped sign bits
+                keep[w] = _mm256_castsi256_ps(_mm256_cmpgt_epi32(limit, _mm256_xor_si256(c[w], sign)));
+                bits |= static_cast<uint32_t>(_mm256_movemask_ps(keep[w])) << (8 * w);
+            }
+            const size_t base = 32 * g;
+            if (base + 32 > n) {
+                mask_bits[g] = bits & ((1u << (n - base)) - 1);
+                break;
+            }
+            mask_bits[g] = bits;
+            for (int w = 0; w < 4; ++w) {
+                __m256 v = _mm256_mul_ps(_mm256_loadu_ps(x + base + 8 * w), vscale);
+                _mm256_storeu_ps(y + base + 8 * w, _mm256_and_ps(v, keep[w]));
             }
         }
+#else
+        for (; g < groups; ++g) {
+            const size_t base = 32 * g;
+            uint32_t bits = group_bits(stream, g, threshold);
+            if (base + 32 > n) {
+                mask_bits[g] = bits & ((1u << (n - base)) - 1);
+                break;
+            }
+            mask_bits[g] = bits;
+            for (size_t j = 0; j < 32; ++j) y[base + j] = (bits >> j & 1u) ? x[base + j] * s : 0.0f;
+        }
+#endif
+        // Partial last group
+        for (size_t i = 32 * g; i < n; ++i) {
+            y[i] = BitMask::test(mask_bits.data(), i) ? x[i] * s : 0.0f;
+        }
         return output;
     }
 
@@ -47,20 +125,30 @@ public:
         if (!is_training || rate == 0.0f) {
             return output_gradient;
         }
-        
-        Tensor input_gradient = output_gradient;
-        float scale = (rate < 1.0f) ? (1.0f / (1.0f - rate)) : 0.0f;
-        
-        for (size_t i = 0; i < input_gradient.data.size(); ++i) {
-            input_gradient.data[i] *= mask.data[i] * scale;
+        const size_t n = output_gradient.data.size();
+        if (n != mask_size) {
+            throw std::runtime_error("DropoutLayer::backward: gradient size does not match the last forward pass");
         }
+
+        Tensor input_gradient(output_gradient.shape);
+        BitMask::apply(mask_bits.data(), output_gradient.data.data(), input_gradient.data.data(), n, scale());
         return input_gradient;
     }
-    
+
+    // Keep bits of the last training forward pass (bit i%32 of word i/32)
+    const std::vector<uint32_t>& get_mask_bits() const { return mask_bits; }
+
     std::unique_ptr<Layer> clone() const override { 
         return std::make_unique<DropoutLayer>(*this); 
     }
 
+    size_t activation_bytes() const override { return mask_bits.size() * sizeof(uint32_t); }
+
+    void release_activations() override {
+        std::vector<uint32_t>().swap(mask_bits);
+        mask_size = 0;
+    }
+
     void save_weights(const std::string& filename) const override {
         std::ofstream file(filename + "_dropout.meta");
         file << rate;
@@ -79,6 +167,33 @@ public:
     std::string get_layer_type() const override { return "DropoutLayer"; }
 
     std::string get_weights_string() const override { return "rate:" + std::to_string(rate); }
+
+    std::string get_config_string() const override {
+        std::ostringstream ss;
+        ss.precision(9);
+        ss << "rate:" << rate;
+        return ss.str();
+    }
+
+    void set_config_from_string(const std::string& config) override {
+        rate = std::stof(config_value(config, "rate"));
+    }
+
+    // The mask of every step is a function of the key and the step number
+    std::string get_rng_state() const override {
+        std::ostringstream ss;
+        ss << key << ' ' << step;
+        return ss.str();
+    }
+
+    void set_rng_state(const std::string& state) override {
+        std::istringstream ss(state);
+        uint64_t k, s;
+        if (ss >> k >> s) {
+            key = k;
+            step = s;
+        }
+    }
     
     void set_weights_from_string(const std::string& data) override {
         size_t pos = data.find("rate:");
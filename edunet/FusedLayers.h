@@ -0,0 +1,366 @@
+#pragma once
+#include "DenseLayer.h"
+#include "Conv2DLayer.h"
+#include "MaxPooling2DLayer.h"
+#include "BitMask.h"
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+// Layers produced by Sequential::fuse(). Each one replaces a run of layers
+// and applies the bias, the ReLU and the pooling while the data is still in
+// cache, without storing the intermediate tensors. They derive from the
+// layer they fuse, so optimizers, serialization and 16-bit mode treat their
+// parameters exactly as before. Every output and gradient element is summed
+// in the same order as in the unfused layers, so results match them bit for
+// bit (barring differently contracted multiply-adds).
+
+// DenseLayer + ReLULayer
+class FusedDenseLayer : public DenseLayer {
+private:
+    std::vector<uint32_t> mask;   // where the ReLU output is positive (BitMask.h)
+
+public:
+    FusedDenseLayer() = default;
+    explicit FusedDenseLayer(const DenseLayer& dense) : DenseLayer(dense) {}
+
+    Tensor forward(const Tensor& input) override {
+        Tensor output;
+        if (precision != Half::DType::F32) {
+            output = DenseLayer::forward(input);
+            relu(output.data.data(), output.data.size());
+        } else {
+            last_input = input;
+            forward_fp32(input, output);
+        }
+        mask.resize(BitMask::words(output.data.size()));
+        BitMask::pack_positive(output.data.data(), output.data.size(), mask.data());
+        return output;
+    }
+
+    void forward_into(const Tensor& input, Tensor& output) override {
+        if (precision != Half::DType::F32) {
+            DenseLayer::forward_into(input, output);
+            relu(output.data.data(), output.data.size());
+            return;
+        }
+        forward_fp32(input, output);
+    }
+
+    Tensor backward(const Tensor& output_gradient) override {
+        if (BitMask::words(output_gradient.data.size()) != mask.size()) {
+            throw std::runtime_error("FusedDenseLayer::backward: gradient size does not match the last forward pass");
+        }
+        Tensor gradient(output_gradient.shape);
+        BitMask::apply(mask.data(), output_gradient.data.data(), gradient.data.data(), gradient.data.size());
+        if (precision != Half::DType::F32) return DenseLayer::backward(gradient);
+
+        const int batch_size = gradient.shape[0];
+        const float* x = last_input.data.data();
+        const float* g = gradient.data.data();
+        const float* w = weights.data.data();
+
+        // grad_weights = x^T g and grad_bias = column sums of g, both summed over the batch in order
+        start_gradient(grad_weights, {input_size, output_size});
+        start_gradient(grad_bias, {1, output_size});
+        float* gw = grad_weights.data.data();
+        for (int i = 0; i < batch_size; ++i) {
+            const float* g_row = g + i * output_size;
+            for (int k = 0; k < input_size; ++k) {
+                const float a = x[i * input_size + k];
+                float* gw_row = gw + k * output_size;
+                for (int j = 0; j < output_size; ++j) gw_row[j] += a * g_row[j];
+            }
+            for (int j = 0; j < output_size; ++j) grad_bias.data[j] += g_row[j];
+        }
+
+        // input gradient = g w^T
+        Tensor input_gradient({batch_size, input_size});
+        for (int i = 0; i < batch_size; ++i) {
+            const float* g_row = g + i * output_size;
+            float* out = input_gradient.data.data() + i * input_size;
+            for (int k = 0; k < input_size; ++k) {
+                const float* w_row = w + k * output_size;
+                float sum = 0.0f;
+                for (int j = 0; j < output_size; ++j) sum += g_row[j] * w_row[j];
+                out[k] = sum;
+            }
+        }
+        return input_gradient;
+    }
+
+    std::unique_ptr<Layer> clone() const override { return std::make_unique<FusedDenseLayer>(*this); }
+
+    size_t activation_bytes() const override { return DenseLayer::activation_bytes() + mask.size() * sizeof(uint32_t); }
+
+    void release_activations() override {
+        DenseLayer::release_activations();
+        std::vector<uint32_t>().swap(mask);
+    }
+
+    std::string get_layer_type() const override { return "FusedDenseLayer"; }
+
+    double forward_flops(const std::vector<int>& input_shape, const std::vector<int>& output_shape) const override {
+        return DenseLayer::forward_flops(input_shape, output_shape) + Layer::forward_flops(input_shape, output_shape);
+    }
+
+private:
+    static void relu(float* v, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            if (v[i] < 0) v[i] = 0;
+        }
+    }
+
+    // Each output row is accumulated, then the bias and ReLU are applied
+    // while the row is still in L1
+    void forward_fp32(const Tensor& input, Tensor& output) const {
+        if (input.shape.size() != 2) throw std::runtime_error("DenseLayer expects 2D input");
+        if (input.shape[1] != input_size) throw std::runtime_error("Input size mismatch in DenseLayer");
+        const int batch_size = input.shape[0];
+        output.resize({batch_size, output_size});
+        const float* w = weights.data.data();
+        const float* b = bias.data.data();
+        for (int i = 0; i < batch_size; ++i) {
+            const float* in_row = input.data.data() + i * input_size;
+            float* out_row = output.data.data() + i * output_size;
+            std::fill(out_row, out_row + output_size, 0.0f);
+            for (int k = 0; k < input_size; ++k) {
+                const float a = in_row[k];
+                const float* w_row = w + k * output_size;
+                for (int j = 0; j < output_size; ++j) out_row[j] += a * w_row[j];
+            }
+            for (int j = 0; j < output_size; ++j) {
+                float v = out_row[j] + b[j];
+                out_row[j] = v < 0 ? 0.0f : v;
+            }
+        }
+    }
+};
+
+// Conv2DLayer + ReLULayer, optionally followed by MaxPooling2DLayer
+class FusedConv2DLayer : public Conv2DLayer {
+private:
+    int pool_size = 0;      // 0: no pooling
+    int pool_stride = 0;
+    std::vector<uint32_t> mask;         // where the post-ReLU (and pooled) output is positive
+    std::vector<int> conv_shape;
+    std::vector<uint8_t> argmax;        // per pooled output, offset within its window
+    std::vector<float> conv_buffer;     // one sample's convolution output
+
+public:
+    FusedConv2DLayer() = default;
+    FusedConv2DLayer(const Conv2DLayer& conv, int pool = 0, int pool_s = 0)
+        : Conv2DLayer(conv), pool_size(pool), pool_stride(pool ? pool_s : 0) {}
+
+    Tensor forward(const Tensor& input) override {
+        const int N = input.shape[0], H_in = input.shape[2], W_in = input.shape[3];
+        const int H_out = (H_in + 2 * padding - kernel_size) / stride + 1;
+        const int W_out = (W_in + 2 * padding - kernel_size) / stride + 1;
+        conv_shape = {N, out_channels, H_out, W_out};
+        Tensor output(pool_size ? std::vector<int>{N, out_channels, (H_out - pool_size) / pool_stride + 1,
+                                                   (W_out - pool_size) / pool_stride + 1}
+                                : conv_shape);
+        argmax.resize(pool_size ? output.data.size() : 0);
+        const size_t plane = static_cast<size_t>(out_channels) * H_out * W_out;
+
+        if (precision != Half::DType::F32) {
+            Tensor conv = Conv2DLayer::forward(input);
+            for (int n = 0; n < N; ++n) epilogue(conv.data.data() + n * plane, n, output);
+        } else {
+            if (input.shape[1] != in_channels) throw std::runtime_error("Input channel mismatch in Conv2DLayer");
+            last_input = input;
+            conv_buffer.resize(plane);
+            for (int n = 0; n < N; ++n) {
+                convolve(input, n, conv_buffer.data());
+                epilogue(conv_buffer.data(), n, output);
+            }
+        }
+        mask.resize(BitMask::words(output.data.size()));
+        BitMask::pack_positive(output.data.data(), output.data.size(), mask.data());
+        return output;
+    }
+
+    Tensor backward(const Tensor& output_gradient) override {
+        // Gradient at the convolution output: routed through the pooling
+        // argmax and masked where the ReLU was inactive
+        if (BitMask::words(output_gradient.data.size()) != mask.size()) {
+            throw std::runtime_error("FusedConv2DLayer::backward: gradient size does not match the last forward pass");
+        }
+        Tensor conv_gradient(conv_shape);
+        if (pool_size) {
+            Tensor pooled_gradient(output_gradient.shape);
+            BitMask::apply(mask.data(), output_gradient.data.data(), pooled_gradient.data.data(), pooled_gradient.data.size());
+            MaxPooling2DLayer::unpool_planes(pooled_gradient.data.data(), argmax.data(),
+                                             static_cast<size_t>(conv_shape[0]) * conv_shape[1], conv_shape[2],
+                                             conv_shape[3], pool_size, pool_stride, conv_gradient.data.data());
+        } else {
+            BitMask::apply(mask.data(), output_gradient.data.data(), conv_gradient.data.data(), conv_gradient.data.size());
+        }
+        if (precision != Half::DType::F32) return Conv2DLayer::backward(conv_gradient);
+        return backward_fp32(conv_gradient);
+    }
+
+    std::unique_ptr<Layer> clone() const override { return std::make_unique<FusedConv2DLayer>(*this); }
+
+    size_t activation_bytes() const override {
+        return Conv2DLayer::activation_bytes() + mask.size() * sizeof(uint32_t) + argmax.size() * sizeof(uint8_t);
+    }
+
+    void release_activations() override {
+        Conv2DLayer::release_activations();
+        std::vector<uint32_t>().swap(mask);
+        std::vector<uint8_t>().swap(argmax);
+        std::vector<float>().swap(conv_buffer);
+    }
+
+    std::string get_layer_type() const override { return "FusedConv2DLayer"; }
+
+    double forward_flops(const std::vector<int>& input_shape, const std::vector<int>& output_shape) const override {
+        // Convolution, ReLU over its output, then pool_size^2 compares per pooled value
+        const int h_out = (input_shape[2] + 2 * padding - kernel_size) / stride + 1;
+        const int w_out = (input_shape[3] + 2 * padding - kernel_size) / stride + 1;
+        double flops = Conv2DLayer::forward_flops(input_shape, output_shape) + double(input_shape[0]) * out_channels * h_out * w_out;
+        if (pool_size) flops += Layer::forward_flops(input_shape, output_shape) * pool_size * pool_size;
+        return flops;
+    }
+
+    int get_pool_size() const { return pool_size; }
+    int get_pool_stride() const { return pool_stride; }
+
+    std::string get_config_string() const override {
+        return Conv2DLayer::get_config_string() + ";pool_size:" + std::to_string(pool_size) +
+               ";pool_stride:" + std::to_string(pool_stride);
+    }
+
+    void set_config_from_string(const std::string& config) override {
+        Conv2DLayer::set_config_from_string(config);
+        pool_size = std::stoi(config_value(config, "pool_size"));
+        pool_stride = std::stoi(config_value(config, "pool_stride"));
+    }
+
+    std::string get_weights_string() const override {
+        return Conv2DLayer::get_weights_string() + ";pool_size:" + std::to_string(pool_size) +
+               ";pool_stride:" + std::to_string(pool_stride);
+    }
+
+    void set_weights_from_string(const std::string& data) override {
+        Conv2DLayer::set_weights_from_string(data);
+        pool_size = std::stoi(config_value(data, "pool_size"));
+        pool_stride = std::stoi(config_value(data, "pool_stride"));
+    }
+
+private:
+    // Convolution of sample n into y, starting from the bias. Loops are
+    // ordered for contiguous inner rows, but every output still adds its
+    // terms in (c_in, kh, kw) order like Conv2DLayer::forward.
+    void convolve(const Tensor& input, int n, float* y) const {
+        const int H_in = input.shape[2], W_in = input.shape[3];
+        const int H_out = conv_shape[2], W_out = conv_shape[3];
+        const float* x = input.data.data() + static_cast<size_t>(n) * in_channels * H_in * W_in;
+        const float* k = kernels.data.data();
+        for (int co = 0; co < out_channels; ++co) {
+            float* y_plane = y + static_cast<size_t>(co) * H_out * W_out;
+            std::fill(y_plane, y_plane + H_out * W_out, biases.data[co]);
+            for (int ci = 0; ci < in_channels; ++ci) {
+                for (int kh = 0; kh < kernel_size; ++kh) {
+                    for (int kw = 0; kw < kernel_size; ++kw) {
+                        const float wv = k[((co * in_channels + ci) * kernel_size + kh) * kernel_size + kw];
+                        int w_lo = 0, w_hi = W_out;
+                        while (w_lo < W_out && w_lo * stride + kw - padding < 0) ++w_lo;
+                        while (w_hi > w_lo && (w_hi - 1) * stride + kw - padding >= W_in) --w_hi;
+                        for (int h = 0; h < H_out; ++h) {
+                            const int h_in = h * stride + kh - padding;
+                            if (h_in < 0 || h_in >= H_in) continue;
+                            const float* in_row = x + (ci * H_in + h_in) * W_in + kw - padding;
+                            float* out_row = y_plane + h * W_out;
+                            for (int w = w_lo; w < w_hi; ++w) out_row[w] += in_row[w * stride] * wv;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // ReLU, then pooling, of sample n's convolution output
+    void epilogue(float* conv, int n, Tensor& output) {
+        const int C = conv_shape[1], H = conv_shape[2], W = conv_shape[3];
+        const size_t plane = static_cast<size_t>(C) * H * W;
+        for (size_t i = 0; i < plane; ++i) {
+            if (conv[i] < 0) conv[i] = 0;
+        }
+        if (!pool_size) {
+            std::copy(conv, conv + plane, output.data.data() + n * plane);
+            return;
+        }
+        const size_t offset = static_cast<size_t>(n) * C * output.shape[2] * output.shape[3];
+        MaxPooling2DLayer::pool_planes(conv, C, H, W, pool_size, pool_stride, output.data.data() + offset,
+                                       argmax.data() + offset);
+    }
+
+    // Conv2DLayer::backward from the convolution-output gradient, visiting
+    // only its non-zero entries (most are zero after ReLU and pooling).
+    // Adding a zero product never changes an accumulated sum, and every
+    // element accumulates in the same order as the unfused loops.
+    Tensor backward_fp32(const Tensor& g) {
+        const int N = conv_shape[0], H_out = conv_shape[2], W_out = conv_shape[3];
+        const int H_in = last_input.shape[2], W_in = last_input.shape[3];
+        const int K = kernel_size;
+        Tensor input_gradient(last_input.shape);
+        start_gradient(grad_kernels, kernels.shape);
+        start_gradient(grad_biases, biases.shape);
+        const float* k = kernels.data.data();
+        float* gk = grad_kernels.data.data();
+
+        struct Entry { int h, w; float g; };
+        std::vector<Entry> active;
+        for (int n = 0; n < N; ++n) {
+            const float* x = last_input.data.data() + static_cast<size_t>(n) * in_channels * H_in * W_in;
+            float* gx = input_gradient.data.data() + static_cast<size_t>(n) * in_channels * H_in * W_in;
+            for (int co = 0; co < out_channels; ++co) {
+                const float* g_plane = g.data.data() + (static_cast<size_t>(n) * out_channels + co) * H_out * W_out;
+                active.clear();
+                for (int h = 0; h < H_out; ++h) {
+                    for (int w = 0; w < W_out; ++w) {
+                        float v = g_plane[h * W_out + w];
+                        grad_biases.data[co] += v;
+                        if (v != 0.0f) active.push_back({h, w, v});
+                    }
+                }
+                if (active.empty()) continue;
+
+                for (int ci = 0; ci < in_channels; ++ci) {
+                    const float* x_plane = x + static_cast<size_t>(ci) * H_in * W_in;
+                    const size_t k_base = static_cast<size_t>(co * in_channels + ci) * K * K;
+                    for (int kh = 0; kh < K; ++kh) {
+                        for (int kw = 0; kw < K; ++kw) {
+                            float acc = gk[k_base + kh * K + kw];
+                            for (const Entry& e : active) {
+                                int h_in = e.h * stride + kh - padding;
+                                int w_in = e.w * stride + kw - padding;
+                                if (h_in >= 0 && h_in < H_in && w_in >= 0 && w_in < W_in) acc += x_plane[h_in * W_in + w_in] * e.g;
+                            }
+                            gk[k_base + kh * K + kw] = acc;
+                        }
+                    }
+                }
+                // Input gradient elements receive their terms ordered by
+                // output position, as in the unfused loops
+                for (const Entry& e : active) {
+                    for (int ci = 0; ci < in_channels; ++ci) {
+                        float* gx_plane = gx + static_cast<size_t>(ci) * H_in * W_in;
+                        const float* k_ci = k + static_cast<size_t>(co * in_channels + ci) * K * K;
+                        for (int kh = 0; kh < K; ++kh) {
+                            int h_in = e.h * stride + kh - padding;
+                            if (h_in < 0 || h_in >= H_in) continue;
+                            for (int kw = 0; kw < K; ++kw) {
+                                int w_in = e.w * stride + kw - padding;
+                                if (w_in >= 0 && w_in < W_in) gx_plane[h_in * W_in + w_in] += k_ci[kh * K + kw] * e.g;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return input_gradient;
+    }
+};
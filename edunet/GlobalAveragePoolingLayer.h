@@ -0,0 +1,79 @@
+#pragma once
+#include "Layer.h"
+#include "VectorOps.h"
+#include <vector>
+#include <fstream>
+
+// Mean of every channel over all positions: {N, C, H, W} -> {N, C}. Put
+// after the last convolution, it feeds a Dense head whose size depends on
+// the channel count only, not on the input size. Only the input shape is
+// kept for backward, which broadcasts each gradient over its plane.
+class GlobalAveragePoolingLayer : public Layer {
+private:
+    std::vector<int> last_input_shape;
+
+    static size_t plane_size(const std::vector<int>& shape) {
+        size_t n = 1;
+        for (size_t d = 2; d < shape.size(); ++d) n *= shape[d];
+        return n;
+    }
+
+public:
+    Tensor forward(const Tensor& input) override {
+        Tensor output;
+        forward_into(input, output);
+        last_input_shape = input.shape;
+        return output;
+    }
+
+    void forward_into(const Tensor& input, Tensor& output) override {
+        if (input.shape.size() < 3) {
+            throw std::runtime_error("GlobalAveragePoolingLayer expects an N x C x H x W input");
+        }
+        const int N = input.shape[0], C = input.shape[1];
+        const size_t plane = plane_size(input.shape);
+        output.resize({N, C});
+        const float scale = 1.0f / static_cast<float>(plane);
+        for (size_t i = 0; i < static_cast<size_t>(N) * C; ++i) {
+            output.data[i] = VectorOps::sum(input.data.data() + i * plane, plane) * scale;
+        }
+    }
+
+    Tensor backward(const Tensor& output_gradient) override {
+        if (last_input_shape.size() < 3 ||
+            output_gradient.shape != std::vector<int>{last_input_shape[0], last_input_shape[1]}) {
+            throw std::runtime_error("GlobalAveragePoolingLayer::backward: gradient shape does not match the last forward pass");
+        }
+        Tensor input_gradient(last_input_shape);
+        const size_t plane = plane_size(last_input_shape);
+        const float scale = 1.0f / static_cast<float>(plane);
+        for (size_t i = 0; i < output_gradient.data.size(); ++i) {
+            float* dst = input_gradient.data.data() + i * plane;
+            std::fill(dst, dst + plane, output_gradient.data[i] * scale);
+        }
+        return input_gradient;
+    }
+
+    std::unique_ptr<Layer> clone() const override { return std::make_unique<GlobalAveragePoolingLayer>(*this); }
+
+    double forward_flops(const std::vector<int>& input_shape, const std::vector<int>& output_shape) const override {
+        (void)output_shape;
+        double n = 1.0;
+        for (int d : input_shape) n *= d;
+        return n;
+    }
+
+    void save_weights(const std::string& filename) const override {
+        std::ofstream file(filename + "_gap.meta", std::ios::binary);
+        file << "GlobalAveragePoolingLayer";
+        file.close();
+    }
+
+    void load_weights(const std::string& filename) override { (void)filename; }
+
+    std::string get_layer_type() const override { return "GlobalAveragePoolingLayer"; }
+
+    std::string get_weights_string() const override { return "GlobalAveragePoolingLayer_no_weights"; }
+
+    void set_weights_from_string(const std::string& data) override { (void)data; }
+};
@@ -0,0 +1,299 @@
+#pragma once
+#include "Layer.h"
+#include "VectorOps.h"
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Grouped 2D convolution: input and output channels are split into `groups`
+// equal parts and output group g only sees input group g, so the kernels
+// are out_channels x (in_channels / groups) x k x k. With groups ==
+// in_channels it is a depthwise convolution; followed by a 1x1 Conv2DLayer
+// (pointwise, which Conv2DLayer runs as a GEMM) it replaces a dense k x k
+// convolution at about 1/out_channels + 1/k^2 of its FLOPs (MobileNet).
+//
+// Each sample is copied into a zero-padded buffer first, so the loops run
+// over whole output rows without bounds checks. A depthwise layer with
+// stride 1 keeps eight outputs in an AVX2 register across all k*k taps;
+// other shapes accumulate output rows in place. Every output adds its terms
+// in (c_in, kh, kw) order after the bias, as Conv2DLayer does.
+class GroupedConv2DLayer : public Layer {
+public:
+    Tensor kernels;
+    Tensor biases;
+    Tensor grad_kernels;
+    Tensor grad_biases;
+
+private:
+    int in_channels = 0, out_channels = 0;
+    int kernel_size = 0, stride = 1, padding = 0, groups = 1;
+    Tensor last_input;
+    std::vector<float> padded;         // one sample's input with the zero border
+    std::vector<float> padded_grad;    // its gradient, in backward
+
+public:
+    GroupedConv2DLayer(int input_channels, int output_channels, int k_size, int s = 1, int p = 0, int num_groups = 1)
+        : in_channels(input_channels), out_channels(output_channels), kernel_size(k_size), stride(s), padding(p),
+          groups(num_groups) {
+        check_groups();
+        allocate();
+
+        // Xavier initialization over the channels one output actually sees
+        Random::Stream generator = Random::stream("GroupedConv2DLayer");
+        const int taps = kernel_size * kernel_size;
+        float range = std::sqrt(6.0f / ((in_channels / groups) * taps + (out_channels / groups) * taps));
+        std::uniform_real_distribution<float> distribution(-range, range);
+        for (auto& w : kernels.data) w = distribution(generator);
+    }
+    GroupedConv2DLayer() = default;
+
+    Tensor forward(const Tensor& input) override {
+        Tensor output;
+        convolve(input, output);
+        last_input = input;
+        return output;
+    }
+
+    void forward_into(const Tensor& input, Tensor& output) override { convolve(input, output); }
+
+    Tensor backward(const Tensor& output_gradient) override {
+        if (last_input.shape.size() != 4 || output_gradient.shape.size() != 4 || output_gradient.shape[1] != out_channels) {
+            throw std::runtime_error("GroupedConv2DLayer::backward: gradient does not match the last forward pass");
+        }
+        const int N = last_input.shape[0], H_in = last_input.shape[2], W_in = last_input.shape[3];
+        const int H_out = output_gradient.shape[2], W_out = output_gradient.shape[3];
+        const int K = kernel_size, Wp = W_in + 2 * padding;
+        const size_t plane_p = static_cast<size_t>(H_in + 2 * padding) * Wp;
+        const int in_per_group = in_channels / groups, out_per_group = out_channels / groups;
+        Tensor input_gradient(last_input.shape);
+        start_gradient(grad_kernels, kernels.shape);
+        start_gradient(grad_biases, biases.shape);
+        const float* k = kernels.data.data();
+        float* gk = grad_kernels.data.data();
+
+        const size_t in_sample = static_cast<size_t>(in_channels) * H_in * W_in;
+        const size_t out_plane = static_cast<size_t>(H_out) * W_out;
+        for (int n = 0; n < N; ++n) {
+            pad(last_input.data.data() + n * in_sample, H_in, W_in);
+            padded_grad.assign(padded.size(), 0.0f);
+            for (int co = 0; co < out_channels; ++co) {
+                const float* g = output_gradient.data.data() + (static_cast<size_t>(n) * out_channels + co) * out_plane;
+                grad_biases.data[co] += VectorOps::sum(g, out_plane);
+                const int first_in = co / out_per_group * in_per_group;
+                for (int ci = 0; ci < in_per_group; ++ci) {
+                    const float* x = padded.data() + (first_in + ci) * plane_p;
+                    float* gx = padded_grad.data() + (first_in + ci) * plane_p;
+                    const size_t k_base = (static_cast<size_t>(co) * in_per_group + ci) * K * K;
+                    for (int kh = 0; kh < K; ++kh) {
+                        for (int kw = 0; kw < K; ++kw) {
+                            const float wv = k[k_base + kh * K + kw];
+                            float acc = 0.0f;
+                            for (int h = 0; h < H_out; ++h) {
+                                const float* g_row = g + h * W_out;
+                                const size_t offset = static_cast<size_t>(h * stride + kh) * Wp + kw;
+                                float* gx_row = gx + offset;
+                                if (stride == 1) {
+                                    acc += VectorOps::dot(x + offset, g_row, W_out);
+                                    for (int w = 0; w < W_out; ++w) gx_row[w] += wv * g_row[w];
+                                } else {
+                                    const float* x_row = x + offset;
+                                    for (int w = 0; w < W_out; ++w) {
+                                        acc += x_row[w * stride] * g_row[w];
+                                        gx_row[w * stride] += wv * g_row[w];
+                                    }
+                                }
+                            }
+                            gk[k_base + kh * K + kw] += acc;
+                        }
+                    }
+                }
+            }
+            // Drop the border of the padded gradient
+            float* gx = input_gradient.data.data() + n * in_sample;
+            for (int c = 0; c < in_channels; ++c) {
+                for (int h = 0; h < H_in; ++h) {
+                    const float* src = padded_grad.data() + c * plane_p + static_cast<size_t>(h + padding) * Wp + padding;
+                    std::memcpy(gx + (static_cast<size_t>(c) * H_in + h) * W_in, src, W_in * sizeof(float));
+                }
+            }
+        }
+        return input_gradient;
+    }
+
+    std::unique_ptr<Layer> clone() const override { return std::make_unique<GroupedConv2DLayer>(*this); }
+
+    size_t activation_bytes() const override { return last_input.data.size() * sizeof(float); }
+
+    void release_activations() override {
+        last_input = Tensor();
+        std::vector<float>().swap(padded);
+        std::vector<float>().swap(padded_grad);
+    }
+
+    int get_groups() const { return groups; }
+    bool is_depthwise() const { return groups == in_channels; }
+
+    double forward_flops(const std::vector<int>& input_shape, const std::vector<int>& output_shape) const override {
+        (void)output_shape;
+        const int h_out = (input_shape[2] + 2 * padding - kernel_size) / stride + 1;
+        const int w_out = (input_shape[3] + 2 * padding - kernel_size) / stride + 1;
+        return 2.0 * input_shape[0] * out_channels * h_out * w_out * (in_channels / groups) * kernel_size * kernel_size;
+    }
+
+    void save_weights(const std::string& filename) const override {
+        std::ofstream meta_file(filename + "_grouped_conv2d.meta");
+        meta_file << in_channels << " " << out_channels << " " << kernel_size << " " << stride << " " << padding << " " << groups;
+        meta_file.close();
+        kernels.save_to_file(filename + "_kernels.bin");
+        biases.save_to_file(filename + "_biases.bin");
+    }
+
+    void load_weights(const std::string& filename) override {
+        std::ifstream meta_file(filename + "_grouped_conv2d.meta");
+        if (!meta_file) throw std::runtime_error("Cannot open meta file: " + filename + "_grouped_conv2d.meta");
+        meta_file >> in_channels >> out_channels >> kernel_size >> stride >> padding >> groups;
+        meta_file.close();
+        check_groups();
+        allocate();
+        kernels.load_from_file(filename + "_kernels.bin");
+        biases.load_from_file(filename + "_biases.bin");
+    }
+
+    std::string get_layer_type() const override { return "GroupedConv2DLayer"; }
+
+    std::string get_config_string() const override {
+        std::stringstream ss;
+        ss << "in_channels:" << in_channels << ";out_channels:" << out_channels << ";kernel_size:" << kernel_size
+           << ";stride:" << stride << ";padding:" << padding << ";groups:" << groups;
+        return ss.str();
+    }
+
+    void set_config_from_string(const std::string& config) override {
+        in_channels = std::stoi(config_value(config, "in_channels"));
+        out_channels = std::stoi(config_value(config, "out_channels"));
+        kernel_size = std::stoi(config_value(config, "kernel_size"));
+        stride = std::stoi(config_value(config, "stride"));
+        padding = std::stoi(config_value(config, "padding"));
+        groups = std::stoi(config_value(config, "groups"));
+        check_groups();
+        allocate();
+    }
+
+    std::vector<Tensor*> parameters() override { return {&kernels, &biases}; }
+    std::vector<Tensor*> gradients() override { return {&grad_kernels, &grad_biases}; }
+
+    std::string get_weights_string() const override {
+        return get_config_string() + ";kernels:" + kernels.to_string() + ";biases:" + biases.to_string();
+    }
+
+    void set_weights_from_string(const std::string& data) override {
+        set_config_from_string(data);
+        kernels.from_string(config_value(data, "kernels"));
+        biases.from_string(config_value(data, "biases"));
+    }
+
+private:
+    void check_groups() const {
+        if (groups < 1 || in_channels % groups || out_channels % groups) {
+            throw std::runtime_error("GroupedConv2DLayer: " + std::to_string(groups) + " groups do not divide " +
+                                     std::to_string(in_channels) + " input and " + std::to_string(out_channels) + " output channels");
+        }
+    }
+
+    void allocate() {
+        kernels = Tensor({out_channels, in_channels / groups, kernel_size, kernel_size});
+        biases = Tensor({out_channels});
+        grad_kernels = Tensor(kernels.shape);
+        grad_biases = Tensor(biases.shape);
+    }
+
+    // One sample's channels into `padded`, with a border of `padding` zeros
+    void pad(const float* x, int H_in, int W_in) {
+        const int Hp = H_in + 2 * padding, Wp = W_in + 2 * padding;
+        padded.assign(static_cast<size_t>(in_channels) * Hp * Wp, 0.0f);
+        for (int c = 0; c < in_channels; ++c) {
+            for (int h = 0; h < H_in; ++h) {
+                std::memcpy(padded.data() + (static_cast<size_t>(c) * Hp + h + padding) * Wp + padding,
+                            x + (static_cast<size_t>(c) * H_in + h) * W_in, W_in * sizeof(float));
+            }
+        }
+    }
+
+    void convolve(const Tensor& input, Tensor& output) {
+        if (input.shape.size() != 4 || input.shape[1] != in_channels) {
+            throw std::runtime_error("GroupedConv2DLayer expects an N x " + std::to_string(in_channels) + " x H x W input");
+        }
+        const int N = input.shape[0], H_in = input.shape[2], W_in = input.shape[3];
+        const int H_out = (H_in + 2 * padding - kernel_size) / stride + 1;
+        const int W_out = (W_in + 2 * padding - kernel_size) / stride + 1;
+        output.resize({N, out_channels, H_out, W_out});
+        const size_t in_sample = static_cast<size_t>(in_channels) * H_in * W_in;
+        const size_t out_plane = static_cast<size_t>(H_out) * W_out;
+        for (int n = 0; n < N; ++n) {
+            pad(input.data.data() + n * in_sample, H_in, W_in);
+            for (int co = 0; co < out_channels; ++co) {
+                convolve_channel(co, H_in, W_in, H_out, W_out, output.data.data() + (static_cast<size_t>(n) * out_channels + co) * out_plane);
+            }
+        }
+    }
+
+    // Output channel co of the sample in `padded`
+    void convolve_channel(int co, int H_in, int W_in, int H_out, int W_out, float* y) const {
+        const int K = kernel_size, Wp = W_in + 2 * padding;
+        const size_t plane_p = static_cast<size_t>(H_in + 2 * padding) * Wp;
+        const int in_per_group = in_channels / groups;
+        const int first_in = co / (out_channels / groups) * in_per_group;
+        const float* k = kernels.data.data() + static_cast<size_t>(co) * in_per_group * K * K;
+        const float bias = biases.data[co];
+
+        if (in_per_group == 1 && stride == 1) {
+            const float* x = padded.data() + first_in * plane_p;
+            for (int h = 0; h < H_out; ++h) depthwise_row(x + static_cast<size_t>(h) * Wp, Wp, k, bias, y + h * W_out, W_out);
+            return;
+        }
+        for (int h = 0; h < H_out; ++h) {
+            float* row = y + h * W_out;
+            std::fill(row, row + W_out, bias);
+            for (int ci = 0; ci < in_per_group; ++ci) {
+                const float* x = padded.data() + (first_in + ci) * plane_p;
+                for (int kh = 0; kh < K; ++kh) {
+                    const float* in_row = x + static_cast<size_t>(h * stride + kh) * Wp;
+                    for (int kw = 0; kw < K; ++kw) {
+                        const float wv = k[(ci * K + kh) * K + kw];
+                        for (int w = 0; w < W_out; ++w) row[w] += in_row[w * stride + kw] * wv;
+                    }
+                }
+            }
+        }
+    }
+
+    // One output row of a stride-1 depthwise convolution; `x` is the first
+    // of the K padded input rows it reads
+    void depthwise_row(const float* x, int Wp, const float* k, float bias, float* out, int W_out) const {
+        const int K = kernel_size;
+        int w = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+        for (; w + 8 <= W_out; w += 8) {
+            __m256 acc = _mm256_set1_ps(bias);
+            for (int kh = 0; kh < K; ++kh) {
+                const float* in_row = x + static_cast<size_t>(kh) * Wp + w;
+                for (int kw = 0; kw < K; ++kw) {
+                    acc = _mm256_fmadd_ps(_mm256_loadu_ps(in_row + kw), _mm256_set1_ps(k[kh * K + kw]), acc);
+                }
+            }
+            _mm256_storeu_ps(out + w, acc);
+        }
+#endif
+        for (; w < W_out; ++w) {
+            float acc = bias;
+            for (int kh = 0; kh < K; ++kh) {
+                for (int kw = 0; kw < K; ++kw) acc += x[static_cast<size_t>(kh) * Wp + w + kw] * k[kh * K + kw];
+            }
+            out[w] = acc;
+        }
+    }
+};
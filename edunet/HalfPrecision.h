@@ -0,0 +1,308 @@
+#pragma once
+#include "Tensor.h"
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#if defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// 16-bit floating point storage: bfloat16 (the top half of an fp32) and
+// IEEE half. Values are only stored in 16 bits; every kernel converts them
+// back to fp32 on load and accumulates in fp32. Conversions round to
+// nearest even, in F16C/AVX2 when the target has them.
+namespace Half {
+
+    enum class DType { F32, BF16, F16 };
+
+    inline const char* dtype_name(DType t) {
+        switch (t) {
+            case DType::BF16: return "bf16";
+            case DType::F16: return "fp16";
+            default: return "fp32";
+        }
+    }
+
+    inline uint16_t float_to_bf16(float f) {
+        uint32_t u;
+        std::memcpy(&u, &f, sizeof(u));
+        if ((u & 0x7fffffffu) > 0x7f800000u) return static_cast<uint16_t>((u >> 16) | 0x40);  // quiet NaN
+        u += 0x7fffu + ((u >> 16) & 1);
+        return static_cast<uint16_t>(u >> 16);
+    }
+
+    inline float bf16_to_float(uint16_t h) {
+        uint32_t u = static_cast<uint32_t>(h) << 16;
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+    inline uint16_t float_to_f16(float f) {
+        uint32_t u;
+        std::memcpy(&u, &f, sizeof(u));
+        uint16_t sign = static_cast<uint16_t>((u >> 16) & 0x8000);
+        uint32_t a = u & 0x7fffffffu;
+        if (a > 0x7f800000u) return sign | 0x7e00;           // NaN
+        if (a >= 0x477ff000u) return sign | 0x7c00;          // rounds to infinity
+        if (a < 0x38800000u) {
+            // Zero or subnormal half: a multiple of 2^-24
+            float m;
+            std::memcpy(&m, &a, sizeof(m));
+            return sign | static_cast<uint16_t>(std::lrint(m * 16777216.0f));
+        }
+        a += 0xfffu + ((a >> 13) & 1);
+        return sign | static_cast<uint16_t>((a - 0x38000000u) >> 13);
+    }
+
+    inline float f16_to_float(uint16_t h) {
+        uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+        uint32_t exponent = (h >> 10) & 0x1f;
+        uint32_t mantissa = h & 0x3ff;
+        if (exponent == 0) {
+            float f = mantissa * (1.0f / 16777216.0f);
+            return sign ? -f : f;
+        }
+        uint32_t u = exponent == 31 ? (sign | 0x7f800000u | (mantissa << 13))
+                                    : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+#if defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+    // Eight 16-bit values widened to fp32
+    template<DType T>
+    inline __m256 load8(const uint16_t* p) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        if constexpr (T == DType::F16) {
+            return _mm256_cvtph_ps(h);
+        } else {
+            return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+        }
+    }
+
+    template<DType T>
+    inline void store8(uint16_t* p, __m256 v) {
+        __m128i h;
+        if constexpr (T == DType::F16) {
+            h = _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        } else {
+            __m256i u = _mm256_castps_si256(v);
+            __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(u, 16), _mm256_set1_epi32(1));
+            __m256i rounded = _mm256_add_epi32(u, _mm256_add_epi32(_mm256_set1_epi32(0x7fff), lsb));
+            __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+            rounded = _mm256_blendv_epi8(rounded, _mm256_or_si256(u, _mm256_set1_epi32(0x400000)), nan);
+            rounded = _mm256_srli_epi32(rounded, 16);
+            h = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi32(rounded, rounded), 0xd8));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), h);
+    }
+#endif
+
+    // n fp32 values to 16 bits
+    inline void encode(const float* src, uint16_t* dst, size_t n, DType t) {
+        size_t i = 0;
+#if defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+        if (t == DType::F16) {
+            for (; i + 8 <= n; i += 8) store8<DType::F16>(dst + i, _mm256_loadu_ps(src + i));
+        } else {
+            for (; i + 8 <= n; i += 8) store8<DType::BF16>(dst + i, _mm256_loadu_ps(src + i));
+        }
+#endif
+        for (; i < n; ++i) dst[i] = t == DType::F16 ? float_to_f16(src[i]) : float_to_bf16(src[i]);
+    }
+
+    // n 16-bit values to fp32
+    inline void decode(const uint16_t* src, float* dst, size_t n, DType t) {
+        size_t i = 0;
+#if defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+        if (t == DType::F16) {
+            for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, load8<DType::F16>(src + i));
+        } else {
+            for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, load8<DType::BF16>(src + i));
+        }
+#endif
+        for (; i < n; ++i) dst[i] = t == DType::F16 ? f16_to_float(src[i]) : bf16_to_float(src[i]);
+    }
+
+    // A tensor held in 16 bits, e.g. an activation saved for backward
+    struct HalfTensor {
+        std::vector<int> shape;
+        std::vector<uint16_t> data;
+        DType dtype = DType::BF16;
+
+        size_t bytes() const { return data.size() * sizeof(uint16_t); }
+        void clear() { shape.clear(); data.clear(); }
+    };
+
+    inline void convert(const Tensor& x, DType t, HalfTensor& out) {
+        out.shape = x.shape;
+        out.dtype = t;
+        out.data.resize(x.data.size());
+        encode(x.data.data(), out.data.data(), x.data.size(), t);
+    }
+
+    inline void convert(const HalfTensor& x, Tensor& out) {
+        out.resize(x.shape);
+        decode(x.data.data(), out.data.data(), x.data.size(), x.dtype);
+    }
+
+    // GEMM columns are zero-padded to a multiple of this
+    constexpr int NR = 16;
+
+    // K x N weight matrix in 16 bits, split into column panels of NR. Each
+    // panel is stored as K contiguous rows of NR values, so a GEMM streams
+    // it front to back.
+    struct PackedWeights {
+        DType dtype = DType::F32;
+        int K = 0, N = 0, N_padded = 0;
+        std::vector<uint16_t> data;
+
+        bool empty() const { return data.empty(); }
+        size_t bytes() const { return data.size() * sizeof(uint16_t); }
+        void clear() { data.clear(); K = N = N_padded = 0; }
+
+        // `w` is K x N row-major, or N x K when `transposed`
+        void pack(const float* w, int k_dim, int n_dim, DType t, bool transposed = false) {
+            dtype = t;
+            K = k_dim;
+            N = n_dim;
+            N_padded = (n_dim + NR - 1) / NR * NR;
+            data.resize(static_cast<size_t>(K) * N_padded);
+            std::vector<float> row(NR);
+            for (int n0 = 0; n0 < N; n0 += NR) {
+                for (int k = 0; k < K; ++k) {
+                    for (int j = 0; j < NR; ++j) {
+                        int n = n0 + j;
+                        row[j] = n >= N ? 0.0f
+                               : transposed ? w[static_cast<size_t>(n) * K + k] : w[static_cast<size_t>(k) * N + n];
+                    }
+                    encode(row.data(), panel(n0 / NR) + static_cast<size_t>(k) * NR, NR, t);
+                }
+            }
+        }
+
+        uint16_t* panel(int p) { return data.data() + static_cast<size_t>(p) * K * NR; }
+        const uint16_t* panel(int p) const { return data.data() + static_cast<size_t>(p) * K * NR; }
+    };
+
+#if defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+    // 4 x 16 block of C = bias + A * B. The accumulators are spelled out so
+    // they stay in registers.
+    template<DType T>
+    inline void block_4x16(const float* A, int lda, const uint16_t* B, int K,
+                           const float* bias, float* C, int ldc) {
+        __m256 c00 = _mm256_loadu_ps(bias), c01 = _mm256_loadu_ps(bias + 8);
+        __m256 c10 = c00, c11 = c01, c20 = c00, c21 = c01, c30 = c00, c31 = c01;
+        const float* a0 = A;
+        const float* a1 = a0 + lda;
+        const float* a2 = a1 + lda;
+        const float* a3 = a2 + lda;
+        for (int k = 0; k < K; ++k) {
+            const uint16_t* b = B + static_cast<size_t>(k) * NR;
+            __m256 b0 = load8<T>(b), b1 = load8<T>(b + 8);
+            __m256 a = _mm256_broadcast_ss(a0 + k);
+            c00 = _mm256_fmadd_ps(a, b0, c00); c01 = _mm256_fmadd_ps(a, b1, c01);
+            a = _mm256_broadcast_ss(a1 + k);
+            c10 = _mm256_fmadd_ps(a, b0, c10); c11 = _mm256_fmadd_ps(a, b1, c11);
+            a = _mm256_broadcast_ss(a2 + k);
+            c20 = _mm256_fmadd_ps(a, b0, c20); c21 = _mm256_fmadd_ps(a, b1, c21);
+            a = _mm256_broadcast_ss(a3 + k);
+            c30 = _mm256_fmadd_ps(a, b0, c30); c31 = _mm256_fmadd_ps(a, b1, c31);
+        }
+        _mm256_storeu_ps(C, c00); _mm256_storeu_ps(C + 8, c01); C += ldc;
+        _mm256_storeu_ps(C, c10); _mm256_storeu_ps(C + 8, c11); C += ldc;
+        _mm256_storeu_ps(C, c20); _mm256_storeu_ps(C + 8, c21); C += ldc;
+        _mm256_storeu_ps(C, c30); _mm256_storeu_ps(C + 8, c31);
+    }
+
+    // 1 x 16 block for the rows left over by block_4x16
+    template<DType T>
+    inline void block_1x16(const float* a, const uint16_t* B, int K, const float* bias, float* c) {
+        __m256 c0 = _mm256_loadu_ps(bias), c1 = _mm256_loadu_ps(bias + 8);
+        for (int k = 0; k < K; ++k) {
+            const uint16_t* b = B + static_cast<size_t>(k) * NR;
+            __m256 av = _mm256_broadcast_ss(a + k);
+            c0 = _mm256_fmadd_ps(av, load8<T>(b), c0);
+            c1 = _mm256_fmadd_ps(av, load8<T>(b + 8), c1);
+        }
+        _mm256_storeu_ps(c, c0);
+        _mm256_storeu_ps(c + 8, c1);
+    }
+
+    template<DType T>
+    inline void gemm_simd(const float* A, int M, int lda, const PackedWeights& B, const float* bias, float* C, int ldc) {
+        const int K = B.K, N = B.N;
+        float bias_block[NR];
+        float tail[4 * NR];
+        for (int n = 0; n < N; n += NR) {
+            int width = std::min(NR, N - n);
+            std::fill(bias_block, bias_block + NR, 0.0f);
+            if (bias) std::copy(bias + n, bias + n + width, bias_block);
+            const uint16_t* b = B.panel(n / NR);
+            int m = 0;
+            for (; m + 4 <= M; m += 4) {
+                const float* a = A + static_cast<size_t>(m) * lda;
+                float* c = C + static_cast<size_t>(m) * ldc + n;
+                if (width == NR) {
+                    block_4x16<T>(a, lda, b, K, bias_block, c, ldc);
+                } else {
+                    block_4x16<T>(a, lda, b, K, bias_block, tail, NR);
+                    for (int r = 0; r < 4; ++r) std::copy(tail + r * NR, tail + r * NR + width, c + static_cast<size_t>(r) * ldc);
+                }
+            }
+            for (; m < M; ++m) {
+                const float* a = A + static_cast<size_t>(m) * lda;
+                float* c = C + static_cast<size_t>(m) * ldc + n;
+                if (width == NR) {
+                    block_1x16<T>(a, b, K, bias_block, c);
+                } else {
+                    block_1x16<T>(a, b, K, bias_block, tail);
+                    std::copy(tail, tail + width, c);
+                }
+            }
+        }
+    }
+#endif
+
+    inline const char* kernel_name() {
+#if defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+        return "F16C/FMA";
+#else
+        return "scalar";
+#endif
+    }
+
+    // C (M x B.N, row stride ldc) = bias + A (M x B.K, row stride lda) * B,
+    // with fp32 accumulation. `bias` may be null.
+    inline void gemm(const float* A, int M, int lda, const PackedWeights& B, const float* bias, float* C, int ldc) {
+#if defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+        if (B.dtype == DType::F16) {
+            gemm_simd<DType::F16>(A, M, lda, B, bias, C, ldc);
+        } else {
+            gemm_simd<DType::BF16>(A, M, lda, B, bias, C, ldc);
+        }
+#else
+        // One panel row of B is widened at a time and applied to every row of A
+        float row[NR];
+        for (int m = 0; m < M; ++m) {
+            float* c = C + static_cast<size_t>(m) * ldc;
+            for (int n = 0; n < B.N; ++n) c[n] = bias ? bias[n] : 0.0f;
+        }
+        for (int n0 = 0; n0 < B.N; n0 += NR) {
+            int width = std::min(NR, B.N - n0);
+            for (int k = 0; k < B.K; ++k) {
+                decode(B.panel(n0 / NR) + static_cast<size_t>(k) * NR, row, NR, B.dtype);
+                for (int m = 0; m < M; ++m) {
+                    float a = A[static_cast<size_t>(m) * lda + k];
+                    float* c = C + static_cast<size_t>(m) * ldc + n0;
+                    for (int j = 0; j < width; ++j) c[j] += a * row[j];
+                }
+            }
+        }
+#endif
+    }
+}
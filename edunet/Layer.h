@@ -1,7 +1,12 @@
 #pragma once
 #include "Tensor.h"
+#include "HalfPrecision.h"
+#include "Random.h"
 #include <memory>
 #include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
 
 class Layer {
 public:
@@ -9,15 +14,108 @@ public:
     virtual Tensor forward(const Tensor& input) = 0;
     virtual Tensor backward(const Tensor& output_gradient) = 0;
     virtual std::unique_ptr<Layer> clone() const = 0;
+
+    // Inference-only forward pass into a caller-owned tensor. Layers that
+    // override it reuse `output`'s storage and keep nothing for backward.
+    virtual void forward_into(const Tensor& input, Tensor& output) { output = forward(input); }
     
     // УЛУЧШЕНО: Добавлены виртуальные методы для переключения режимов train/eval
     virtual void train() {}
     virtual void eval() {}
 
+    // Storage type of the weights and saved activations used by forward.
+    // The fp32 parameters stay the master copy that optimizers update;
+    // layers without 16-bit kernels ignore it.
+    virtual void set_precision(Half::DType dtype) { (void)dtype; }
+
+    // Called after the parameters were overwritten in place (e.g. restored
+    // from a checkpoint), so layers can drop copies derived from them
+    virtual void parameters_changed() {}
+
+    // What forward saved for backward (inputs, outputs, masks, indices):
+    // its size, and dropping it. Used by gradient checkpointing in
+    // Sequential, which re-runs forward before calling backward again.
+    virtual size_t activation_bytes() const { return 0; }
+    virtual void release_activations() {}
+
+    // Set around such a re-run: forward must not update state again
+    // (BatchNorm running statistics)
+    virtual void set_recomputing(bool on) { (void)on; }
+
+    // Approximate floating-point operations of one forward call, reported
+    // by the profiler (Profiler.h). Defaults to one per output element.
+    virtual double forward_flops(const std::vector<int>& input_shape, const std::vector<int>& output_shape) const {
+        (void)input_shape;
+        double n = 1.0;
+        for (int d : output_shape) n *= d;
+        return n;
+    }
+
     // Методы для сериализации
     virtual void save_weights(const std::string& filename) const = 0;
     virtual void load_weights(const std::string& filename) = 0;
     virtual std::string get_layer_type() const = 0;
     virtual std::string get_weights_string() const = 0;
     virtual void set_weights_from_string(const std::string& data) = 0;
+
+    // Binary serialization (ModelFormat.h): hyper-parameters as a
+    // "key:value;" string, and the parameter tensors in a fixed order.
+    // set_config_from_string must size the parameter tensors.
+    virtual std::string get_config_string() const { return ""; }
+    virtual void set_config_from_string(const std::string& config) { (void)config; }
+    virtual std::vector<Tensor*> parameters() { return {}; }
+
+    // Gradients of the trained parameters, in the order of parameters(), as
+    // left by backward. Parameters past the last gradient are state that is
+    // saved with the model but not trained (BatchNorm running statistics).
+    virtual std::vector<Tensor*> gradients() { return {}; }
+
+    // Gradient accumulation (micro-batches in Trainer): while on, backward
+    // adds the parameter gradients to the current ones instead of
+    // replacing them. zero_gradients() starts a new sum.
+    void set_accumulate_gradients(bool on) { accumulate_gradients = on; }
+
+    void zero_gradients() {
+        std::vector<Tensor*> params = parameters();
+        std::vector<Tensor*> grads = gradients();
+        for (size_t i = 0; i < grads.size() && i < params.size(); ++i) {
+            if (grads[i]->shape != params[i]->shape) {
+                *grads[i] = Tensor(params[i]->shape);
+            } else {
+                std::fill(grads[i]->data.begin(), grads[i]->data.end(), 0.0f);
+            }
+        }
+    }
+
+    // Training state outside the parameters that a checkpoint must carry
+    // for an exact resume, e.g. the state of a layer's random generator
+    virtual std::string get_rng_state() const { return ""; }
+    virtual void set_rng_state(const std::string& state) { (void)state; }
+
+    std::vector<const Tensor*> parameters() const {
+        std::vector<Tensor*> params = const_cast<Layer*>(this)->parameters();
+        return std::vector<const Tensor*>(params.begin(), params.end());
+    }
+
+    // Value of `key` in a "key:value;key:value" config string
+    static std::string config_value(const std::string& config, const std::string& key) {
+        size_t pos = 0;
+        while ((pos = config.find(key + ":", pos)) != std::string::npos) {
+            if (pos == 0 || config[pos - 1] == ';') {
+                size_t start = pos + key.length() + 1;
+                return config.substr(start, config.find(';', start) - start);
+            }
+            pos += key.length();
+        }
+        throw std::runtime_error("Missing '" + key + "' in layer config: " + config);
+    }
+
+protected:
+    bool accumulate_gradients = false;
+
+    // Prepares a parameter gradient that backward then adds into: zeroed,
+    // unless gradients accumulate
+    void start_gradient(Tensor& grad, const std::vector<int>& shape) const {
+        if (!accumulate_gradients || grad.shape != shape) grad = Tensor(shape);
+    }
 };
\ No newline at end of file
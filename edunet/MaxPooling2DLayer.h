@@ -1,89 +1,266 @@
 #pragma once
 #include "Layer.h"
+#include "Parallel.h"
 #include <vector>
 #include <algorithm>
 #include <limits>
 #include <fstream>
+#include <cstdint>
+#include <array>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
+// Keeps, per output, the offset of the window maximum within its window
+// (ph * pool_size + pw, one byte) and the input shape. 2x2 and 3x3 windows
+// with stride 2 are pooled eight at a time with AVX2, and 2x2 gradients
+// are written back as dense rows. Planes (N x C) are split across threads.
 class MaxPooling2DLayer : public Layer {
 private:
     int pool_size;
     int stride;
-    Tensor last_input;
-    std::vector<int> max_indices; 
+    std::vector<int> last_input_shape;
+    std::vector<uint8_t> argmax;
+
 public:
+    // Offset of a window with no value above -inf (all -inf or NaN),
+    // which passes no gradient
+    static constexpr uint8_t NO_MAX = 255;
+
     MaxPooling2DLayer(int p_size, int s = -1) : pool_size(p_size) {
         this->stride = (s == -1) ? pool_size : s;
     }
     MaxPooling2DLayer() = default;
 
     Tensor forward(const Tensor& input) override {
-        last_input = input;
-        int N=input.shape[0], C=input.shape[1], H_in=input.shape[2], W_in=input.shape[3];
-        int H_out = (H_in - pool_size) / stride + 1;
-        int W_out = (W_in - pool_size) / stride + 1;
-        Tensor output({N, C, H_out, W_out});
-        max_indices.assign(output.data.size(), -1);
-        for (int n = 0; n < N; ++n) {
-            for (int c = 0; c < C; ++c) {
-                for (int h = 0; h < H_out; ++h) {
-                    for (int w = 0; w < W_out; ++w) {
-                        float max_val = -std::numeric_limits<float>::infinity();
-                        int max_idx = -1;
-                        for (int ph = 0; ph < pool_size; ++ph) {
-                            for (int pw = 0; pw < pool_size; ++pw) {
-                                int h_in_idx = h * stride + ph;
-                                int w_in_idx = w * stride + pw;
-                                int flat_idx = n*C*H_in*W_in + c*H_in*W_in + h_in_idx*W_in + w_in_idx;
-                                if (input.data[flat_idx] > max_val) {
-                                    max_val = input.data[flat_idx];
-                                    max_idx = flat_idx;
-                                }
-                            }
-                        }
-                        int out_flat_idx = n*C*H_out*W_out + c*H_out*W_out + h*W_out + w;
-                        output.data[out_flat_idx] = max_val;
-                        max_indices[out_flat_idx] = max_idx;
-                    }
-                }
-            }
-        }
+        check_input(input.shape);
+        Tensor output(output_shape(input.shape));
+        argmax.resize(output.data.size());
+        pool_planes(input.data.data(), static_cast<size_t>(input.shape[0]) * input.shape[1], input.shape[2],
+                    input.shape[3], pool_size, stride, output.data.data(), argmax.data());
+        last_input_shape = input.shape;
         return output;
     }
+
+    void forward_into(const Tensor& input, Tensor& output) override {
+        check_input(input.shape);
+        output.resize(output_shape(input.shape));
+        pool_planes(input.data.data(), static_cast<size_t>(input.shape[0]) * input.shape[1], input.shape[2],
+                    input.shape[3], pool_size, stride, output.data.data(), nullptr);
+    }
+
     Tensor backward(const Tensor& output_gradient) override {
-        Tensor input_gradient(last_input.shape);
-        for (size_t i = 0; i < max_indices.size(); ++i) {
-            int input_idx = max_indices[i];
-            if(input_idx != -1) input_gradient.data[input_idx] += output_gradient.data[i];
+        if (last_input_shape.size() != 4 || output_gradient.shape != output_shape(last_input_shape) ||
+            argmax.size() != output_gradient.data.size()) {
+            throw std::runtime_error("MaxPooling2DLayer::backward: gradient shape does not match the last forward pass");
         }
+        Tensor input_gradient(last_input_shape);
+        unpool_planes(output_gradient.data.data(), argmax.data(), static_cast<size_t>(last_input_shape[0]) * last_input_shape[1],
+                      last_input_shape[2], last_input_shape[3], pool_size, stride, input_gradient.data.data());
         return input_gradient;
     }
 
     std::unique_ptr<Layer> clone() const override { return std::make_unique<MaxPooling2DLayer>(*this); }
-    
+
+    size_t activation_bytes() const override { return argmax.size() * sizeof(uint8_t); }
+
+    void release_activations() override {
+        std::vector<uint8_t>().swap(argmax);
+    }
+
     void save_weights(const std::string& filename) const override {
         std::ofstream file(filename + "_maxpool.meta");
         file << pool_size << " " << stride;
         file.close();
     }
-    
+
     void load_weights(const std::string& filename) override {
         std::ifstream file(filename + "_maxpool.meta");
         if (!file) throw std::runtime_error("Cannot open meta file: " + filename + "_maxpool.meta");
         file >> pool_size >> stride;
         file.close();
     }
-    
+
     std::string get_layer_type() const override { return "MaxPooling2DLayer"; }
-    
+
+    double forward_flops(const std::vector<int>& input_shape, const std::vector<int>& output_shape) const override {
+        return Layer::forward_flops(input_shape, output_shape) * pool_size * pool_size;
+    }
+
+    std::string get_config_string() const override { return get_weights_string(); }
+
+    void set_config_from_string(const std::string& config) override {
+        pool_size = std::stoi(config_value(config, "pool_size"));
+        stride = std::stoi(config_value(config, "stride"));
+    }
+
     std::string get_weights_string() const override {
         return "pool_size:" + std::to_string(pool_size) + ";stride:" + std::to_string(stride);
     }
-    
+
     void set_weights_from_string(const std::string& data) override {
         size_t pool_pos = data.find("pool_size:") + 10;
         size_t stride_pos = data.find("stride:") + 7;
         pool_size = std::stoi(data.substr(pool_pos, data.find(";") - pool_pos));
         stride = std::stoi(data.substr(stride_pos));
     }
-};
\ No newline at end of file
+
+    // Max pools `planes` consecutive H x W planes into y. The first maximum
+    // of each window in row-major order wins; its in-window offset goes to
+    // arg unless arg is null (inference).
+    static void pool_planes(const float* x, size_t planes, int H, int W, int P, int S, float* y, uint8_t* arg) {
+        const int H_out = (H - P) / S + 1, W_out = (W - P) / S + 1;
+        const size_t in_plane = static_cast<size_t>(H) * W, out_plane = static_cast<size_t>(H_out) * W_out;
+        Parallel::for_range(planes, planes_per_thread(in_plane), [&](size_t begin, size_t end) {
+            for (size_t p = begin; p < end; ++p) {
+                const float* xp = x + p * in_plane;
+                for (int h = 0; h < H_out; ++h) {
+                    const size_t o = p * out_plane + static_cast<size_t>(h) * W_out;
+                    uint8_t* a = arg ? arg + o : nullptr;
+                    int w = 0;
+#if defined(__AVX2__)
+                    if (S == 2 && P == 2) w = pool_row_s2<2>(xp, W, h, W_out, y + o, a);
+                    if (S == 2 && P == 3) w = pool_row_s2<3>(xp, W, h, W_out, y + o, a);
+#endif
+                    pool_row(xp, W, P, S, h, w, W_out, y + o, a);
+                }
+            }
+        });
+    }
+
+    // Routes each gradient in g to the argmax of its window in dx (H x W
+    // planes, zeroed by the caller)
+    static void unpool_planes(const float* g, const uint8_t* arg, size_t planes, int H, int W, int P, int S, float* dx) {
+        const int H_out = (H - P) / S + 1, W_out = (W - P) / S + 1;
+        const size_t in_plane = static_cast<size_t>(H) * W, out_plane = static_cast<size_t>(H_out) * W_out;
+        // Position of each in-window offset relative to the window corner
+        std::array<int, 256> position{};
+        for (int k = 0; k < P * P; ++k) position[k] = k / P * W + k % P;
+        Parallel::for_range(planes, planes_per_thread(in_plane), [&](size_t begin, size_t end) {
+            for (size_t p = begin; p < end; ++p) {
+                float* dxp = dx + p * in_plane;
+                for (int h = 0; h < H_out; ++h) {
+                    const size_t o = p * out_plane + static_cast<size_t>(h) * W_out;
+                    int w = 0;
+#if defined(__AVX2__)
+                    if (S == 2 && P == 2) w = unpool_row_2x2(g + o, arg + o, W, h, W_out, dxp);
+#endif
+                    float* corner = dxp + static_cast<size_t>(h) * S * W;
+                    for (; w < W_out; ++w) {
+                        if (arg[o + w] != NO_MAX) corner[w * S + position[arg[o + w]]] += g[o + w];
+                    }
+                }
+            }
+        });
+    }
+
+private:
+    void check_input(const std::vector<int>& shape) const {
+        if (shape.size() != 4 || shape[2] < pool_size || shape[3] < pool_size) {
+            throw std::runtime_error("MaxPooling2DLayer expects an N x C x H x W input of at least the pool size");
+        }
+        if (pool_size * pool_size > NO_MAX) {
+            throw std::runtime_error("MaxPooling2DLayer supports windows of up to 15x15");
+        }
+    }
+
+    std::vector<int> output_shape(const std::vector<int>& in) const {
+        return {in[0], in[1], (in[2] - pool_size) / stride + 1, (in[3] - pool_size) / stride + 1};
+    }
+
+    // About 64K input values per thread
+    static size_t planes_per_thread(size_t plane) { return std::max<size_t>(1, (size_t(1) << 16) / plane); }
+
+    // Outputs [w, W_out) of output row h
+    static void pool_row(const float* x, int W, int P, int S, int h, int w, int W_out, float* y, uint8_t* arg) {
+        for (; w < W_out; ++w) {
+            float max_val = -std::numeric_limits<float>::infinity();
+            uint8_t best = NO_MAX;
+            for (int ph = 0; ph < P; ++ph) {
+                const float* row = x + static_cast<size_t>(h * S + ph) * W + w * S;
+                for (int pw = 0; pw < P; ++pw) {
+                    if (row[pw] > max_val) {
+                        max_val = row[pw];
+                        best = static_cast<uint8_t>(ph * P + pw);
+                    }
+                }
+            }
+            y[w] = max_val;
+            if (arg) arg[w] = best;
+        }
+    }
+
+#if defined(__AVX2__)
+    // Even and odd elements of p[0..15]
+    static void deinterleave(const float* p, __m256& even, __m256& odd) {
+        const __m256 a = _mm256_loadu_ps(p), b = _mm256_loadu_ps(p + 8);
+        even = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0x88)), 0xD8));
+        odd = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0xDD)), 0xD8));
+    }
+
+    // Eight windows of P x P, stride 2, at a time; the window elements are
+    // visited in the scalar order, so maxima and argmax match pool_row. A
+    // partial last block is redone overlapping the previous one, which
+    // reads no further than the last window (inputs up to 2 * w + 15 for
+    // 2x2, 2 * w + 16 for 3x3). Returns the first output left to the
+    // scalar loop.
+    template<int P>
+    static int pool_row_s2(const float* x, int W, int h, int W_out, float* y, uint8_t* arg) {
+        if (W_out < 8) return 0;
+        for (int w = 0;; w += 8) {
+            w = std::min(w, W_out - 8);
+            __m256 m = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+            __m256 best = _mm256_set1_ps(NO_MAX);
+            auto visit = [&](__m256 v, int offset) {
+                // v > m is false for NaN, like the scalar compare
+                best = _mm256_blendv_ps(best, _mm256_set1_ps(static_cast<float>(offset)), _mm256_cmp_ps(v, m, _CMP_GT_OQ));
+                m = _mm256_max_ps(v, m);
+            };
+            for (int ph = 0; ph < P; ++ph) {
+                const float* row = x + static_cast<size_t>(h * 2 + ph) * W + 2 * w;
+                __m256 even, odd;
+                deinterleave(row, even, odd);
+                visit(even, ph * P);
+                visit(odd, ph * P + 1);
+                if (P == 3) {
+                    // Third column: the even elements one on, and row[16]
+                    const __m256 third = _mm256_permutevar8x32_ps(even, _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 7));
+                    visit(_mm256_blend_ps(third, _mm256_broadcast_ss(row + 16), 0x80), ph * P + 2);
+                }
+            }
+            _mm256_storeu_ps(y + w, m);
+            if (arg) {
+                const __m256i idx = _mm256_cvttps_epi32(best);
+                __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(idx), _mm256_extracti128_si256(idx, 1));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(arg + w), _mm_packus_epi16(packed, packed));
+            }
+            if (w + 8 == W_out) return W_out;
+        }
+    }
+
+    // Eight 2x2 windows at a time: per window row, the gradients for the
+    // even and odd columns are selected by argmax and stored interleaved,
+    // each input written once. A partial last block is redone like in
+    // pool_row_s2. (Overlapping 3x3 windows would have to add every row
+    // about 1.5 times; routing their few gradients one by one is faster.)
+    static int unpool_row_2x2(const float* g, const uint8_t* arg, int W, int h, int W_out, float* dx) {
+        if (W_out < 8) return 0;
+        for (int w = 0;; w += 8) {
+            w = std::min(w, W_out - 8);
+            const __m256 gv = _mm256_loadu_ps(g + w);
+            const __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(arg + w)));
+            auto select = [&](int offset) {
+                return _mm256_and_ps(gv, _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, _mm256_set1_epi32(offset))));
+            };
+            for (int ph = 0; ph < 2; ++ph) {
+                float* row = dx + static_cast<size_t>(h * 2 + ph) * W + 2 * w;
+                const __m256 even = select(ph * 2), odd = select(ph * 2 + 1);
+                const __m256 lo = _mm256_unpacklo_ps(even, odd), hi = _mm256_unpackhi_ps(even, odd);
+                _mm256_storeu_ps(row, _mm256_permute2f128_ps(lo, hi, 0x20));
+                _mm256_storeu_ps(row + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+            }
+            if (w + 8 == W_out) return W_out;
+        }
+    }
+#endif
+};
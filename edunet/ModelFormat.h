@@ -0,0 +1,574 @@
+#pragma once
+#include "Layer.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define EDUNET_HAS_MMAP 1
+#endif
+
+// Versioned binary model format used by Sequential::save_model/load_model.
+//
+//   Header (48 bytes)   magic "EDNM", version, layer/tensor counts, offsets,
+//                       file size and a CRC-32C of everything after the header
+//   Layer table         per layer: type name, "key:value;" config string,
+//                       index of its first tensor and tensor count
+//   Tensor table        per tensor: dtype, rank, dims, blob offset and size
+//   Tensor blobs        raw little-endian data, each aligned to 64 bytes
+//
+// All integers are little-endian.
+namespace ModelFormat {
+
+    constexpr char MAGIC[4] = {'E', 'D', 'N', 'M'};
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 48;
+    constexpr size_t ALIGNMENT = 64;
+
+    enum class DType : uint8_t { F32 = 0 };
+
+    inline size_t dtype_size(DType dtype) {
+        switch (dtype) {
+            case DType::F32: return 4;
+        }
+        throw std::runtime_error("Unknown tensor dtype in model file");
+    }
+
+    inline bool host_is_little_endian() {
+        const uint16_t probe = 1;
+        unsigned char first;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    // --- CRC-32C (Castagnoli) ---
+
+    inline const uint32_t* crc32c_table() {
+        static const std::vector<uint32_t> table = [] {
+            std::vector<uint32_t> t(8 * 256);
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t crc = i;
+                for (int k = 0; k < 8; ++k) crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+                t[i] = crc;
+            }
+            for (uint32_t i = 0; i < 256; ++i) {
+                for (int s = 1; s < 8; ++s) t[s * 256 + i] = (t[(s - 1) * 256 + i] >> 8) ^ t[t[(s - 1) * 256 + i] & 0xFF];
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // Incremental CRC-32C: start with crc = 0 and feed consecutive chunks
+    inline uint32_t crc32c(uint32_t crc, const void* data, size_t size) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        crc = ~crc;
+#if defined(__SSE4_2__)
+        uint64_t crc64 = crc;
+        while (size >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            crc64 = _mm_crc32_u64(crc64, word);
+            p += 8;
+            size -= 8;
+        }
+        crc = static_cast<uint32_t>(crc64);
+        while (size--) crc = _mm_crc32_u8(crc, *p++);
+#else
+        const uint32_t* t = crc32c_table();
+        while (size >= 8) {
+            uint32_t lo, hi;
+            std::memcpy(&lo, p, 4);
+            std::memcpy(&hi, p + 4, 4);
+            lo ^= crc;
+            crc = t[7 * 256 + (lo & 0xFF)] ^ t[6 * 256 + ((lo >> 8) & 0xFF)] ^
+                  t[5 * 256 + ((lo >> 16) & 0xFF)] ^ t[4 * 256 + (lo >> 24)] ^
+                  t[3 * 256 + (hi & 0xFF)] ^ t[2 * 256 + ((hi >> 8) & 0xFF)] ^
+                  t[1 * 256 + ((hi >> 16) & 0xFF)] ^ t[hi >> 24];
+            p += 8;
+            size -= 8;
+        }
+        while (size--) crc = (crc >> 8) ^ t[(crc ^ *p++) & 0xFF];
+#endif
+        return ~crc;
+    }
+
+    // --- little-endian encoding helpers ---
+
+    inline void put_u8(std::vector<char>& out, uint8_t v) { out.push_back(static_cast<char>(v)); }
+    inline void put_u16(std::vector<char>& out, uint16_t v) {
+        for (int i = 0; i < 2; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+    inline void put_u32(std::vector<char>& out, uint32_t v) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+    inline void put_u64(std::vector<char>& out, uint64_t v) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+    inline void put_string(std::vector<char>& out, const std::string& s) {
+        put_u32(out, static_cast<uint32_t>(s.size()));
+        out.insert(out.end(), s.begin(), s.end());
+    }
+    inline void patch_u64(std::vector<char>& out, size_t pos, uint64_t v) {
+        for (int i = 0; i < 8; ++i) out[pos + i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+    }
+    // Rank, dims and raw float data of a tensor
+    inline void put_tensor(std::vector<char>& out, const Tensor& t) {
+        put_u8(out, static_cast<uint8_t>(t.shape.size()));
+        for (int d : t.shape) put_u32(out, static_cast<uint32_t>(d));
+        const char* p = reinterpret_cast<const char*>(t.data.data());
+        out.insert(out.end(), p, p + t.data.size() * sizeof(float));
+    }
+
+    // Bounds-checked little-endian reader over an in-memory byte range
+    class Reader {
+    private:
+        const char* data;
+        size_t size;
+        size_t pos = 0;
+    public:
+        Reader(const char* d, size_t n) : data(d), size(n) {}
+        void need(size_t n) const {
+            if (pos + n > size) throw std::runtime_error("Truncated model file");
+        }
+        uint64_t get(int bytes) {
+            need(bytes);
+            uint64_t v = 0;
+            for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+            pos += bytes;
+            return v;
+        }
+        uint8_t u8() { return static_cast<uint8_t>(get(1)); }
+        uint16_t u16() { return static_cast<uint16_t>(get(2)); }
+        uint32_t u32() { return static_cast<uint32_t>(get(4)); }
+        uint64_t u64() { return get(8); }
+        std::string str() {
+            uint32_t n = u32();
+            need(n);
+            std::string s(data + pos, n);
+            pos += n;
+            return s;
+        }
+        const char* bytes(size_t n) {
+            need(n);
+            const char* p = data + pos;
+            pos += n;
+            return p;
+        }
+        // Reads a tensor written by put_tensor()
+        Tensor tensor() {
+            std::vector<int> shape(u8());
+            for (int& d : shape) d = static_cast<int>(u32());
+            Tensor t(shape);
+            size_t n = t.data.size() * sizeof(float);
+            std::memcpy(t.data.data(), bytes(n), n);
+            return t;
+        }
+        bool at_end() const { return pos == size; }
+    };
+
+    inline size_t align_up(size_t v) { return (v + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    struct TensorEntry {
+        DType dtype;
+        std::vector<int> shape;
+        uint64_t offset;
+        uint64_t byte_size;
+    };
+
+    struct LayerEntry {
+        std::string type;
+        std::string config;
+        uint32_t first_tensor;
+        uint32_t tensor_count;
+    };
+
+    struct Header {
+        uint32_t version;
+        uint32_t num_layers;
+        uint32_t num_tensors;
+        uint64_t tables_size;
+        uint64_t file_size;
+        uint32_t checksum;
+    };
+
+    inline bool has_magic(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        char magic[4] = {};
+        file.read(magic, 4);
+        return file && std::memcmp(magic, MAGIC, 4) == 0;
+    }
+
+    // Writes the layer/tensor tables and the aligned blobs (everything after
+    // the header) through `write(const char*, size_t)`. Returns the header
+    // without the checksum.
+    template<typename Write>
+    Header write_body(const std::vector<std::unique_ptr<Layer>>& layers, Write&& write) {
+        if (!host_is_little_endian()) throw std::runtime_error("Binary model format requires a little-endian host");
+
+        // Layer and tensor tables
+        std::vector<const Tensor*> tensors;
+        std::vector<char> layer_table;
+        for (const auto& layer : layers) {
+            std::vector<const Tensor*> params = static_cast<const Layer&>(*layer).parameters();
+            put_string(layer_table, layer->get_layer_type());
+            put_string(layer_table, layer->get_config_string());
+            put_u32(layer_table, static_cast<uint32_t>(tensors.size()));
+            put_u32(layer_table, static_cast<uint32_t>(params.size()));
+            tensors.insert(tensors.end(), params.begin(), params.end());
+        }
+
+        size_t tensor_table_size = 0;
+        for (const Tensor* t : tensors) tensor_table_size += 4 + 4 * t->shape.size() + 16;
+        size_t tables_size = layer_table.size() + tensor_table_size;
+
+        std::vector<char> tensor_table;
+        tensor_table.reserve(tensor_table_size);
+        size_t offset = align_up(HEADER_SIZE + tables_size);
+        std::vector<uint64_t> offsets;
+        for (const Tensor* t : tensors) {
+            uint64_t bytes = t->data.size() * sizeof(float);
+            put_u8(tensor_table, static_cast<uint8_t>(DType::F32));
+            put_u8(tensor_table, static_cast<uint8_t>(t->shape.size()));
+            put_u16(tensor_table, 0);
+            for (int d : t->shape) put_u32(tensor_table, static_cast<uint32_t>(d));
+            put_u64(tensor_table, offset);
+            put_u64(tensor_table, bytes);
+            offsets.push_back(offset);
+            offset = align_up(offset + bytes);
+        }
+        size_t file_size = offset;
+
+        static const char zeros[ALIGNMENT] = {};
+        write(layer_table.data(), layer_table.size());
+        write(tensor_table.data(), tensor_table.size());
+        size_t pos = HEADER_SIZE + tables_size;
+        for (size_t i = 0; i < tensors.size(); ++i) {
+            write(zeros, offsets[i] - pos);
+            size_t bytes = tensors[i]->data.size() * sizeof(float);
+            write(reinterpret_cast<const char*>(tensors[i]->data.data()), bytes);
+            pos = offsets[i] + bytes;
+        }
+        write(zeros, file_size - pos);
+
+        Header h;
+        h.version = VERSION;
+        h.num_layers = static_cast<uint32_t>(layers.size());
+        h.num_tensors = static_cast<uint32_t>(tensors.size());
+        h.tables_size = tables_size;
+        h.file_size = file_size;
+        h.checksum = 0;
+        return h;
+    }
+
+    inline std::vector<char> header_bytes(const Header& h) {
+        std::vector<char> header;
+        header.insert(header.end(), MAGIC, MAGIC + 4);
+        put_u32(header, h.version);
+        put_u32(header, h.num_layers);
+        put_u32(header, h.num_tensors);
+        put_u64(header, h.tables_size);
+        put_u64(header, h.file_size);
+        put_u32(header, h.checksum);
+        header.resize(HEADER_SIZE, 0);
+        return header;
+    }
+
+    inline void save(const std::vector<std::unique_ptr<Layer>>& layers, const std::string& filename) {
+        std::ofstream file(filename, std::ios::binary);
+        if (!file) throw std::runtime_error("Cannot open file for writing: " + filename);
+
+        // Placeholder header, rewritten once the checksum is known
+        std::vector<char> header(HEADER_SIZE, 0);
+        file.write(header.data(), header.size());
+
+        uint32_t crc = 0;
+        Header h = write_body(layers, [&](const char* p, size_t n) {
+            crc = crc32c(crc, p, n);
+            file.write(p, n);
+        });
+        h.checksum = crc;
+
+        header = header_bytes(h);
+        file.seekp(0);
+        file.write(header.data(), header.size());
+        if (!file) throw std::runtime_error("Failed to write model file: " + filename);
+    }
+
+    // In-memory variant of save(): appends the model to `out` with a zero
+    // checksum, so a caller can stage a model quickly and seal() it later,
+    // e.g. on a background thread. Returns the encoded size.
+    inline size_t encode(const std::vector<std::unique_ptr<Layer>>& layers, std::vector<char>& out) {
+        size_t start = out.size();
+        out.resize(start + HEADER_SIZE, 0);
+        Header h = write_body(layers, [&](const char* p, size_t n) { out.insert(out.end(), p, p + n); });
+        std::vector<char> header = header_bytes(h);
+        std::copy(header.begin(), header.end(), out.begin() + start);
+        return out.size() - start;
+    }
+
+    // Computes and stores the checksum of a model produced by encode()
+    inline void seal(char* model, size_t size) {
+        uint32_t crc = crc32c(0, model + HEADER_SIZE, size - HEADER_SIZE);
+        for (int i = 0; i < 4; ++i) model[32 + i] = static_cast<char>((crc >> (8 * i)) & 0xFF);
+    }
+
+    inline Header parse_header(const char* bytes) {
+        if (std::memcmp(bytes, MAGIC, 4) != 0) throw std::runtime_error("Not an edunet binary model file");
+        Reader r(bytes + 4, HEADER_SIZE - 4);
+        Header h;
+        h.version = r.u32();
+        if (h.version != VERSION) throw std::runtime_error("Unsupported model format version " + std::to_string(h.version));
+        h.num_layers = r.u32();
+        h.num_tensors = r.u32();
+        h.tables_size = r.u64();
+        h.file_size = r.u64();
+        h.checksum = r.u32();
+        return h;
+    }
+
+    // The header's sizes and counts are checked against the real size of
+    // the data before anything is allocated from them. A layer entry takes
+    // at least 16 bytes of the tables and a tensor entry at least 20.
+    inline bool header_fits(const Header& h, uint64_t actual_size) {
+        return actual_size >= HEADER_SIZE && h.file_size == actual_size &&
+               h.tables_size <= actual_size - HEADER_SIZE &&
+               16 * static_cast<uint64_t>(h.num_layers) + 20 * static_cast<uint64_t>(h.num_tensors) <= h.tables_size;
+    }
+
+    inline void parse_tables(const char* tables, const Header& h,
+                             std::vector<LayerEntry>& layer_entries, std::vector<TensorEntry>& tensor_entries) {
+        Reader r(tables, h.tables_size);
+        layer_entries.resize(h.num_layers);
+        for (auto& e : layer_entries) {
+            e.type = r.str();
+            e.config = r.str();
+            e.first_tensor = r.u32();
+            e.tensor_count = r.u32();
+            if (static_cast<uint64_t>(e.first_tensor) + e.tensor_count > h.num_tensors) {
+                throw std::runtime_error("Corrupt layer table in model file");
+            }
+        }
+        // Every tensor entry must belong to exactly one layer: the loaders
+        // write each blob through its owner's parameter
+        std::vector<uint8_t> owned(h.num_tensors, 0);
+        for (const auto& e : layer_entries) {
+            for (uint32_t k = 0; k < e.tensor_count; ++k) {
+                if (owned[e.first_tensor + k]++) throw std::runtime_error("Corrupt layer table in model file");
+            }
+        }
+        if (std::find(owned.begin(), owned.end(), 0) != owned.end()) {
+            throw std::runtime_error("Corrupt layer table in model file");
+        }
+        tensor_entries.resize(h.num_tensors);
+        for (auto& e : tensor_entries) {
+            e.dtype = static_cast<DType>(r.u8());
+            int rank = r.u8();
+            r.u16();
+            e.shape.resize(rank);
+            uint64_t count = 1;
+            for (int& d : e.shape) { d = static_cast<int>(r.u32()); count *= d; }
+            e.offset = r.u64();
+            e.byte_size = r.u64();
+            if (e.byte_size != count * dtype_size(e.dtype) || e.offset % ALIGNMENT != 0 ||
+                e.offset + e.byte_size > h.file_size) {
+                throw std::runtime_error("Corrupt tensor table in model file");
+            }
+        }
+    }
+
+    // Checks that a layer's parameter tensor matches the stored shape
+    inline void check_shape(const Tensor& param, const TensorEntry& entry, const std::string& layer_type) {
+        if (param.shape != entry.shape || entry.dtype != DType::F32) {
+            throw std::runtime_error("Tensor shape mismatch for " + layer_type + " in model file");
+        }
+    }
+
+    // Reads a model saved by save(). `create_layer` maps a layer type name to
+    // a default-constructed layer.
+    inline std::vector<std::unique_ptr<Layer>> load(
+            const std::string& filename,
+            const std::function<std::unique_ptr<Layer>(const std::string&)>& create_layer) {
+        if (!host_is_little_endian()) throw std::runtime_error("Binary model format requires a little-endian host");
+
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) throw std::runtime_error("Cannot open file for reading: " + filename);
+
+        file.seekg(0, std::ios::end);
+        const uint64_t actual_size = static_cast<uint64_t>(file.tellg());
+        file.seekg(0, std::ios::beg);
+
+        char header_bytes[HEADER_SIZE];
+        if (!file.read(header_bytes, HEADER_SIZE)) throw std::runtime_error("Truncated model file: " + filename);
+        Header h = parse_header(header_bytes);
+        if (!header_fits(h, actual_size)) throw std::runtime_error("Truncated model file: " + filename);
+
+        std::vector<char> tables(h.tables_size);
+        if (!file.read(tables.data(), tables.size())) throw std::runtime_error("Truncated model file: " + filename);
+        uint32_t crc = crc32c(0, tables.data(), tables.size());
+
+        std::vector<LayerEntry> layer_entries;
+        std::vector<TensorEntry> tensor_entries;
+        parse_tables(tables.data(), h, layer_entries, tensor_entries);
+
+        std::vector<std::unique_ptr<Layer>> layers;
+        std::vector<Tensor*> targets(h.num_tensors, nullptr);
+        for (const auto& e : layer_entries) {
+            std::unique_ptr<Layer> layer = create_layer(e.type);
+            layer->set_config_from_string(e.config);
+            std::vector<Tensor*> params = layer->parameters();
+            if (params.size() != e.tensor_count) {
+                throw std::runtime_error("Parameter count mismatch for " + e.type + " in model file");
+            }
+            for (uint32_t k = 0; k < e.tensor_count; ++k) {
+                check_shape(*params[k], tensor_entries[e.first_tensor + k], e.type);
+                targets[e.first_tensor + k] = params[k];
+            }
+            layers.push_back(std::move(layer));
+        }
+
+        // Blobs are stored in table order: read each one straight into its
+        // tensor, checksumming the padding in between.
+        uint64_t pos = HEADER_SIZE + h.tables_size;
+        char padding[ALIGNMENT];
+        for (size_t i = 0; i < tensor_entries.size(); ++i) {
+            const TensorEntry& e = tensor_entries[i];
+            if (e.offset < pos || e.offset - pos > ALIGNMENT) throw std::runtime_error("Corrupt tensor layout in model file");
+            file.read(padding, e.offset - pos);
+            crc = crc32c(crc, padding, e.offset - pos);
+            char* dst = reinterpret_cast<char*>(targets[i]->data.data());
+            file.read(dst, e.byte_size);
+            crc = crc32c(crc, dst, e.byte_size);
+            pos = e.offset + e.byte_size;
+        }
+        if (h.file_size < pos || h.file_size - pos > ALIGNMENT) throw std::runtime_error("Corrupt tensor layout in model file");
+        file.read(padding, h.file_size - pos);
+        crc = crc32c(crc, padding, h.file_size - pos);
+
+        if (!file) throw std::runtime_error("Truncated model file: " + filename);
+        if (crc != h.checksum) throw std::runtime_error("Checksum mismatch in model file: " + filename);
+        return layers;
+    }
+
+    // Copies the weights of an in-memory model (e.g. a checkpoint section)
+    // into existing layers, which must have the same architecture
+    inline void restore(const char* data, size_t size, const std::vector<std::unique_ptr<Layer>>& layers) {
+        if (size < HEADER_SIZE) throw std::runtime_error("Truncated model data");
+        Header h = parse_header(data);
+        if (!header_fits(h, size)) throw std::runtime_error("Truncated model data");
+        if (crc32c(0, data + HEADER_SIZE, size - HEADER_SIZE) != h.checksum) {
+            throw std::runtime_error("Checksum mismatch in model data");
+        }
+
+        std::vector<LayerEntry> layer_entries;
+        std::vector<TensorEntry> tensor_entries;
+        parse_tables(data + HEADER_SIZE, h, layer_entries, tensor_entries);
+        if (layer_entries.size() != layers.size()) throw std::runtime_error("Layer count mismatch in model data");
+
+        for (size_t i = 0; i < layers.size(); ++i) {
+            const LayerEntry& e = layer_entries[i];
+            if (e.type != layers[i]->get_layer_type() || e.config != layers[i]->get_config_string()) {
+                throw std::runtime_error("Layer " + std::to_string(i) + " does not match model data (" + e.type + ")");
+            }
+            std::vector<Tensor*> params = layers[i]->parameters();
+            if (params.size() != e.tensor_count) {
+                throw std::runtime_error("Parameter count mismatch for " + e.type + " in model data");
+            }
+            for (uint32_t k = 0; k < e.tensor_count; ++k) {
+                const TensorEntry& t = tensor_entries[e.first_tensor + k];
+                check_shape(*params[k], t, e.type);
+                std::memcpy(params[k]->data.data(), data + t.offset, t.byte_size);
+            }
+            layers[i]->parameters_changed();
+        }
+    }
+
+#if defined(EDUNET_HAS_MMAP)
+    // Maps the whole file privately. Pages are shared with the page cache
+    // (and every other process mapping the file) until written; writes are
+    // copy-on-write and never reach the file. The mapping is released when
+    // the last owner goes away.
+    inline std::shared_ptr<const void> map_file(const std::string& filename, size_t& size) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open file for reading: " + filename);
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(HEADER_SIZE)) {
+            ::close(fd);
+            throw std::runtime_error("Truncated model file: " + filename);
+        }
+        size = static_cast<size_t>(st.st_size);
+        void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) throw std::runtime_error("Cannot map model file: " + filename);
+        return std::shared_ptr<const void>(base, [size](const void* p) { ::munmap(const_cast<void*>(p), size); });
+    }
+
+    // Like load(), but parameter tensors are views into a mapping of the
+    // file instead of copies, so startup cost does not depend on the model
+    // size. Skips the checksum unless `verify_checksum` is set, since that
+    // would read every weight.
+    inline std::vector<std::unique_ptr<Layer>> load_mapped(
+            const std::string& filename,
+            const std::function<std::unique_ptr<Layer>(const std::string&)>& create_layer,
+            bool verify_checksum = false) {
+        if (!host_is_little_endian()) throw std::runtime_error("Binary model format requires a little-endian host");
+
+        size_t size = 0;
+        std::shared_ptr<const void> mapping = map_file(filename, size);
+        char* base = static_cast<char*>(const_cast<void*>(mapping.get()));
+
+        Header h = parse_header(base);
+        if (!header_fits(h, size)) throw std::runtime_error("Truncated model file: " + filename);
+        if (verify_checksum && crc32c(0, base + HEADER_SIZE, size - HEADER_SIZE) != h.checksum) {
+            throw std::runtime_error("Checksum mismatch in model file: " + filename);
+        }
+
+        std::vector<LayerEntry> layer_entries;
+        std::vector<TensorEntry> tensor_entries;
+        parse_tables(base + HEADER_SIZE, h, layer_entries, tensor_entries);
+
+        // The zero-filled tensors allocated by set_config_from_string are
+        // released only after all layers are set up: freeing large blocks in
+        // between raises malloc's mmap threshold, and later allocations would
+        // then be zero-filled eagerly instead of lazily.
+        std::vector<Tensor> placeholders;
+        std::vector<std::unique_ptr<Layer>> layers;
+        for (const auto& e : layer_entries) {
+            std::unique_ptr<Layer> layer = create_layer(e.type);
+            layer->set_config_from_string(e.config);
+            std::vector<Tensor*> params = layer->parameters();
+            if (params.size() != e.tensor_count) {
+                throw std::runtime_error("Parameter count mismatch for " + e.type + " in model file");
+            }
+            for (uint32_t k = 0; k < e.tensor_count; ++k) {
+                const TensorEntry& t = tensor_entries[e.first_tensor + k];
+                check_shape(*params[k], t, e.type);
+                placeholders.push_back(std::move(*params[k]));
+                *params[k] = Tensor::view(t.shape, reinterpret_cast<float*>(base + t.offset), mapping);
+            }
+            layers.push_back(std::move(layer));
+        }
+        return layers;
+    }
+#else
+    inline std::vector<std::unique_ptr<Layer>> load_mapped(
+            const std::string& filename,
+            const std::function<std::unique_ptr<Layer>(const std::string&)>& create_layer,
+            bool = false) {
+        return load(filename, create_layer);
+    }
+#endif
+
+} // namespace ModelFormat
@@ -3,12 +3,21 @@
 #include <unordered_map>
 #include <memory>
 #include <cmath>
+#include <map>
+#include <string>
 
 class Optimizer {
 public:
     virtual ~Optimizer() = default;
     virtual void step(Sequential& model) = 0;
     virtual void reset() {}
+
+    // Checkpointing: the type name guards against restoring the state of a
+    // different optimizer; write_state appends the state to `out` and
+    // read_state restores it
+    virtual std::string get_optimizer_type() const = 0;
+    virtual void write_state(std::vector<char>& out) const { (void)out; }
+    virtual void read_state(ModelFormat::Reader& in) { (void)in; }
 };
 
 class SGD : public Optimizer {
@@ -16,15 +25,18 @@ private:
     float learning_rate;
 public:
     SGD(float lr = 0.01f) : learning_rate(lr) {}
+
+    std::string get_optimizer_type() const override { return "SGD"; }
     
+    // Every layer's trained parameters (Layer::gradients)
     void step(Sequential& model) override {
         for (const auto& layer_ptr : model.layers) {
-            if (DenseLayer* dense = dynamic_cast<DenseLayer*>(layer_ptr.get())) {
-                for (size_t i = 0; i < dense->weights.data.size(); ++i) dense->weights.data[i] -= learning_rate * dense->grad_weights.data[i];
-                for (size_t i = 0; i < dense->bias.data.size(); ++i) dense->bias.data[i] -= learning_rate * dense->grad_bias.data[i];
-            } else if (Conv2DLayer* conv = dynamic_cast<Conv2DLayer*>(layer_ptr.get())) {
-                for (size_t i = 0; i < conv->kernels.data.size(); ++i) conv->kernels.data[i] -= learning_rate * conv->grad_kernels.data[i];
-                for (size_t i = 0; i < conv->biases.data.size(); ++i) conv->biases.data[i] -= learning_rate * conv->grad_biases.data[i];
+            std::vector<Tensor*> params = layer_ptr->parameters();
+            std::vector<Tensor*> grads = layer_ptr->gradients();
+            for (size_t k = 0; k < grads.size(); ++k) {
+                Tensor& p = *params[k];
+                const Tensor& g = *grads[k];
+                for (size_t i = 0; i < p.data.size(); ++i) p.data[i] -= learning_rate * g.data[i];
             }
         }
     }
@@ -34,7 +46,8 @@ class Adam : public Optimizer {
 private:
     float learning_rate, beta1, beta2, epsilon;
     int timestep;
-    struct LayerMoments { Tensor m_weights, v_weights, m_bias, v_bias; };
+    // First and second moments of each trained parameter of a layer
+    struct LayerMoments { std::vector<Tensor> m, v; };
     // ИСПРАВЛЕНО: Ключ теперь int (индекс слоя), а не Layer*, что гораздо безопаснее
     std::unordered_map<int, LayerMoments> moments;
     
@@ -46,38 +59,76 @@ public:
         timestep++;
         // ИСПРАВЛЕНО: Итерация по модели с использованием индекса
         for (size_t i = 0; i < model.layers.size(); ++i) {
-            auto& layer_ptr = model.layers[i];
-            Layer* layer = layer_ptr.get();
-            DenseLayer* dense = dynamic_cast<DenseLayer*>(layer);
-            Conv2DLayer* conv = dynamic_cast<Conv2DLayer*>(layer);
-            
-            if (!dense && !conv) continue;
+            Layer* layer = model.layers[i].get();
+            std::vector<Tensor*> params = layer->parameters();
+            std::vector<Tensor*> grads = layer->gradients();
+            if (grads.empty()) continue;
 
             // ИСПРАВЛЕНО: Используем индекс 'i' в качестве ключа
-            if (moments.find(i) == moments.end()) {
-                 if (dense) {
-                    moments[i] = {Tensor(dense->weights.shape), Tensor(dense->weights.shape), Tensor(dense->bias.shape), Tensor(dense->bias.shape)};
-                } else if (conv) {
-                    moments[i] = {Tensor(conv->kernels.shape), Tensor(conv->kernels.shape), Tensor(conv->biases.shape), Tensor(conv->biases.shape)};
+            auto& layer_moments = moments[i];
+            if (!moments_fit(layer_moments, params, grads.size())) {
+                layer_moments.m.clear();
+                layer_moments.v.clear();
+                for (size_t k = 0; k < grads.size(); ++k) {
+                    layer_moments.m.emplace_back(params[k]->shape);
+                    layer_moments.v.emplace_back(params[k]->shape);
                 }
             }
-            
-            // ИСПРАВЛЕНО: Используем индекс 'i' для доступа к моментам
-            auto& layer_moments = moments[i];
-            
-            if (dense) {
-                update_parameters(dense->weights, dense->grad_weights, layer_moments.m_weights, layer_moments.v_weights);
-                update_parameters(dense->bias, dense->grad_bias, layer_moments.m_bias, layer_moments.v_bias);
-            } else if (conv) {
-                update_parameters(conv->kernels, conv->grad_kernels, layer_moments.m_weights, layer_moments.v_weights);
-                update_parameters(conv->biases, conv->grad_biases, layer_moments.m_bias, layer_moments.v_bias);
+            for (size_t k = 0; k < grads.size(); ++k) {
+                update_parameters(*params[k], *grads[k], layer_moments.m[k], layer_moments.v[k]);
             }
         }
     }
     
     void reset() override { moments.clear(); timestep = 0; }
+
+    std::string get_optimizer_type() const override { return "Adam"; }
+
+    // timestep, then per layer in layer order its index, the number of
+    // trained parameters and the two moments of each
+    void write_state(std::vector<char>& out) const override {
+        ModelFormat::put_u32(out, static_cast<uint32_t>(timestep));
+        ModelFormat::put_u32(out, static_cast<uint32_t>(moments.size()));
+        std::map<int, const LayerMoments*> ordered;
+        for (const auto& [index, m] : moments) ordered[index] = &m;
+        for (const auto& [index, m] : ordered) {
+            ModelFormat::put_u32(out, static_cast<uint32_t>(index));
+            ModelFormat::put_u32(out, static_cast<uint32_t>(m->m.size()));
+            for (size_t k = 0; k < m->m.size(); ++k) {
+                ModelFormat::put_tensor(out, m->m[k]);
+                ModelFormat::put_tensor(out, m->v[k]);
+            }
+        }
+    }
+
+    void read_state(ModelFormat::Reader& in) override {
+        moments.clear();
+        timestep = static_cast<int>(in.u32());
+        uint32_t count = in.u32();
+        for (uint32_t k = 0; k < count; ++k) {
+            int index = static_cast<int>(in.u32());
+            LayerMoments& m = moments[index];
+            uint32_t tensors = in.u32();
+            for (uint32_t t = 0; t < tensors; ++t) {
+                m.m.push_back(in.tensor());
+                m.v.push_back(in.tensor());
+                if (m.m.back().shape != m.v.back().shape) throw std::runtime_error("Corrupt Adam state in checkpoint");
+            }
+        }
+    }
     
 private:
+    // Moments are keyed by layer index, which fuse() and fold_batch_norm()
+    // renumber, and restored state may come from another model; an entry
+    // whose shapes differ from the layer's parameters is started afresh
+    static bool moments_fit(const LayerMoments& entry, const std::vector<Tensor*>& params, size_t count) {
+        if (entry.m.size() != count || entry.v.size() != count) return false;
+        for (size_t k = 0; k < count; ++k) {
+            if (entry.m[k].shape != params[k]->shape || entry.v[k].shape != params[k]->shape) return false;
+        }
+        return true;
+    }
+
     void update_parameters(Tensor& params, const Tensor& grads, Tensor& m, Tensor& v) {
         for (size_t i = 0; i < m.data.size(); ++i) m.data[i] = beta1 * m.data[i] + (1 - beta1) * grads.data[i];
         for (size_t i = 0; i < v.data.size(); ++i) v.data[i] = beta2 * v.data[i] + (1 - beta2) * grads.data[i] * grads.data[i];
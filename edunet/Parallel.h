@@ -0,0 +1,57 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+// Splits a loop over independent items across threads. Every call starts
+// its own workers, so callers pass how many items make a chunk worth a
+// thread start (tens of microseconds of work). Results do not depend on
+// the thread count as long as the items are independent.
+namespace Parallel {
+
+    // CPUs this process may run on: the affinity mask (taskset, cgroups,
+    // a benchmark's pinning) rather than every core of the machine
+    inline int available_cpus() {
+#if defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) return std::max(1, CPU_COUNT(&allowed));
+#endif
+        return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    inline int& thread_count() {
+        static int count = available_cpus();
+        return count;
+    }
+
+    inline int threads() { return thread_count(); }
+
+    // 1 runs everything on the calling thread
+    inline void set_threads(int n) { thread_count() = std::max(1, n); }
+
+    // fn(begin, end) over contiguous chunks of [0, count); the calling
+    // thread takes the first chunk. fn must not throw.
+    template<typename F>
+    void for_range(size_t count, size_t min_per_thread, F&& fn) {
+        const size_t workers = std::min<size_t>(threads(), count / std::max<size_t>(min_per_thread, 1));
+        if (workers <= 1) {
+            fn(size_t(0), count);
+            return;
+        }
+        const size_t chunk = (count + workers - 1) / workers;
+        std::vector<std::thread> pool;
+        pool.reserve(workers - 1);
+        for (size_t begin = chunk; begin < count; begin += chunk) {
+            const size_t end = std::min(count, begin + chunk);
+            pool.emplace_back([&fn, begin, end]() { fn(begin, end); });
+        }
+        fn(size_t(0), chunk);
+        for (std::thread& t : pool) t.join();
+    }
+
+} // namespace Parallel
@@ -0,0 +1,245 @@
+#pragma once
+#include "TensorStorage.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Built-in instrumentation for Sequential and Trainer. While enabled, every
+// layer's forward/backward call and the trainer's phases are recorded as
+// timed events carrying an estimated FLOP count, the bytes the operation
+// reads and writes, and the Tensor buffers it allocated. Disabled (the
+// default), instrumented code pays one relaxed atomic load per call.
+//
+//   Profiler::enable();
+//   trainer.fit(...);
+//   model.summary();                            // per-layer table
+//   Profiler::print_report();                   // per-phase table
+//   Profiler::write_chrome_trace("trace.json"); // chrome://tracing, Perfetto
+namespace Profiler {
+
+    enum class Phase { Forward, Backward, Loss, OptimizerStep, BatchAssembly, TrainStep };
+    constexpr size_t PHASE_COUNT = 6;
+
+    inline const char* phase_name(Phase phase) {
+        switch (phase) {
+            case Phase::Forward: return "forward";
+            case Phase::Backward: return "backward";
+            case Phase::Loss: return "loss";
+            case Phase::OptimizerStep: return "optimizer step";
+            case Phase::BatchAssembly: return "batch assembly";
+            case Phase::TrainStep: return "train step";
+        }
+        return "?";
+    }
+
+    struct Event {
+        std::string name;
+        Phase phase;
+        double start_us;
+        double duration_us;
+        double flops;
+        double bytes;
+        unsigned long long allocations;
+        unsigned long long allocated_bytes;
+        int thread;
+    };
+
+    struct Totals {
+        long long calls = 0;
+        double time_us = 0.0;
+        double flops = 0.0;
+        double bytes = 0.0;
+        unsigned long long allocations = 0;
+        unsigned long long allocated_bytes = 0;
+
+        void add(const Event& e) {
+            calls++;
+            time_us += e.duration_us;
+            flops += e.flops;
+            bytes += e.bytes;
+            allocations += e.allocations;
+            allocated_bytes += e.allocated_bytes;
+        }
+    };
+
+    using PhaseTotals = std::array<Totals, PHASE_COUNT>;
+
+    struct State {
+        std::atomic<bool> enabled{false};
+        std::mutex mutex;
+        std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        std::vector<Event> events;                 // trace, capped at max_events
+        size_t max_events = 1 << 20;
+        unsigned long long dropped_events = 0;
+        PhaseTotals phases;                        // all events
+        std::map<const void*, PhaseTotals> owners; // events of one layer (or other owner)
+        std::map<std::thread::id, int> threads;    // small ids for the trace
+    };
+
+    inline State& state() {
+        static State s;
+        return s;
+    }
+
+    inline bool enabled() { return state().enabled.load(std::memory_order_relaxed); }
+    inline void enable(bool on = true) { state().enabled.store(on, std::memory_order_relaxed); }
+    inline void disable() { enable(false); }
+
+    // Drops all recorded events and totals; trace timestamps restart at 0
+    inline void reset() {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.events.clear();
+        s.dropped_events = 0;
+        s.phases = PhaseTotals();
+        s.owners.clear();
+        s.origin = std::chrono::steady_clock::now();
+    }
+
+    inline void record(Event event, const void* owner) {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto thread = s.threads.emplace(std::this_thread::get_id(), static_cast<int>(s.threads.size()) + 1).first;
+        event.thread = thread->second;
+        s.phases[static_cast<size_t>(event.phase)].add(event);
+        if (owner) s.owners[owner][static_cast<size_t>(event.phase)].add(event);
+        if (s.events.size() < s.max_events) {
+            s.events.push_back(std::move(event));
+        } else {
+            s.dropped_events++;
+        }
+    }
+
+    // Times the enclosing block as one event. Allocations are the Tensor
+    // buffers the calling thread allocated meanwhile (TensorStorage).
+    // Constructed while the profiler is disabled, it records nothing.
+    class Scope {
+    public:
+        Scope(std::string name, Phase phase, const void* owner = nullptr) : active(enabled()) {
+            if (!active) return;
+            event.name = std::move(name);
+            event.phase = phase;
+            event.flops = event.bytes = 0.0;
+            this->owner = owner;
+            const TensorStorage::AllocationStats& stats = TensorStorage::allocation_stats();
+            allocations_before = stats.count;
+            allocated_bytes_before = stats.bytes;
+            start = std::chrono::steady_clock::now();
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void set_work(double flops, double bytes) {
+            event.flops = flops;
+            event.bytes = bytes;
+        }
+
+        ~Scope() {
+            if (!active) return;
+            auto end = std::chrono::steady_clock::now();
+            const TensorStorage::AllocationStats& stats = TensorStorage::allocation_stats();
+            event.allocations = stats.count - allocations_before;
+            event.allocated_bytes = stats.bytes - allocated_bytes_before;
+            event.start_us = std::chrono::duration<double, std::micro>(start - state().origin).count();
+            event.duration_us = std::chrono::duration<double, std::micro>(end - start).count();
+            record(std::move(event), owner);
+        }
+
+    private:
+        bool active;
+        Event event;
+        const void* owner = nullptr;
+        unsigned long long allocations_before = 0;
+        unsigned long long allocated_bytes_before = 0;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    inline PhaseTotals totals() {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.phases;
+    }
+
+    // Totals of the events recorded for `owner` (e.g. one layer); false if none
+    inline bool totals_for(const void* owner, PhaseTotals& out) {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.owners.find(owner);
+        if (it == s.owners.end()) return false;
+        out = it->second;
+        return true;
+    }
+
+    // FLOP/s and byte/s helpers for the tables; 0 for empty totals
+    inline double gflops(const Totals& t) { return t.time_us > 0 ? t.flops / (t.time_us * 1e3) : 0.0; }
+    inline double gbytes_per_s(const Totals& t) { return t.time_us > 0 ? t.bytes / (t.time_us * 1e3) : 0.0; }
+
+    inline void print_report(std::ostream& os = std::cout) {
+        PhaseTotals phases = totals();
+        os << "Profile by phase:" << std::endl;
+        os << std::left << std::setw(16) << "Phase" << std::right << std::setw(10) << "Calls" << std::setw(12) << "Total ms"
+           << std::setw(12) << "Avg us" << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s" << std::setw(12) << "Allocs" << std::endl;
+        std::ios_base::fmtflags flags = os.flags();
+        os << std::fixed;
+        for (size_t p = 0; p < PHASE_COUNT; ++p) {
+            const Totals& t = phases[p];
+            if (!t.calls) continue;
+            os << std::left << std::setw(16) << phase_name(static_cast<Phase>(p)) << std::right << std::setw(10) << t.calls
+               << std::setw(12) << std::setprecision(2) << t.time_us / 1e3 << std::setw(12) << t.time_us / t.calls
+               << std::setw(10) << gflops(t) << std::setw(10) << gbytes_per_s(t) << std::setw(12) << t.allocations << std::endl;
+        }
+        os.flags(flags);
+        if (phases[static_cast<size_t>(Phase::TrainStep)].calls) {
+            os << "(train step includes the forward, loss, backward and optimizer phases)" << std::endl;
+        }
+    }
+
+    inline std::string json_escape(const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) < 0x20) continue;
+            out += c;
+        }
+        return out;
+    }
+
+    // Chrome trace-event JSON ("X" complete events, microseconds)
+    inline void write_chrome_trace(const std::string& filename) {
+        std::ofstream file(filename);
+        if (!file) throw std::runtime_error("Cannot open file for writing: " + filename);
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (const auto& thread : s.threads) {
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.second
+                 << ",\"args\":{\"name\":\"thread " << thread.second << "\"}}";
+            first = false;
+        }
+        for (const Event& e : s.events) {
+            file << (first ? "" : ",\n") << "{\"name\":\"" << json_escape(e.name) << "\",\"cat\":\"" << phase_name(e.phase)
+                 << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":" << e.start_us << ",\"dur\":" << e.duration_us
+                 << ",\"args\":{\"flops\":" << std::setprecision(0) << e.flops << ",\"bytes\":" << e.bytes
+                 << ",\"allocations\":" << e.allocations << ",\"allocated_bytes\":" << e.allocated_bytes << "}}"
+                 << std::setprecision(3);
+            first = false;
+        }
+        file << "\n]}\n";
+        if (s.dropped_events) {
+            std::cerr << "Profiler: trace truncated, " << s.dropped_events << " events dropped" << std::endl;
+        }
+    }
+
+} // namespace Profiler
@@ -0,0 +1,609 @@
+#pragma once
+#include "Sequential.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Post-training int8 quantization for inference.
+//
+// Activations are uint8 with one scale and zero point per tensor, calibrated
+// on sample inputs. Weights are int8, symmetric, with one scale per output
+// channel. Dense and Conv2D layers (Conv2D through im2col) run as
+// uint8 x int8 -> int32 GEMMs, and the int32 sums are requantized straight
+// into the next layer's uint8 input with the bias and a following ReLU fused
+// in. Layers without an int8 kernel run in fp32 between a dequantize and a
+// quantize step.
+namespace Int8 {
+
+    // GEMM reduction dimensions are zero-padded to a multiple of this
+    constexpr int K_ALIGN = 32;
+
+    inline int pad_k(int k) { return (k + K_ALIGN - 1) / K_ALIGN * K_ALIGN; }
+
+    // real = scale * (q - zero_point)
+    struct QuantParams {
+        float scale = 1.0f;
+        int zero_point = 0;
+    };
+
+    // Asymmetric uint8 parameters covering [min_val, max_val] and zero
+    inline QuantParams choose_params(float min_val, float max_val) {
+        min_val = std::min(min_val, 0.0f);
+        max_val = std::max(max_val, 0.0f);
+        QuantParams q;
+        q.scale = (max_val > min_val) ? (max_val - min_val) / 255.0f : 1.0f;
+        q.zero_point = std::clamp(static_cast<int>(std::lround(-min_val / q.scale)), 0, 255);
+        return q;
+    }
+
+    // uint8 activations and their quantization parameters
+    struct QTensor {
+        std::vector<int> shape;
+        std::vector<uint8_t> data;
+        QuantParams q;
+
+        void resize(const std::vector<int>& s) {
+            shape = s;
+            size_t total = 1;
+            for (int d : s) total *= d;
+            data.resize(total);
+        }
+    };
+
+    inline void quantize(const Tensor& x, QuantParams q, QTensor& out) {
+        out.resize(x.shape);
+        out.q = q;
+        float inv_scale = 1.0f / q.scale;
+        for (size_t i = 0; i < x.data.size(); ++i) {
+            int v = static_cast<int>(std::lrint(x.data[i] * inv_scale)) + q.zero_point;
+            out.data[i] = static_cast<uint8_t>(std::clamp(v, 0, 255));
+        }
+    }
+
+    inline void dequantize(const QTensor& x, Tensor& out) {
+        out.resize(x.shape);
+        for (size_t i = 0; i < x.data.size(); ++i) {
+            out.data[i] = x.q.scale * (static_cast<int>(x.data[i]) - x.q.zero_point);
+        }
+    }
+
+    // --- uint8 x int8 -> int32 kernels ---
+
+#if defined(__AVX2__)
+    // acc += the 32 u8*s8 products of a and b, summed into 32-bit lanes.
+    // Only the horizontal sum is meaningful: VNNI adds 4 adjacent products
+    // per lane, the AVX2 fallback two pairs, one from each 128-bit half.
+    inline __m256i dot_accumulate(__m256i acc, __m256i a, __m256i b) {
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+        return _mm256_dpbusd_epi32(acc, a, b);
+#elif defined(__AVXVNNI__)
+        return _mm256_dpbusd_avx_epi32(acc, a, b);
+#else
+        // Widen to 16 bits and use _mm256_madd_epi16 only:
+        // _mm256_maddubs_epi16 would saturate the pair sums
+        __m256i a_lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(a));
+        __m256i a_hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(a, 1));
+        __m256i b_lo = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(b));
+        __m256i b_hi = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(b, 1));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a_lo, b_lo));
+        return _mm256_add_epi32(acc, _mm256_madd_epi16(a_hi, b_hi));
+#endif
+    }
+
+    inline int32_t horizontal_sum(__m256i v) {
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(s);
+    }
+#endif
+
+    // Dot product of K values, K a multiple of K_ALIGN
+    inline int32_t dot_u8s8(const uint8_t* a, const int8_t* b, int K) {
+#if defined(__AVX2__)
+        __m256i acc = _mm256_setzero_si256();
+        for (int k = 0; k < K; k += K_ALIGN) {
+            acc = dot_accumulate(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + k)),
+                                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + k)));
+        }
+        return horizontal_sum(acc);
+#else
+        int32_t sum = 0;
+        for (int k = 0; k < K; ++k) sum += static_cast<int32_t>(a[k]) * b[k];
+        return sum;
+#endif
+    }
+
+#if defined(__AVX2__)
+    // 4x4 block of C: rows r..r+3 of A against rows n..n+3 of B. The sixteen
+    // accumulators are spelled out so they stay in registers at -O2.
+    inline void gemm_block_4x4(const uint8_t* A, const int8_t* B, int N, int K, int32_t* C) {
+        const uint8_t* a0 = A;
+        const uint8_t* a1 = a0 + K;
+        const uint8_t* a2 = a1 + K;
+        const uint8_t* a3 = a2 + K;
+        const int8_t* b0 = B;
+        const int8_t* b1 = b0 + K;
+        const int8_t* b2 = b1 + K;
+        const int8_t* b3 = b2 + K;
+        __m256i c00 = _mm256_setzero_si256(), c01 = c00, c02 = c00, c03 = c00;
+        __m256i c10 = c00, c11 = c00, c12 = c00, c13 = c00;
+        __m256i c20 = c00, c21 = c00, c22 = c00, c23 = c00;
+        __m256i c30 = c00, c31 = c00, c32 = c00, c33 = c00;
+        for (int k = 0; k < K; k += K_ALIGN) {
+            __m256i vb0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b0 + k));
+            __m256i vb1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b1 + k));
+            __m256i vb2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b2 + k));
+            __m256i vb3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b3 + k));
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a0 + k));
+            c00 = dot_accumulate(c00, va, vb0); c01 = dot_accumulate(c01, va, vb1);
+            c02 = dot_accumulate(c02, va, vb2); c03 = dot_accumulate(c03, va, vb3);
+            va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a1 + k));
+            c10 = dot_accumulate(c10, va, vb0); c11 = dot_accumulate(c11, va, vb1);
+            c12 = dot_accumulate(c12, va, vb2); c13 = dot_accumulate(c13, va, vb3);
+            va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a2 + k));
+            c20 = dot_accumulate(c20, va, vb0); c21 = dot_accumulate(c21, va, vb1);
+            c22 = dot_accumulate(c22, va, vb2); c23 = dot_accumulate(c23, va, vb3);
+            va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a3 + k));
+            c30 = dot_accumulate(c30, va, vb0); c31 = dot_accumulate(c31, va, vb1);
+            c32 = dot_accumulate(c32, va, vb2); c33 = dot_accumulate(c33, va, vb3);
+        }
+        int32_t* r0 = C;
+        int32_t* r1 = r0 + N;
+        int32_t* r2 = r1 + N;
+        int32_t* r3 = r2 + N;
+        r0[0] = horizontal_sum(c00); r0[1] = horizontal_sum(c01); r0[2] = horizontal_sum(c02); r0[3] = horizontal_sum(c03);
+        r1[0] = horizontal_sum(c10); r1[1] = horizontal_sum(c11); r1[2] = horizontal_sum(c12); r1[3] = horizontal_sum(c13);
+        r2[0] = horizontal_sum(c20); r2[1] = horizontal_sum(c21); r2[2] = horizontal_sum(c22); r2[3] = horizontal_sum(c23);
+        r3[0] = horizontal_sum(c30); r3[1] = horizontal_sum(c31); r3[2] = horizontal_sum(c32); r3[3] = horizontal_sum(c33);
+    }
+
+    // 1x4 block of C for the rows left over by gemm_block_4x4
+    inline void gemm_block_1x4(const uint8_t* a, const int8_t* B, int K, int32_t* c) {
+        const int8_t* b0 = B;
+        const int8_t* b1 = b0 + K;
+        const int8_t* b2 = b1 + K;
+        const int8_t* b3 = b2 + K;
+        __m256i c0 = _mm256_setzero_si256(), c1 = c0, c2 = c0, c3 = c0;
+        for (int k = 0; k < K; k += K_ALIGN) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + k));
+            c0 = dot_accumulate(c0, va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b0 + k)));
+            c1 = dot_accumulate(c1, va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b1 + k)));
+            c2 = dot_accumulate(c2, va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b2 + k)));
+            c3 = dot_accumulate(c3, va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b3 + k)));
+        }
+        c[0] = horizontal_sum(c0);
+        c[1] = horizontal_sum(c1);
+        c[2] = horizontal_sum(c2);
+        c[3] = horizontal_sum(c3);
+    }
+#endif
+
+    // C[m * N + n] = sum_k A[m * K + k] * B[n * K + k], K a multiple of
+    // K_ALIGN. Both operands are K-contiguous; the SIMD path works on 4x4
+    // blocks of C so each load of A or B feeds four dot products.
+    inline void gemm_u8s8(const uint8_t* A, int M, const int8_t* B, int N, int K, int32_t* C) {
+        int m = 0;
+#if defined(__AVX2__)
+        int N4 = N / 4 * 4;
+        for (; m + 4 <= M; m += 4) {
+            for (int n = 0; n < N4; n += 4) {
+                gemm_block_4x4(A + static_cast<size_t>(m) * K, B + static_cast<size_t>(n) * K, N, K,
+                               C + static_cast<size_t>(m) * N + n);
+            }
+        }
+        for (int r = m; r < M; ++r) {
+            for (int n = 0; n < N4; n += 4) {
+                gemm_block_1x4(A + static_cast<size_t>(r) * K, B + static_cast<size_t>(n) * K, K,
+                               C + static_cast<size_t>(r) * N + n);
+            }
+        }
+        for (int r = 0; r < M; ++r) {
+            for (int n = N4; n < N; ++n) {
+                C[static_cast<size_t>(r) * N + n] = dot_u8s8(A + static_cast<size_t>(r) * K, B + static_cast<size_t>(n) * K, K);
+            }
+        }
+#else
+        for (; m < M; ++m) {
+            for (int n = 0; n < N; ++n) {
+                C[static_cast<size_t>(m) * N + n] = dot_u8s8(A + static_cast<size_t>(m) * K, B + static_cast<size_t>(n) * K, K);
+            }
+        }
+#endif
+    }
+
+    // Name of the dot-product path compiled in
+    inline const char* kernel_name() {
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+        return "AVX512-VNNI";
+#elif defined(__AVXVNNI__)
+        return "AVX-VNNI";
+#elif defined(__AVX2__)
+        return "AVX2";
+#else
+        return "scalar";
+#endif
+    }
+
+    // --- quantized operators ---
+
+    class QuantizedOp {
+    public:
+        virtual ~QuantizedOp() = default;
+        virtual void run(const QTensor& input, QTensor& output) = 0;
+        virtual std::string name() const = 0;
+        virtual size_t weight_bytes() const { return 0; }
+    };
+
+    // Per-output-channel int8 weights of a Dense or Conv2D layer, stored as
+    // rows of K padded values, and the folded requantization constants:
+    //   q_out = clamp(round(acc * multiplier[c] + offset[c]), low, 255)
+    // where acc = sum(q_in * q_w) over the row.
+    class ChannelWeights {
+    public:
+        int channels = 0;
+        int K = 0;
+        int K_padded = 0;
+        std::vector<int8_t> weights;
+        std::vector<float> multiplier;
+        std::vector<float> offset;
+        int low = 0;
+        bool relu = false;
+
+        // `w(c, k)` returns the fp32 weight of channel c at position k
+        template<typename GetWeight>
+        void build(int num_channels, int k_size, GetWeight w, const float* bias,
+                   QuantParams in, QuantParams out, bool fuse_relu) {
+            channels = num_channels;
+            relu = fuse_relu;
+            K = k_size;
+            K_padded = pad_k(K);
+            weights.assign(static_cast<size_t>(channels) * K_padded, 0);
+            multiplier.resize(channels);
+            offset.resize(channels);
+            for (int c = 0; c < channels; ++c) {
+                float max_abs = 0.0f;
+                for (int k = 0; k < K; ++k) max_abs = std::max(max_abs, std::fabs(w(c, k)));
+                float w_scale = (max_abs > 0.0f) ? max_abs / 127.0f : 1.0f;
+                int32_t row_sum = 0;
+                int8_t* row = weights.data() + static_cast<size_t>(c) * K_padded;
+                for (int k = 0; k < K; ++k) {
+                    int q = std::clamp(static_cast<int>(std::lrint(w(c, k) / w_scale)), -127, 127);
+                    row[k] = static_cast<int8_t>(q);
+                    row_sum += q;
+                }
+                // The input zero point's contribution, zp_in * row_sum, is
+                // folded into the offset together with the bias
+                float real_scale = in.scale * w_scale;
+                multiplier[c] = real_scale / out.scale;
+                offset[c] = (bias[c] - real_scale * in.zero_point * row_sum) / out.scale + out.zero_point;
+            }
+            low = fuse_relu ? out.zero_point : 0;
+        }
+
+        uint8_t requantize(int32_t acc, int c) const {
+            int v = static_cast<int>(std::lrint(acc * multiplier[c] + offset[c]));
+            return static_cast<uint8_t>(std::clamp(v, low, 255));
+        }
+
+        size_t bytes() const { return weights.size() + 2 * multiplier.size() * sizeof(float); }
+    };
+
+    class QuantizedDense : public QuantizedOp {
+    private:
+        ChannelWeights w;
+        QuantParams out_params;
+        std::vector<uint8_t> padded;
+        std::vector<int32_t> acc;
+    public:
+        QuantizedDense(const DenseLayer& layer, QuantParams in, QuantParams out, bool relu) : out_params(out) {
+            const Tensor& weights = layer.weights;   // [in, out]
+            int outputs = weights.shape[1];
+            w.build(outputs, weights.shape[0],
+                    [&](int c, int k) { return weights.data[static_cast<size_t>(k) * outputs + c]; },
+                    layer.bias.data.data(), in, out, relu);
+        }
+
+        void run(const QTensor& input, QTensor& output) override {
+            if (input.shape.size() != 2 || input.shape[1] != w.K) {
+                throw std::runtime_error("Input size mismatch in QuantizedDense");
+            }
+            int batch = input.shape[0];
+            const uint8_t* a = input.data.data();
+            if (w.K != w.K_padded) {
+                padded.assign(static_cast<size_t>(batch) * w.K_padded, 0);
+                for (int m = 0; m < batch; ++m) {
+                    std::memcpy(padded.data() + static_cast<size_t>(m) * w.K_padded, a + static_cast<size_t>(m) * w.K, w.K);
+                }
+                a = padded.data();
+            }
+            acc.resize(static_cast<size_t>(batch) * w.channels);
+            gemm_u8s8(a, batch, w.weights.data(), w.channels, w.K_padded, acc.data());
+
+            output.resize({batch, w.channels});
+            output.q = out_params;
+            for (int m = 0; m < batch; ++m) {
+                for (int c = 0; c < w.channels; ++c) {
+                    size_t i = static_cast<size_t>(m) * w.channels + c;
+                    output.data[i] = w.requantize(acc[i], c);
+                }
+            }
+        }
+
+        std::string name() const override { return w.relu ? "QuantizedDense+ReLU" : "QuantizedDense"; }
+        size_t weight_bytes() const override { return w.bytes(); }
+    };
+
+    class QuantizedConv : public QuantizedOp {
+    private:
+        ChannelWeights w;
+        QuantParams out_params;
+        int in_channels, kernel_size, stride, padding;
+        std::vector<uint8_t> columns;
+        std::vector<int32_t> acc;
+    public:
+        QuantizedConv(const Conv2DLayer& layer, QuantParams in, QuantParams out, bool relu) : out_params(out) {
+            const Tensor& kernels = layer.kernels;   // [C_out, C_in, k, k]
+            std::string config = layer.get_config_string();
+            in_channels = kernels.shape[1];
+            kernel_size = kernels.shape[2];
+            stride = std::stoi(Layer::config_value(config, "stride"));
+            padding = std::stoi(Layer::config_value(config, "padding"));
+            int K = in_channels * kernel_size * kernel_size;
+            w.build(kernels.shape[0], K,
+                    [&](int c, int k) { return kernels.data[static_cast<size_t>(c) * K + k]; },
+                    layer.biases.data.data(), in, out, relu);
+        }
+
+        void run(const QTensor& input, QTensor& output) override {
+            if (input.shape.size() != 4 || input.shape[1] != in_channels) {
+                throw std::runtime_error("Input shape mismatch in QuantizedConv");
+            }
+            int N = input.shape[0], H_in = input.shape[2], W_in = input.shape[3];
+            int H_out = (H_in + 2 * padding - kernel_size) / stride + 1;
+            int W_out = (W_in + 2 * padding - kernel_size) / stride + 1;
+            int P = H_out * W_out;
+            output.resize({N, w.channels, H_out, W_out});
+            output.q = out_params;
+
+            // im2col: one padded row of C_in*k*k inputs per output pixel.
+            // Padding pixels hold the zero point, i.e. the real value 0.
+            columns.assign(static_cast<size_t>(P) * w.K_padded, 0);
+            acc.resize(static_cast<size_t>(P) * w.channels);
+            const uint8_t pad_value = static_cast<uint8_t>(input.q.zero_point);
+            for (int n = 0; n < N; ++n) {
+                const uint8_t* image = input.data.data() + static_cast<size_t>(n) * in_channels * H_in * W_in;
+                for (int h = 0; h < H_out; ++h) {
+                    for (int x = 0; x < W_out; ++x) {
+                        uint8_t* row = columns.data() + static_cast<size_t>(h * W_out + x) * w.K_padded;
+                        for (int c = 0; c < in_channels; ++c) {
+                            for (int kh = 0; kh < kernel_size; ++kh) {
+                                int h_in = h * stride + kh - padding;
+                                for (int kw = 0; kw < kernel_size; ++kw) {
+                                    int w_in = x * stride + kw - padding;
+                                    bool inside = h_in >= 0 && h_in < H_in && w_in >= 0 && w_in < W_in;
+                                    *row++ = inside ? image[(c * H_in + h_in) * W_in + w_in] : pad_value;
+                                }
+                            }
+                        }
+                    }
+                }
+                gemm_u8s8(columns.data(), P, w.weights.data(), w.channels, w.K_padded, acc.data());
+
+                uint8_t* out = output.data.data() + static_cast<size_t>(n) * w.channels * P;
+                for (int p = 0; p < P; ++p) {
+                    for (int c = 0; c < w.channels; ++c) {
+                        out[static_cast<size_t>(c) * P + p] = w.requantize(acc[static_cast<size_t>(p) * w.channels + c], c);
+                    }
+                }
+            }
+        }
+
+        std::string name() const override { return w.relu ? "QuantizedConv+ReLU" : "QuantizedConv"; }
+        size_t weight_bytes() const override { return w.bytes(); }
+    };
+
+    // Max pooling commutes with the (monotonic) quantization
+    class QuantizedMaxPool : public QuantizedOp {
+    private:
+        int pool_size, stride;
+    public:
+        QuantizedMaxPool(int pool_size, int stride) : pool_size(pool_size), stride(stride) {}
+
+        void run(const QTensor& input, QTensor& output) override {
+            int N = input.shape[0], C = input.shape[1], H_in = input.shape[2], W_in = input.shape[3];
+            int H_out = (H_in - pool_size) / stride + 1;
+            int W_out = (W_in - pool_size) / stride + 1;
+            output.resize({N, C, H_out, W_out});
+            output.q = input.q;
+            uint8_t* out = output.data.data();
+            for (int plane = 0; plane < N * C; ++plane) {
+                const uint8_t* in = input.data.data() + static_cast<size_t>(plane) * H_in * W_in;
+                for (int h = 0; h < H_out; ++h) {
+                    for (int x = 0; x < W_out; ++x) {
+                        uint8_t best = 0;
+                        for (int ph = 0; ph < pool_size; ++ph) {
+                            const uint8_t* row = in + (h * stride + ph) * W_in + x * stride;
+                            for (int pw = 0; pw < pool_size; ++pw) best = std::max(best, row[pw]);
+                        }
+                        *out++ = best;
+                    }
+                }
+            }
+        }
+
+        std::string name() const override { return "QuantizedMaxPool"; }
+    };
+
+    class QuantizedReLU : public QuantizedOp {
+    public:
+        void run(const QTensor& input, QTensor& output) override {
+            output.resize(input.shape);
+            output.q = input.q;
+            uint8_t zero = static_cast<uint8_t>(input.q.zero_point);
+            for (size_t i = 0; i < input.data.size(); ++i) output.data[i] = std::max(input.data[i], zero);
+        }
+        std::string name() const override { return "QuantizedReLU"; }
+    };
+
+    // Flatten (a reshape) and inference-mode Dropout (the identity)
+    class QuantizedReshape : public QuantizedOp {
+    private:
+        bool flatten;
+    public:
+        explicit QuantizedReshape(bool flatten) : flatten(flatten) {}
+        void run(const QTensor& input, QTensor& output) override {
+            output.q = input.q;
+            output.data = input.data;
+            if (flatten) {
+                int features = 1;
+                for (size_t i = 1; i < input.shape.size(); ++i) features *= input.shape[i];
+                output.shape = {input.shape[0], features};
+            } else {
+                output.shape = input.shape;
+            }
+        }
+        std::string name() const override { return flatten ? "Flatten" : "Identity"; }
+    };
+
+    // Any other layer, run in fp32 between dequantize and quantize
+    class FloatFallback : public QuantizedOp {
+    private:
+        std::unique_ptr<Layer> layer;
+        QuantParams out_params;
+        Tensor in_float;
+    public:
+        FloatFallback(const Layer& l, QuantParams out) : layer(l.clone()), out_params(out) { layer->eval(); }
+        void run(const QTensor& input, QTensor& output) override {
+            dequantize(input, in_float);
+            quantize(layer->forward(in_float), out_params, output);
+        }
+        std::string name() const override { return layer->get_layer_type() + " (fp32)"; }
+    };
+
+} // namespace Int8
+
+// int8 inference version of a trained Sequential, built by quantize().
+// Layers after the last int8-capable one (e.g. the final Softmax) run in
+// fp32 on the dequantized output.
+class QuantizedSequential {
+private:
+    Int8::QuantParams input_params;
+    std::vector<std::unique_ptr<Int8::QuantizedOp>> ops;
+    std::vector<std::unique_ptr<Layer>> float_tail;
+    Int8::QTensor buffers[2];
+
+public:
+    // Runs `model` in eval mode over the calibration batches to record the
+    // range of every activation, then converts its layers
+    static QuantizedSequential quantize(Sequential& model, const std::vector<Tensor>& calibration) {
+        if (calibration.empty()) throw std::runtime_error("Quantization needs at least one calibration batch");
+        const size_t L = model.layers.size();
+        float in_min = std::numeric_limits<float>::max(), in_max = std::numeric_limits<float>::lowest();
+        std::vector<float> out_min(L, std::numeric_limits<float>::max());
+        std::vector<float> out_max(L, std::numeric_limits<float>::lowest());
+
+        model.eval();
+        for (const Tensor& batch : calibration) {
+            for (float v : batch.data) { in_min = std::min(in_min, v); in_max = std::max(in_max, v); }
+            Tensor x = batch;
+            for (size_t i = 0; i < L; ++i) {
+                x = model.layers[i]->forward(x);
+                for (float v : x.data) { out_min[i] = std::min(out_min[i], v); out_max[i] = std::max(out_max[i], v); }
+            }
+        }
+
+        // Layers from `tail` on stay in fp32
+        size_t tail = L;
+        while (tail > 0 && !is_int8_capable(*model.layers[tail - 1])) --tail;
+
+        QuantizedSequential q;
+        q.input_params = Int8::choose_params(in_min, in_max);
+        Int8::QuantParams current = q.input_params;
+        for (size_t i = 0; i < tail; ++i) {
+            Layer* layer = model.layers[i].get();
+            bool relu_next = i + 1 < tail && dynamic_cast<ReLULayer*>(model.layers[i + 1].get());
+            if (auto* dense = dynamic_cast<DenseLayer*>(layer)) {
+                bool fused = dynamic_cast<FusedDenseLayer*>(layer) != nullptr;
+                size_t last = relu_next && !fused ? i + 1 : i;
+                Int8::QuantParams out = Int8::choose_params(out_min[last], out_max[last]);
+                q.ops.push_back(std::make_unique<Int8::QuantizedDense>(*dense, current, out, relu_next || fused));
+                current = out;
+                i = last;
+            } else if (auto* conv = dynamic_cast<Conv2DLayer*>(layer)) {
+                auto* fused = dynamic_cast<FusedConv2DLayer*>(layer);
+                size_t last = relu_next && !fused ? i + 1 : i;
+                Int8::QuantParams out = Int8::choose_params(out_min[last], out_max[last]);
+                q.ops.push_back(std::make_unique<Int8::QuantizedConv>(*conv, current, out, relu_next || fused));
+                if (fused && fused->get_pool_size()) {
+                    // The calibrated range is that of the pooled output, which
+                    // is all the pooling keeps
+                    q.ops.push_back(std::make_unique<Int8::QuantizedMaxPool>(fused->get_pool_size(), fused->get_pool_stride()));
+                }
+                current = out;
+                i = last;
+            } else if (dynamic_cast<MaxPooling2DLayer*>(layer)) {
+                std::string config = layer->get_config_string();
+                q.ops.push_back(std::make_unique<Int8::QuantizedMaxPool>(
+                    std::stoi(Layer::config_value(config, "pool_size")), std::stoi(Layer::config_value(config, "stride"))));
+            } else if (dynamic_cast<ReLULayer*>(layer)) {
+                q.ops.push_back(std::make_unique<Int8::QuantizedReLU>());
+            } else if (dynamic_cast<FlattenLayer*>(layer)) {
+                q.ops.push_back(std::make_unique<Int8::QuantizedReshape>(true));
+            } else if (dynamic_cast<DropoutLayer*>(layer)) {
+                q.ops.push_back(std::make_unique<Int8::QuantizedReshape>(false));
+            } else {
+                Int8::QuantParams out = Int8::choose_params(out_min[i], out_max[i]);
+                q.ops.push_back(std::make_unique<Int8::FloatFallback>(*layer, out));
+                current = out;
+            }
+        }
+        for (size_t i = tail; i < L; ++i) {
+            q.float_tail.push_back(model.layers[i]->clone());
+            q.float_tail.back()->eval();
+        }
+        return q;
+    }
+
+    Tensor forward(const Tensor& input) {
+        Int8::quantize(input, input_params, buffers[0]);
+        int cur = 0;
+        for (auto& op : ops) {
+            op->run(buffers[cur], buffers[1 - cur]);
+            cur = 1 - cur;
+        }
+        Tensor output;
+        Int8::dequantize(buffers[cur], output);
+        for (auto& layer : float_tail) output = layer->forward(output);
+        return output;
+    }
+
+    size_t weight_bytes() const {
+        size_t total = 0;
+        for (const auto& op : ops) total += op->weight_bytes();
+        return total;
+    }
+
+    void summary() const {
+        std::cout << "Quantized Model (" << Int8::kernel_name() << " kernels):" << std::endl;
+        for (size_t i = 0; i < ops.size(); ++i) std::cout << "Op " << i << ": " << ops[i]->name() << std::endl;
+        for (const auto& layer : float_tail) std::cout << "Op " << ops.size() << "+: " << layer->get_layer_type() << " (fp32)" << std::endl;
+    }
+
+private:
+    static bool is_int8_capable(const Layer& layer) {
+        return dynamic_cast<const DenseLayer*>(&layer) || dynamic_cast<const Conv2DLayer*>(&layer) ||
+               dynamic_cast<const MaxPooling2DLayer*>(&layer) || dynamic_cast<const ReLULayer*>(&layer) ||
+               dynamic_cast<const FlattenLayer*>(&layer) || dynamic_cast<const DropoutLayer*>(&layer);
+    }
+};
@@ -0,0 +1,222 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <string>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Seedable random numbers for the whole library. Every component draws from
+// its own counter-based Philox4x32-10 stream, keyed by the global seed, the
+// component's name and an index (the n-th object of that component, or a
+// logical thread/actor number). A stream's output depends only on its key
+// and position, never on other streams or on thread scheduling, so a run
+// is reproducible from one seed:
+//
+//   Random::seed(42);        // before building models, trainers, agents
+//
+// Without a call to seed() the seed comes from the EDUNET_SEED environment
+// variable, or else from std::random_device (different on every run).
+namespace Random {
+
+    // Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+    // 1, 2, 3", SC'11): one 128-bit counter -> four 32-bit outputs
+    struct Philox4x32 {
+        using Block = std::array<uint32_t, 4>;
+
+        static Block generate(Block counter, uint32_t k0, uint32_t k1) {
+            for (int round = 0; round < 10; ++round) {
+                const uint64_t p0 = uint64_t(0xD2511F53u) * counter[0];
+                const uint64_t p1 = uint64_t(0xCD9E8D57u) * counter[2];
+                counter = {uint32_t(p1 >> 32) ^ counter[1] ^ k0, uint32_t(p1),
+                           uint32_t(p0 >> 32) ^ counter[3] ^ k1, uint32_t(p0)};
+                k0 += 0x9E3779B9u;
+                k1 += 0xBB67AE85u;
+            }
+            return counter;
+        }
+
+#if defined(__AVX2__)
+        // Eight counters at once: lane l of c[w] is word w of counter l. The
+        // outputs replace the counters in the same layout.
+        static void generate8(__m256i c[4], uint32_t k0, uint32_t k1) {
+            const __m256i m0 = _mm256_set1_epi32(static_cast<int>(0xD2511F53u));
+            const __m256i m1 = _mm256_set1_epi32(static_cast<int>(0xCD9E8D57u));
+            for (int round = 0; round < 10; ++round) {
+                // 32x32->64 products: even lanes directly, odd lanes shifted down
+                __m256i even0 = _mm256_mul_epu32(c[0], m0), odd0 = _mm256_mul_epu32(_mm256_srli_epi64(c[0], 32), m0);
+                __m256i even1 = _mm256_mul_epu32(c[2], m1), odd1 = _mm256_mul_epu32(_mm256_srli_epi64(c[2], 32), m1);
+                __m256i hi0 = _mm256_blend_epi32(_mm256_srli_epi64(even0, 32), odd0, 0xAA);
+                __m256i lo0 = _mm256_blend_epi32(even0, _mm256_slli_epi64(odd0, 32), 0xAA);
+                __m256i hi1 = _mm256_blend_epi32(_mm256_srli_epi64(even1, 32), odd1, 0xAA);
+                __m256i lo1 = _mm256_blend_epi32(even1, _mm256_slli_epi64(odd1, 32), 0xAA);
+                c[0] = _mm256_xor_si256(_mm256_xor_si256(hi1, c[1]), _mm256_set1_epi32(static_cast<int>(k0)));
+                c[2] = _mm256_xor_si256(_mm256_xor_si256(hi0, c[3]), _mm256_set1_epi32(static_cast<int>(k1)));
+                c[1] = lo1;
+                c[3] = lo0;
+                k0 += 0x9E3779B9u;
+                k1 += 0xBB67AE85u;
+            }
+        }
+#endif
+    };
+
+    // SplitMix64 finalizer, used to derive keys
+    inline uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // Philox stream as a UniformRandomBitGenerator (usable with the
+    // <random> distributions and std::shuffle). The counter is the 64-bit
+    // block index plus a 64-bit substream number; substream(n) gives
+    // independent sequences under the same key, e.g. one per training step.
+    class Stream {
+    public:
+        using result_type = uint32_t;
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+        explicit Stream(uint64_t key = 0, uint64_t substream = 0) : key(key), sub(substream) {}
+
+        result_type operator()() {
+            if (used == 4) {
+                buffer = block(next_block++);
+                used = 0;
+            }
+            return buffer[used++];
+        }
+
+        // The four outputs of block `index`, without moving the stream
+        Philox4x32::Block block(uint64_t index) const {
+            return Philox4x32::generate({uint32_t(index), uint32_t(index >> 32), uint32_t(sub), uint32_t(sub >> 32)},
+                                        uint32_t(key), uint32_t(key >> 32));
+        }
+
+        Stream substream(uint64_t n) const { return Stream(key, n); }
+
+        // Continues with block `index` (outputs 4*index ...)
+        void seek(uint64_t index) {
+            next_block = index;
+            used = 4;
+        }
+
+        uint64_t get_key() const { return key; }
+        uint64_t get_substream() const { return sub; }
+
+        void discard(unsigned long long n) {
+            const uint64_t target = position() + n;
+            seek(target / 4);
+            if (target % 4) {
+                buffer = block(next_block++);
+                used = static_cast<int>(target % 4);
+            }
+        }
+
+        bool operator==(const Stream& other) const {
+            return key == other.key && sub == other.sub && position() == other.position();
+        }
+        bool operator!=(const Stream& other) const { return !(*this == other); }
+
+        // Text state for checkpoints: key, substream, outputs consumed
+        friend std::ostream& operator<<(std::ostream& os, const Stream& s) {
+            return os << s.key << ' ' << s.sub << ' ' << s.position();
+        }
+        friend std::istream& operator>>(std::istream& is, Stream& s) {
+            uint64_t key, sub, position;
+            if (is >> key >> sub >> position) {
+                s = Stream(key, sub);
+                s.discard(position);
+            }
+            return is;
+        }
+
+    private:
+        uint64_t key;
+        uint64_t sub;
+        uint64_t next_block = 0;
+        Philox4x32::Block buffer{};
+        int used = 4;
+
+        uint64_t position() const { return next_block * 4 - (4 - used); }
+    };
+
+    struct Context {
+        std::mutex mutex;
+        bool seeded = false;
+        uint64_t seed = 0;
+        std::map<std::string, uint64_t> next_index;   // per component
+    };
+
+    inline Context& context() {
+        static Context c;
+        return c;
+    }
+
+    // Sets the global seed and restarts every component's instance count,
+    // so rebuilding the same objects reproduces the same streams
+    inline void seed(uint64_t value) {
+        Context& c = context();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        c.seed = value;
+        c.seeded = true;
+        c.next_index.clear();
+    }
+
+    inline uint64_t seed_locked(Context& c) {
+        if (!c.seeded) {
+            const char* env = std::getenv("EDUNET_SEED");
+            if (env && *env) {
+                c.seed = std::strtoull(env, nullptr, 10);
+            } else {
+                std::random_device rd;
+                c.seed = (uint64_t(rd()) << 32) | rd();
+            }
+            c.seeded = true;
+        }
+        return c.seed;
+    }
+
+    inline uint64_t get_seed() {
+        Context& c = context();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        return seed_locked(c);
+    }
+
+    inline uint64_t name_hash(const std::string& name) {
+        uint64_t h = 0xCBF29CE484222325ull;   // FNV-1a
+        for (unsigned char ch : name) {
+            h ^= ch;
+            h *= 0x100000001B3ull;
+        }
+        return h;
+    }
+
+    // Stream `index` of `component` under the global seed
+    inline Stream stream(const std::string& component, uint64_t index) {
+        return Stream(mix(get_seed() ^ mix(name_hash(component) + index)));
+    }
+
+    // The next unused stream of `component`. Deterministic as long as the
+    // component's objects are created in a fixed order; objects created by
+    // concurrent threads should pass an explicit index instead.
+    inline Stream stream(const std::string& component) {
+        Context& c = context();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        const uint64_t global = seed_locked(c);
+        const uint64_t index = c.next_index[component]++;
+        return Stream(mix(global ^ mix(name_hash(component) + index)));
+    }
+
+    // Stream from an explicit per-object seed, independent of the global one
+    inline Stream seeded(uint64_t value) { return Stream(mix(value)); }
+
+} // namespace Random
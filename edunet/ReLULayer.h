@@ -1,35 +1,46 @@
 #pragma once
 #include "Layer.h"
+#include "BitMask.h"
 #include <fstream>
 
 class ReLULayer : public Layer {
 private:
-    Tensor last_input;
+    // Where the input was positive (BitMask.h), instead of a copy of the input
+    std::vector<uint32_t> mask;
+    size_t mask_size = 0;
 public:
     Tensor forward(const Tensor& input) override {
-        last_input = input;
-        Tensor output = input;
-        for (auto& val : output.data) {
-            if (val < 0) {
-                val = 0;
-            }
-        }
+        Tensor output(input.shape);
+        mask.resize(BitMask::words(input.data.size()));
+        mask_size = input.data.size();
+        BitMask::relu_pack(input.data.data(), output.data.data(), mask_size, mask.data());
         return output;
     }
     
+    void forward_into(const Tensor& input, Tensor& output) override {
+        output.resize(input.shape);
+        BitMask::relu(input.data.data(), output.data.data(), input.data.size());
+    }
+
     Tensor backward(const Tensor& output_gradient) override {
-        Tensor input_gradient = output_gradient;
-        for (size_t i = 0; i < last_input.data.size(); ++i) {
-            if (last_input.data[i] <= 0) {
-                input_gradient.data[i] = 0;
-            }
+        if (output_gradient.data.size() != mask_size) {
+            throw std::runtime_error("ReLULayer::backward: gradient size does not match the last forward pass");
         }
+        Tensor input_gradient(output_gradient.shape);
+        BitMask::apply(mask.data(), output_gradient.data.data(), input_gradient.data.data(), mask_size);
         return input_gradient;
     }
     
     std::unique_ptr<Layer> clone() const override {
         return std::make_unique<ReLULayer>(*this);
     }
+
+    size_t activation_bytes() const override { return mask.size() * sizeof(uint32_t); }
+
+    void release_activations() override {
+        std::vector<uint32_t>().swap(mask);
+        mask_size = 0;
+    }
     
     void save_weights(const std::string& filename) const override {
         std::ofstream file(filename + "_relu.meta", std::ios::binary);
@@ -0,0 +1,162 @@
+#pragma once
+#include "Tensor.h"
+#include <vector>
+#include <mutex>
+#include <random>
+#include <cstddef>
+#include <algorithm>
+
+// A transition in the environment. For n-step transitions `reward` is the
+// discounted sum of the n rewards, `next_state` is the state n steps later and
+// `discount` is gamma^n, the factor applied to the bootstrapped value.
+struct Transition {
+    std::vector<float> state;
+    int action;
+    float reward;
+    std::vector<float> next_state;
+    bool done;
+    float discount;
+};
+
+// Flat minibatch filled by ReplayBuffer::sample, reused between calls
+struct TransitionBatch {
+    Tensor states;
+    Tensor next_states;
+    std::vector<int> actions;
+    std::vector<float> rewards;
+    std::vector<float> discounts;
+    std::vector<unsigned char> dones;
+};
+
+// Fixed-capacity ring buffer of transitions. All methods are thread-safe, so
+// several actor threads can push while a learner thread samples.
+class ReplayBuffer {
+private:
+    mutable std::mutex mutex;
+    std::vector<Transition> items;
+    size_t capacity;
+    size_t next = 0;
+
+public:
+    explicit ReplayBuffer(size_t capacity) : capacity(capacity) {
+        items.reserve(capacity);
+    }
+
+    void push(Transition transition) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.size() < capacity) {
+            items.push_back(std::move(transition));
+        } else {
+            items[next] = std::move(transition);
+        }
+        next = (next + 1) % capacity;
+    }
+
+    // Copies the transition into the next ring slot. Slots keep their
+    // vectors, so once the ring is full this does not allocate.
+    void push(const float* state, size_t state_size, int action, float reward,
+              const float* next_state, bool done, float discount) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.size() < capacity) {
+            items.emplace_back();
+        }
+        Transition& slot = items[next];
+        slot.state.assign(state, state + state_size);
+        slot.action = action;
+        slot.reward = reward;
+        slot.next_state.assign(next_state, next_state + state_size);
+        slot.done = done;
+        slot.discount = discount;
+        next = (next + 1) % capacity;
+    }
+
+    // Uniformly samples batch_size transitions (with replacement) into the
+    // flat tensors and arrays of `batch`.
+    template<typename URNG>
+    void sample(size_t batch_size, URNG& gen, TransitionBatch& batch) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) return;
+        int state_size = static_cast<int>(items[0].state.size());
+        batch.states.resize({static_cast<int>(batch_size), state_size});
+        batch.next_states.resize({static_cast<int>(batch_size), state_size});
+        batch.actions.resize(batch_size);
+        batch.rewards.resize(batch_size);
+        batch.discounts.resize(batch_size);
+        batch.dones.resize(batch_size);
+
+        std::uniform_int_distribution<size_t> dist(0, items.size() - 1);
+        for (size_t i = 0; i < batch_size; ++i) {
+            const Transition& t = items[dist(gen)];
+            std::copy(t.state.begin(), t.state.end(), batch.states.data.begin() + i * state_size);
+            std::copy(t.next_state.begin(), t.next_state.end(), batch.next_states.data.begin() + i * state_size);
+            batch.actions[i] = t.action;
+            batch.rewards[i] = t.reward;
+            batch.discounts[i] = t.discount;
+            batch.dones[i] = t.done;
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+};
+
+// Converts one producer's stream of 1-step transitions into n-step
+// transitions and pushes them into a ReplayBuffer. Each producer (agent or
+// actor thread) needs its own accumulator; it is not thread-safe.
+class NStepAccumulator {
+private:
+    int n;
+    float gamma;
+    size_t state_size;
+    // Ring of the last (up to n) steps that still wait for their return
+    std::vector<float> states;
+    std::vector<int> actions;
+    std::vector<float> rewards;
+    std::vector<float> last_next_state;
+    int head = 0;
+    int count = 0;
+
+    // Emits the oldest pending step with the rewards collected so far
+    void emit_oldest(ReplayBuffer& buffer, bool done) {
+        float ret = 0.0f;
+        float discount = 1.0f;
+        for (int k = 0; k < count; ++k) {
+            ret += discount * rewards[(head + k) % n];
+            discount *= gamma;
+        }
+        buffer.push(states.data() + head * state_size, state_size, actions[head], ret,
+                    last_next_state.data(), done, discount);
+        head = (head + 1) % n;
+        --count;
+    }
+
+public:
+    NStepAccumulator(int n_step, float gamma, size_t state_size)
+        : n(std::max(1, n_step)), gamma(gamma), state_size(state_size),
+          states(n * state_size), actions(n), rewards(n), last_next_state(state_size) {}
+
+    void add(const float* state, int action, float reward, const float* next_state, bool done, ReplayBuffer& buffer) {
+        int slot = (head + count) % n;
+        std::copy(state, state + state_size, states.begin() + slot * state_size);
+        actions[slot] = action;
+        rewards[slot] = reward;
+        std::copy(next_state, next_state + state_size, last_next_state.begin());
+        ++count;
+
+        if (done) {
+            while (count > 0) emit_oldest(buffer, true);
+            head = 0;
+        } else if (count == n) {
+            emit_oldest(buffer, false);
+        }
+    }
+
+    // Flushes pending steps of an episode cut short without a terminal
+    // state; they bootstrap from the last observed next_state.
+    void flush(ReplayBuffer& buffer) {
+        while (count > 0) emit_oldest(buffer, false);
+        head = 0;
+    }
+};
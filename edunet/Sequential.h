@@ -8,19 +8,44 @@
 #include "DropoutLayer.h"
 #include "Conv2DLayer.h"
 #include "MaxPooling2DLayer.h"
+#include "AveragePooling2DLayer.h"
+#include "GlobalAveragePoolingLayer.h"
+#include "BatchNormLayer.h"
+#include "GroupedConv2DLayer.h"
+#include "FusedLayers.h"
+#include "ModelFormat.h"
+#include "Profiler.h"
 #include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <memory>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
 
 class Sequential {
 public:
     std::vector<std::unique_ptr<Layer>> layers;
+
+    // Gradient checkpointing (activation recomputation), see
+    // set_gradient_checkpointing
+    enum class CheckpointMode { Off, SqrtN, MemoryBudget };
+
+    // The memory/compute tradeoff of the last checkpointed forward pass
+    struct CheckpointingStats {
+        std::vector<size_t> boundaries;    // first layer of every segment
+        size_t activation_bytes = 0;       // saved for backward by all layers, what a plain pass keeps
+        size_t kept_bytes = 0;             // kept after forward: boundary inputs + the last segment
+        size_t peak_bytes = 0;             // during backward: boundary inputs + one recomputed segment
+        double forward_flops = 0.0;
+        double recomputed_flops = 0.0;     // forward work repeated by backward
+    };
     
     Sequential() = default;
     
-    Sequential(const Sequential& other) {
+    Sequential(const Sequential& other)
+        : checkpoint_mode(other.checkpoint_mode), checkpoint_budget(other.checkpoint_budget) {
         for (const auto& layer : other.layers) {
             layers.push_back(layer->clone());
         }
@@ -29,9 +54,12 @@ public:
     Sequential& operator=(const Sequential& other) {
         if (this == &other) return *this;
         layers.clear();
+        segments.clear();
         for (const auto& layer : other.layers) {
             layers.push_back(layer->clone());
         }
+        checkpoint_mode = other.checkpoint_mode;
+        checkpoint_budget = other.checkpoint_budget;
         return *this;
     }
     
@@ -43,21 +71,191 @@ public:
     }
     
     Tensor forward(const Tensor& input) {
+        if (checkpoint_mode != CheckpointMode::Off && training && !layers.empty()) {
+            return forward_checkpointed(input);
+        }
+        segments.clear();
         Tensor current_output = input;
-        for (const auto& layer : layers) {
-            current_output = layer->forward(current_output);
+        const bool profile = Profiler::enabled();
+        for (size_t i = 0; i < layers.size(); ++i) {
+            current_output = forward_layer(i, current_output, profile, false);
         }
         return current_output;
     }
     
+    // Inference forward pass through per-layer buffers in `workspace`. Once the
+    // workspace has been sized by a first call, layers that implement
+    // forward_into run without heap allocations.
+    const Tensor& forward_into(const Tensor& input, std::vector<Tensor>& workspace) {
+        if (layers.empty()) return input;
+        if (workspace.size() != layers.size()) {
+            workspace.resize(layers.size());
+        }
+        const Tensor* current = &input;
+        const bool profile = Profiler::enabled();
+        for (size_t i = 0; i < layers.size(); ++i) {
+            if (profile) {
+                Profiler::Scope scope(layer_name(i), Profiler::Phase::Forward, layers[i].get());
+                layers[i]->forward_into(*current, workspace[i]);
+                scope.set_work(layer_flops(i, current->shape, workspace[i].shape, false),
+                               layer_bytes(i, current->shape, workspace[i].shape, false));
+            } else {
+                layers[i]->forward_into(*current, workspace[i]);
+            }
+            current = &workspace[i];
+        }
+        return *current;
+    }
+    
     void backward(const Tensor& initial_gradient) {
         Tensor current_gradient = initial_gradient;
-        for (int i = layers.size() - 1; i >= 0; --i) {
-            current_gradient = layers[i]->backward(current_gradient);
+        const bool profile = Profiler::enabled();
+        if (segments.empty()) {
+            for (size_t i = layers.size(); i-- > 0;) {
+                current_gradient = backward_layer(i, current_gradient, profile);
+            }
+            return;
+        }
+        // Segment by segment from the end: recompute a released segment
+        // from its boundary input, run its backward, then drop both
+        if (segments_consumed) {
+            throw std::runtime_error("Sequential::backward: with gradient checkpointing, every backward needs its own forward pass");
+        }
+        segments_consumed = true;
+        for (size_t s = segments.size(); s-- > 0;) {
+            Segment& segment = segments[s];
+            if (segment.released) recompute(segment, profile);
+            for (size_t i = segment.end; i-- > segment.begin;) {
+                current_gradient = backward_layer(i, current_gradient, profile);
+            }
+            if (segment.released) {
+                for (size_t i = segment.begin; i < segment.end; ++i) layers[i]->release_activations();
+            }
+            segment.input = Tensor();
+        }
+    }
+
+    // Gradient accumulation across several backward calls (see
+    // Layer::set_accumulate_gradients)
+    void set_accumulate_gradients(bool on) {
+        for (auto& layer : layers) layer->set_accumulate_gradients(on);
+    }
+
+    void zero_gradients() {
+        for (auto& layer : layers) layer->zero_gradients();
+    }
+
+    // What the layers currently hold for backward
+    size_t activation_bytes() const {
+        size_t bytes = 0;
+        for (const auto& layer : layers) bytes += layer->activation_bytes();
+        return bytes;
+    }
+
+    // Gradient checkpointing for training. A forward pass in train mode
+    // keeps the input of selected layers (segment boundaries); the layers
+    // inside every segment but the last drop what they saved for backward
+    // (Layer::release_activations) as soon as the segment is complete, and
+    // backward re-runs each segment's forward from its boundary before
+    // going through it. Layer RNG states (Dropout) are rewound for the
+    // re-run, so gradients are exactly those of a plain pass.
+    //   SqrtN:        segments of ceil(sqrt(layers)) layers
+    //   MemoryBudget: a new segment starts when the boundary inputs plus
+    //                 the open segment's saved activations would exceed
+    //                 `budget_bytes`; the segments adapt to the batch size
+    // Costs one extra forward pass of all segments but the last; see
+    // checkpointing_stats() and print_checkpointing_report().
+    void set_gradient_checkpointing(CheckpointMode mode, size_t budget_bytes = 0) {
+        if (mode == CheckpointMode::MemoryBudget && budget_bytes == 0) {
+            throw std::runtime_error("Gradient checkpointing with a memory budget needs budget_bytes > 0");
         }
+        checkpoint_mode = mode;
+        checkpoint_budget = budget_bytes;
+        segments.clear();
+        checkpoint_stats = CheckpointingStats();
+    }
+
+    CheckpointMode get_gradient_checkpointing() const { return checkpoint_mode; }
+
+    const CheckpointingStats& checkpointing_stats() const { return checkpoint_stats; }
+
+    void print_checkpointing_report(std::ostream& os = std::cout) const {
+        const CheckpointingStats& s = checkpoint_stats;
+        if (s.boundaries.empty()) {
+            os << "Gradient checkpointing: no checkpointed forward pass yet" << std::endl;
+            return;
+        }
+        auto mb = [](size_t bytes) { return bytes / 1048576.0; };
+        std::ios_base::fmtflags flags = os.flags();
+        os << std::fixed << std::setprecision(2) << "Gradient checkpointing: " << s.boundaries.size() << " segments, starting at layers";
+        for (size_t b : s.boundaries) os << " " << b;
+        os << std::endl
+           << "  activations kept after forward " << mb(s.kept_bytes) << " MB, peak in backward " << mb(s.peak_bytes)
+           << " MB, without checkpointing " << mb(s.activation_bytes) << " MB" << std::endl
+           << std::setprecision(1) << "  recomputation adds " << (s.forward_flops > 0 ? 100.0 * s.recomputed_flops / s.forward_flops : 0.0)
+           << "% forward FLOPs" << std::endl;
+        os.flags(flags);
     }
     
+    // Creates a default-constructed layer from its get_layer_type() name
+    static std::unique_ptr<Layer> create_layer(const std::string& layer_type) {
+        if (layer_type == "DenseLayer") {
+            return std::make_unique<DenseLayer>();
+        } else if (layer_type == "ReLULayer") {
+            return std::make_unique<ReLULayer>();
+        } else if (layer_type == "SoftmaxLayer") {
+            return std::make_unique<SoftmaxLayer>();
+        } else if (layer_type == "SigmoidLayer") {
+            return std::make_unique<SigmoidLayer>();
+        } else if (layer_type == "FlattenLayer") {
+            return std::make_unique<FlattenLayer>();
+        } else if (layer_type == "DropoutLayer") {
+            return std::make_unique<DropoutLayer>();
+        } else if (layer_type == "Conv2DLayer") {
+            return std::make_unique<Conv2DLayer>();
+        } else if (layer_type == "MaxPooling2DLayer") {
+            return std::make_unique<MaxPooling2DLayer>();
+        } else if (layer_type == "AveragePooling2DLayer") {
+            return std::make_unique<AveragePooling2DLayer>();
+        } else if (layer_type == "GlobalAveragePoolingLayer") {
+            return std::make_unique<GlobalAveragePoolingLayer>();
+        } else if (layer_type == "GroupedConv2DLayer") {
+            return std::make_unique<GroupedConv2DLayer>();
+        } else if (layer_type == "BatchNormLayer") {
+            return std::make_unique<BatchNormLayer>();
+        } else if (layer_type == "FusedDenseLayer") {
+            return std::make_unique<FusedDenseLayer>();
+        } else if (layer_type == "FusedConv2DLayer") {
+            return std::make_unique<FusedConv2DLayer>();
+        }
+        throw std::runtime_error("Unknown layer type: " + layer_type);
+    }
+
+    // Saves in the binary format described in ModelFormat.h
     void save_model(const std::string& filename) const {
+        ModelFormat::save(layers, filename);
+        std::cout << "Model saved to: " << filename << std::endl;
+    }
+
+    // Loads either the binary format or the older text-based format
+    void load_model(const std::string& filename) {
+        if (ModelFormat::has_magic(filename)) {
+            layers = ModelFormat::load(filename, create_layer);
+            std::cout << "Model loaded from: " << filename << std::endl;
+            return;
+        }
+        load_model_legacy(filename);
+    }
+
+    // Binary format only: weights stay in a private mapping of the file
+    // (see ModelFormat::load_mapped) and are paged in on first use
+    void load_model_mapped(const std::string& filename, bool verify_checksum = false) {
+        layers = ModelFormat::load_mapped(filename, create_layer, verify_checksum);
+        std::cout << "Model mapped from: " << filename << std::endl;
+    }
+
+    // Text-based format: every layer serialized through get_weights_string()
+    void save_model_legacy(const std::string& filename) const {
         std::ofstream file(filename, std::ios::binary);
         if (!file) {
             throw std::runtime_error("Cannot open file for writing: " + filename);
@@ -82,7 +280,7 @@ public:
         std::cout << "Model saved to: " << filename << std::endl;
     }
     
-    void load_model(const std::string& filename) {
+    void load_model_legacy(const std::string& filename) {
         std::ifstream file(filename, std::ios::binary);
         if (!file) {
             throw std::runtime_error("Cannot open file for reading: " + filename);
@@ -104,55 +302,310 @@ public:
             std::string weights_data(data_length, ' ');
             file.read(&weights_data[0], data_length);
             
-            std::unique_ptr<Layer> layer;
-            if (layer_type == "DenseLayer") {
-                layer = std::make_unique<DenseLayer>();
-            } else if (layer_type == "ReLULayer") {
-                layer = std::make_unique<ReLULayer>();
-            } else if (layer_type == "SoftmaxLayer") {
-                layer = std::make_unique<SoftmaxLayer>();
-            } else if (layer_type == "SigmoidLayer") {
-                layer = std::make_unique<SigmoidLayer>();
-            } else if (layer_type == "FlattenLayer") {
-                layer = std::make_unique<FlattenLayer>();
-            } else if (layer_type == "DropoutLayer") {
-                layer = std::make_unique<DropoutLayer>();
-            } else if (layer_type == "Conv2DLayer") {
-                layer = std::make_unique<Conv2DLayer>();
-            } else if (layer_type == "MaxPooling2DLayer") {
-                layer = std::make_unique<MaxPooling2DLayer>();
-            } else {
-                throw std::runtime_error("Unknown layer type: " + layer_type);
-            }
-            
-            if (layer) {
-                layer->set_weights_from_string(weights_data);
-                layers.push_back(std::move(layer));
-            }
+            std::unique_ptr<Layer> layer = create_layer(layer_type);
+            layer->set_weights_from_string(weights_data);
+            layers.push_back(std::move(layer));
         }
         
         file.close();
         std::cout << "Model loaded from: " << filename << std::endl;
     }
     
+    // Lists the layers; once the profiler has recorded this model (see
+    // Profiler.h), also their time, throughput and allocations per call
     void summary() const {
         std::cout << "Model Summary:" << std::endl;
         std::cout << "==============" << std::endl;
+        std::vector<Profiler::PhaseTotals> profile(layers.size());
+        bool profiled = false;
         for (size_t i = 0; i < layers.size(); ++i) {
-            std::cout << "Layer " << i << ": " << layers[i]->get_layer_type() << std::endl;
+            profiled |= Profiler::totals_for(layers[i].get(), profile[i]);
+        }
+        if (!profiled) {
+            for (size_t i = 0; i < layers.size(); ++i) {
+                std::cout << "Layer " << i << ": " << layers[i]->get_layer_type() << std::endl;
+            }
+            return;
         }
+
+        std::ios_base::fmtflags flags = std::cout.flags();
+        std::cout << std::left << std::setw(24) << "Layer" << std::right << std::setw(8) << "Calls"
+                  << std::setw(11) << "Fwd us" << std::setw(11) << "Bwd us" << std::setw(10) << "GFLOP/s"
+                  << std::setw(9) << "GB/s" << std::setw(8) << "Allocs" << std::setw(8) << "Time %" << std::endl;
+        double total_us = 0.0;
+        for (const auto& p : profile) {
+            total_us += p[size_t(Profiler::Phase::Forward)].time_us + p[size_t(Profiler::Phase::Backward)].time_us;
+        }
+        std::cout << std::fixed << std::setprecision(1);
+        for (size_t i = 0; i < layers.size(); ++i) {
+            // Per call of the layer: forward and backward time, and the
+            // throughput and allocations of both together
+            const Profiler::Totals& fwd = profile[i][size_t(Profiler::Phase::Forward)];
+            const Profiler::Totals& bwd = profile[i][size_t(Profiler::Phase::Backward)];
+            Profiler::Totals both;
+            both.calls = std::max(fwd.calls, bwd.calls);
+            both.time_us = fwd.time_us + bwd.time_us;
+            both.flops = fwd.flops + bwd.flops;
+            both.bytes = fwd.bytes + bwd.bytes;
+            both.allocations = fwd.allocations + bwd.allocations;
+            std::cout << std::left << std::setw(24) << layer_name(i) << std::right << std::setw(8) << both.calls
+                      << std::setw(11) << (fwd.calls ? fwd.time_us / fwd.calls : 0.0)
+                      << std::setw(11) << (bwd.calls ? bwd.time_us / bwd.calls : 0.0)
+                      << std::setw(10) << Profiler::gflops(both) << std::setw(9) << Profiler::gbytes_per_s(both)
+                      << std::setw(8) << (both.calls ? both.allocations / both.calls : 0)
+                      << std::setw(7) << (total_us > 0 ? 100.0 * both.time_us / total_us : 0.0) << "%" << std::endl;
+        }
+        std::cout.flags(flags);
     }
 
     // УЛУЧШЕНО: Методы для переключения режима всей модели
     void train() {
+        training = true;
         for (auto& layer : layers) {
             layer->train();
         }
     }
 
     void eval() {
+        training = false;
         for (auto& layer : layers) {
             layer->eval();
         }
     }
+
+    // Graph rewrite: Conv2D+ReLU(+MaxPool) and Dense+ReLU runs become single
+    // fused layers (FusedLayers.h) that keep the same parameters. Returns the
+    // number of fused layers. Fuse before training starts: Adam keys its
+    // moments by layer index.
+    int fuse() {
+        std::vector<std::unique_ptr<Layer>> fused;
+        int count = 0;
+        for (size_t i = 0; i < layers.size(); ++i) {
+            const std::string type = layers[i]->get_layer_type();
+            bool relu_next = i + 1 < layers.size() && layers[i + 1]->get_layer_type() == "ReLULayer";
+            if (type == "Conv2DLayer" && relu_next) {
+                int pool_size = 0, pool_stride = 0;
+                if (i + 2 < layers.size() && layers[i + 2]->get_layer_type() == "MaxPooling2DLayer") {
+                    std::string config = layers[i + 2]->get_config_string();
+                    pool_size = std::stoi(Layer::config_value(config, "pool_size"));
+                    pool_stride = std::stoi(Layer::config_value(config, "stride"));
+                }
+                fused.push_back(std::make_unique<FusedConv2DLayer>(static_cast<const Conv2DLayer&>(*layers[i]), pool_size, pool_stride));
+                i += pool_size ? 2 : 1;
+                count++;
+            } else if (type == "DenseLayer" && relu_next) {
+                fused.push_back(std::make_unique<FusedDenseLayer>(static_cast<const DenseLayer&>(*layers[i])));
+                i += 1;
+                count++;
+            } else {
+                fused.push_back(std::move(layers[i]));
+            }
+        }
+        layers = std::move(fused);
+        segments.clear();
+        return count;
+    }
+
+    // Inference rewrite: every BatchNormLayer right after a Dense, Conv2D or
+    // GroupedConv2D layer becomes part of that layer's weights and bias (its
+    // eval-mode scale and shift) and is removed. Returns the number of
+    // folded layers.
+    // Fold after training, before fuse(), export or quantization.
+    int fold_batch_norm() {
+        std::vector<std::unique_ptr<Layer>> folded;
+        int count = 0;
+        for (size_t i = 0; i < layers.size(); ++i) {
+            auto* bn = dynamic_cast<BatchNormLayer*>(layers[i].get());
+            if (bn && !folded.empty()) {
+                const std::string type = folded.back()->get_layer_type();
+                if (type == "DenseLayer" || type == "Conv2DLayer" || type == "GroupedConv2DLayer") {
+                    std::vector<float> scale, shift;
+                    bn->folded_scale_shift(scale, shift);
+                    std::vector<Tensor*> params = folded.back()->parameters();
+                    Tensor& weights = *params[0];
+                    Tensor& bias = *params[1];
+                    if (bias.data.size() != scale.size()) {
+                        throw std::runtime_error("fold_batch_norm: layer " + std::to_string(i) + " normalizes " +
+                                                 std::to_string(scale.size()) + " channels, the layer before it has " +
+                                                 std::to_string(bias.data.size()));
+                    }
+                    const size_t outputs = scale.size();
+                    if (type == "DenseLayer") {
+                        // weights are input_size x output_size
+                        for (size_t k = 0; k < weights.data.size(); ++k) weights.data[k] *= scale[k % outputs];
+                    } else {
+                        // kernels are out_channels x (in_channels [/ groups] * k * k)
+                        const size_t per_channel = weights.data.size() / outputs;
+                        for (size_t k = 0; k < weights.data.size(); ++k) weights.data[k] *= scale[k / per_channel];
+                    }
+                    for (size_t c = 0; c < outputs; ++c) bias.data[c] = bias.data[c] * scale[c] + shift[c];
+                    folded.back()->parameters_changed();
+                    count++;
+                    continue;
+                }
+            }
+            folded.push_back(std::move(layers[i]));
+        }
+        layers = std::move(folded);
+        segments.clear();
+        return count;
+    }
+
+private:
+    // Layers [begin, end) of a checkpointed forward pass
+    struct Segment {
+        size_t begin = 0, end = 0;
+        Tensor input;                         // input of layer `begin`
+        std::vector<std::string> rng_states;  // of each layer before its forward
+        size_t activation_bytes = 0;
+        bool released = false;
+    };
+
+    CheckpointMode checkpoint_mode = CheckpointMode::Off;
+    size_t checkpoint_budget = 0;
+    bool training = true;
+    std::vector<Segment> segments;            // of the last forward, empty when not checkpointed
+    bool segments_consumed = false;           // backward has run since
+    CheckpointingStats checkpoint_stats;
+
+    Tensor forward_layer(size_t i, const Tensor& input, bool profile, bool recomputing) {
+        if (!profile) return layers[i]->forward(input);
+        Profiler::Scope scope(layer_name(i) + (recomputing ? " (recompute)" : ""), Profiler::Phase::Forward, layers[i].get());
+        Tensor output = layers[i]->forward(input);
+        scope.set_work(layer_flops(i, input.shape, output.shape, false), layer_bytes(i, input.shape, output.shape, false));
+        return output;
+    }
+
+    Tensor backward_layer(size_t i, const Tensor& gradient, bool profile) {
+        if (!profile) return layers[i]->backward(gradient);
+        Profiler::Scope scope(layer_name(i), Profiler::Phase::Backward, layers[i].get());
+        Tensor input_gradient = layers[i]->backward(gradient);
+        scope.set_work(layer_flops(i, input_gradient.shape, gradient.shape, true),
+                       layer_bytes(i, input_gradient.shape, gradient.shape, true));
+        return input_gradient;
+    }
+
+    Tensor forward_checkpointed(const Tensor& input) {
+        const bool profile = Profiler::enabled();
+        const size_t sqrt_n = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(layers.size()))));
+        CheckpointingStats stats;
+        segments.clear();
+        segments_consumed = false;
+        segments.emplace_back();
+        segments.back().input = input;
+        size_t boundary_bytes = input.data.size() * sizeof(float);
+        std::vector<double> flops(layers.size());
+
+        Tensor current;   // output of the previous layer
+        for (size_t i = 0; i < layers.size(); ++i) {
+            std::string rng_state = layers[i]->get_rng_state();
+            Tensor output = forward_layer(i, i ? current : segments[0].input, profile, false);
+            const size_t bytes = layers[i]->activation_bytes();
+            flops[i] = layers[i]->forward_flops(i ? current.shape : input.shape, output.shape);
+            stats.activation_bytes += bytes;
+
+            Segment& open = segments.back();
+            bool boundary = false;
+            if (i > open.begin) {
+                if (checkpoint_mode == CheckpointMode::SqrtN) {
+                    boundary = i % sqrt_n == 0;
+                } else {
+                    // Only where closing frees more than the new boundary input costs
+                    const size_t input_bytes = current.data.size() * sizeof(float);
+                    boundary = boundary_bytes + open.activation_bytes + bytes > checkpoint_budget &&
+                               open.activation_bytes > input_bytes;
+                }
+            }
+            if (boundary) {
+                // Close the open segment before layer i; its input is kept
+                for (size_t j = open.begin; j < i; ++j) layers[j]->release_activations();
+                open.end = i;
+                open.released = true;
+                boundary_bytes += current.data.size() * sizeof(float);
+                segments.emplace_back();
+                segments.back().begin = i;
+                segments.back().input = std::move(current);
+            }
+            segments.back().rng_states.push_back(std::move(rng_state));
+            segments.back().activation_bytes += bytes;
+            current = std::move(output);
+        }
+        // The last segment is not recomputed and needs no input
+        segments.back().end = layers.size();
+        boundary_bytes -= segments.back().input.data.size() * sizeof(float);
+        segments.back().input = Tensor();
+
+        // While backward is in segment s, the inputs of segments 0..s and
+        // the activations of s are alive
+        size_t inputs = 0;
+        for (const Segment& s : segments) {
+            stats.boundaries.push_back(s.begin);
+            inputs += s.input.data.size() * sizeof(float);
+            stats.peak_bytes = std::max(stats.peak_bytes, inputs + s.activation_bytes);
+            for (size_t i = s.begin; i < s.end; ++i) {
+                stats.forward_flops += flops[i];
+                if (s.released) stats.recomputed_flops += flops[i];
+            }
+        }
+        stats.kept_bytes = boundary_bytes + segments.back().activation_bytes;
+        checkpoint_stats = std::move(stats);
+        return current;
+    }
+
+    // Re-runs a segment's forward pass so its layers hold their saved
+    // activations again, with each layer's RNG rewound to its state at the
+    // original pass and then put back
+    void recompute(const Segment& segment, bool profile) {
+        std::vector<std::string> current_states;
+        for (size_t i = segment.begin; i < segment.end; ++i) {
+            current_states.push_back(layers[i]->get_rng_state());
+            const std::string& state = segment.rng_states[i - segment.begin];
+            if (!state.empty()) layers[i]->set_rng_state(state);
+        }
+        Tensor x = segment.input;
+        for (size_t i = segment.begin; i < segment.end; ++i) {
+            layers[i]->set_recomputing(true);
+            x = forward_layer(i, x, profile, true);
+            layers[i]->set_recomputing(false);
+        }
+        for (size_t i = segment.begin; i < segment.end; ++i) {
+            const std::string& state = current_states[i - segment.begin];
+            if (!state.empty()) layers[i]->set_rng_state(state);
+        }
+    }
+
+    std::string layer_name(size_t i) const {
+        return std::to_string(i) + " " + layers[i]->get_layer_type();
+    }
+
+    // Work estimates for the profiler. Backward of a layer with parameters
+    // computes both the input and the parameter gradients, about twice the
+    // forward FLOPs; it reads the saved input and the weights and writes
+    // the weight gradients.
+    double layer_flops(size_t i, const std::vector<int>& in, const std::vector<int>& out, bool backward) const {
+        double flops = layers[i]->forward_flops(in, out);
+        if (backward && !layers[i]->parameters().empty()) flops *= 2.0;
+        return flops;
+    }
+
+    double layer_bytes(size_t i, const std::vector<int>& in, const std::vector<int>& out, bool backward) const {
+        auto count = [](const std::vector<int>& shape) {
+            double n = 1.0;
+            for (int d : shape) n *= d;
+            return n;
+        };
+        double params = 0.0;
+        for (const Tensor* p : layers[i]->parameters()) params += p->data.size();
+        double floats = count(in) + count(out) + params;
+        if (backward) floats += count(in) + params;
+        return floats * sizeof(float);
+    }
+
+public:
+    // Runs Dense and Conv2D layers on 16-bit weights (see Layer::set_precision)
+    void set_precision(Half::DType dtype) {
+        for (auto& layer : layers) {
+            layer->set_precision(dtype);
+        }
+    }
 };
\ No newline at end of file
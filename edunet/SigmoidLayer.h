@@ -28,6 +28,10 @@ public:
     std::unique_ptr<Layer> clone() const override {
         return std::make_unique<SigmoidLayer>(*this);
     }
+
+    size_t activation_bytes() const override { return last_output.data.size() * sizeof(float); }
+
+    void release_activations() override { last_output = Tensor(); }
     
     void save_weights(const std::string& filename) const override {
         std::ofstream file(filename + "_sigmoid.meta", std::ios::binary);
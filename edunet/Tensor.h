@@ -8,11 +8,13 @@
 #include <string>
 #include <sstream>
 #include <memory>
+#include <initializer_list>
+#include "TensorStorage.h"
 
 class Tensor {
 public:
     std::vector<int> shape;
-    std::vector<float> data;
+    TensorStorage data;
     std::vector<int> strides;
 
     Tensor() = default;
@@ -25,6 +27,29 @@ public:
         calculate_strides();
     }
 
+    // Tensor whose elements live in external memory kept alive by `owner`
+    static Tensor view(const std::vector<int>& s, float* values, std::shared_ptr<const void> owner) {
+        Tensor t;
+        t.shape = s;
+        size_t total_size = 1;
+        for (int dim : s) total_size *= dim;
+        t.data = TensorStorage::view(values, total_size, std::move(owner));
+        t.calculate_strides();
+        return t;
+    }
+
+    // Changes the shape in place. Storage is reused when it is already large
+    // enough, so hot loops can resize persistent buffers without allocating.
+    void resize(std::initializer_list<int> s) {
+        shape.assign(s.begin(), s.end());
+        resize_storage();
+    }
+
+    void resize(const std::vector<int>& s) {
+        shape.assign(s.begin(), s.end());
+        resize_storage();
+    }
+
     void save_to_file(const std::string& filename) const {
         std::ofstream file(filename, std::ios::binary);
         if (!file) throw std::runtime_error("Cannot open file for writing: " + filename);
@@ -79,6 +104,15 @@ public:
     }
 
 private:
+    void resize_storage() {
+        int total_size = 1;
+        for (int dim : shape) {
+            total_size *= dim;
+        }
+        data.resize(total_size);
+        calculate_strides();
+    }
+
     void calculate_strides() {
         if (shape.empty()) { strides.clear(); return; }
         strides.resize(shape.size());
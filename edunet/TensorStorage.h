@@ -0,0 +1,163 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+
+// Element storage of a Tensor. Behaves like std::vector<float> for the
+// operations the library uses, but can also be a view of external memory
+// such as a memory-mapped model file (see ModelFormat::load_mapped). A view
+// keeps its backing memory alive through `owner`; copying a view, or growing
+// it, produces ordinary owned storage, so tensors keep value semantics.
+//
+// Owned memory comes from calloc: large zero-filled tensors are backed by
+// fresh pages and cost nothing until they are touched.
+class TensorStorage {
+public:
+    using value_type = float;
+    using iterator = float*;
+    using const_iterator = const float*;
+
+    TensorStorage() = default;
+    explicit TensorStorage(size_t n, float value = 0.0f) { resize(n, value); }
+    TensorStorage(const std::vector<float>& v) { assign(v.begin(), v.end()); }
+    TensorStorage(std::initializer_list<float> values) { assign(values.begin(), values.end()); }
+    TensorStorage(const TensorStorage& other) { assign(other.begin(), other.end()); }
+    TensorStorage(TensorStorage&& other) noexcept
+        : ptr(other.ptr), count(other.count), cap(other.cap), owner(std::move(other.owner)) {
+        other.ptr = nullptr;
+        other.count = other.cap = 0;
+    }
+    ~TensorStorage() { release(); }
+
+    TensorStorage& operator=(const TensorStorage& other) {
+        if (this != &other) assign(other.begin(), other.end());
+        return *this;
+    }
+    TensorStorage& operator=(TensorStorage&& other) noexcept {
+        if (this != &other) {
+            release();
+            ptr = other.ptr;
+            count = other.count;
+            cap = other.cap;
+            owner = std::move(other.owner);
+            other.ptr = nullptr;
+            other.count = other.cap = 0;
+        }
+        return *this;
+    }
+    TensorStorage& operator=(const std::vector<float>& v) {
+        assign(v.begin(), v.end());
+        return *this;
+    }
+
+    // Non-owning view of `n` floats at `data`, kept valid by `owner`
+    static TensorStorage view(float* data, size_t n, std::shared_ptr<const void> owner) {
+        TensorStorage s;
+        s.ptr = data;
+        s.count = n;
+        s.owner = std::move(owner);
+        return s;
+    }
+
+    bool is_view() const { return owner != nullptr; }
+
+    // Owned buffers allocated by the calling thread, read by the profiler
+    struct AllocationStats {
+        unsigned long long count = 0;
+        unsigned long long bytes = 0;
+    };
+    static AllocationStats& allocation_stats() {
+        static thread_local AllocationStats stats;
+        return stats;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    float* data() { return ptr; }
+    const float* data() const { return ptr; }
+    float* begin() { return ptr; }
+    float* end() { return ptr + count; }
+    const float* begin() const { return ptr; }
+    const float* end() const { return ptr + count; }
+    float& operator[](size_t i) { return ptr[i]; }
+    const float& operator[](size_t i) const { return ptr[i]; }
+
+    template<typename It>
+    void assign(It first, It last) {
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        if (is_view() || n > cap) {
+            float* p = allocate(n);
+            std::copy(first, last, p);
+            release();
+            ptr = p;
+            cap = n;
+        } else {
+            std::copy(first, last, ptr);
+        }
+        count = n;
+    }
+
+    void resize(size_t n, float value = 0.0f) {
+        if (is_view() || n > cap) {
+            // The new tail is already zero
+            reallocate(n);
+            if (value != 0.0f && n > count) std::fill(ptr + count, ptr + n, value);
+        } else if (n > count) {
+            std::fill(ptr + count, ptr + n, value);
+        }
+        count = n;
+    }
+
+    void reserve(size_t n) {
+        if (is_view() || n > cap) reallocate(std::max(n, count));
+    }
+
+    void push_back(float value) {
+        if (is_view() || count == cap) reallocate(std::max<size_t>(8, 2 * count));
+        ptr[count++] = value;
+    }
+
+    void clear() {
+        if (is_view()) release();
+        count = 0;
+    }
+
+private:
+    float* ptr = nullptr;
+    size_t count = 0;
+    size_t cap = 0;                      // 0 for views
+    std::shared_ptr<const void> owner;   // set for views only
+
+    static float* allocate(size_t n) {
+        float* p = static_cast<float*>(std::calloc(n ? n : 1, sizeof(float)));
+        if (!p) throw std::bad_alloc();
+        AllocationStats& stats = allocation_stats();
+        stats.count++;
+        stats.bytes += n * sizeof(float);
+        return p;
+    }
+
+    // Moves the first `count` elements into owned memory of capacity n
+    void reallocate(size_t n) {
+        float* p = allocate(n);
+        size_t kept = std::min(count, n);
+        if (kept) std::memcpy(p, ptr, kept * sizeof(float));
+        release();
+        ptr = p;
+        count = kept;
+        cap = n;
+    }
+
+    void release() {
+        if (!owner) std::free(ptr);
+        owner.reset();
+        ptr = nullptr;
+        count = cap = 0;
+    }
+};
@@ -2,28 +2,132 @@
 #include "Sequential.h"
 #include "Optimizer.h"
 #include "Loss.h"
+#include "Checkpoint.h"
 #include <vector>
 #include "Sequential.h"
 #include <iostream>
 #include <numeric>
 #include <algorithm>
 #include <random>
+#include <sstream>
+#include <fstream>
+#include <cstring>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
 
 class Trainer {
 private:
     Sequential& model;
     std::unique_ptr<Optimizer> optimizer;
     Loss& loss_fn;
+    std::unique_ptr<Checkpointer> checkpointer;
+    long long global_step = 0;
+    Random::Stream rng;   // shuffles the training set
+
+    // Position inside fit(), carried by checkpoints
+    int current_epoch = 1;
+    size_t next_sample = 0;          // offset into the epoch's shuffled order
+    float epoch_loss_sum = 0.0f;
+    int epoch_batches = 0;
+    std::string epoch_rng_state;     // rng before the epoch's shuffle
+    size_t resume_dataset_size = 0;
+    int resume_batch_size = 0;
+    bool resuming = false;
+    std::vector<char> trainer_state; // reused by take_checkpoint()
+
+    // Micro-batching (set_micro_batch_size, set_auto_micro_batch)
+    int micro_batch_size = 0;        // 0: off, -1: automatic
+    size_t micro_batch_cache = 0;    // automatic: working-set target, 0 = L2 size
+    int auto_micro_batch = 0;        // chosen size, 0 = not measured yet
+    Tensor micro_X, micro_y;
     
 public:
-    Trainer(Sequential& m, std::unique_ptr<Optimizer> opt, Loss& loss)
-        : model(m), optimizer(std::move(opt)), loss_fn(loss) {}
+    // seed 0 takes the next "Trainer" stream of the global context (Random.h)
+    Trainer(Sequential& m, std::unique_ptr<Optimizer> opt, Loss& loss, unsigned int seed = 0)
+        : model(m), optimizer(std::move(opt)), loss_fn(loss),
+          rng(seed ? Random::seeded(seed) : Random::stream("Trainer")) {}
+
+    // Writes a checkpoint every config.every_n_steps batches during fit()
+    void enable_checkpointing(const CheckpointConfig& config) {
+        checkpointer = std::make_unique<Checkpointer>(config);
+    }
+
+    Checkpointer* get_checkpointer() { return checkpointer.get(); }
+    long long get_global_step() const { return global_step; }
+
+    // Restores weights, optimizer state, random generators and the data
+    // position from a checkpoint. The next fit() with the same data and
+    // batch size continues mid-epoch exactly where the checkpoint was taken.
+    long long resume_from(const std::string& path) {
+        long long step = 0;
+        Checkpoint::Sections sections = Checkpoint::read(path, step);
+        const std::vector<char>* model_bytes = Checkpoint::find(sections, "model");
+        const std::vector<char>* optimizer_bytes = Checkpoint::find(sections, "optimizer");
+        if (!model_bytes || !optimizer_bytes) throw std::runtime_error("Incomplete checkpoint: " + path);
+
+        ModelFormat::restore(model_bytes->data(), model_bytes->size(), model.layers);
+        ModelFormat::Reader opt(optimizer_bytes->data(), optimizer_bytes->size());
+        std::string optimizer_type = opt.str();
+        if (optimizer_type != optimizer->get_optimizer_type()) {
+            throw std::runtime_error("Checkpoint holds " + optimizer_type + " state, trainer uses " + optimizer->get_optimizer_type());
+        }
+        optimizer->read_state(opt);
+        global_step = step;
+
+        // Without a trainer section (older checkpoints) training restarts at epoch 1
+        resuming = false;
+        if (const std::vector<char>* trainer_bytes = Checkpoint::find(sections, "trainer")) {
+            read_trainer_state(*trainer_bytes);
+            resuming = true;
+        }
+        std::cout << "Resumed from " << path << " at step " << step;
+        if (resuming) std::cout << " (epoch " << current_epoch << ", sample " << next_sample << ")";
+        std::cout << std::endl;
+        return step;
+    }
+
+    // Resumes from the newest checkpoint of the enabled checkpointer.
+    // Returns false if there is none.
+    bool resume_from_latest() {
+        if (!checkpointer) return false;
+        const CheckpointConfig& config = checkpointer->get_config();
+        auto found = Checkpoint::list(config.directory, config.prefix);
+        if (found.empty()) return false;
+        resume_from(found.back().second.string());
+        return true;
+    }
+
+    // Splits every batch into micro-batches of `size` samples. Their
+    // gradients accumulate in the layers and the optimizer steps once per
+    // batch, so the update is the whole batch's (up to summation order)
+    // while only one micro-batch of activations is alive. 0 turns it off.
+    void set_micro_batch_size(int size) {
+        if (size < 0) throw std::runtime_error("Micro-batch size must be >= 0");
+        micro_batch_size = size;
+    }
+
+    // Micro-batches sized so that one micro-batch's working set (the
+    // activations saved for backward and their gradients, plus parameters
+    // and their gradients) fits in `cache_bytes`, by default the L2 cache.
+    // The activation size per sample is measured on a first micro-batch of
+    // one sample.
+    void set_auto_micro_batch(size_t cache_bytes = 0) {
+        micro_batch_size = -1;
+        micro_batch_cache = cache_bytes;
+        auto_micro_batch = 0;
+    }
+
+    // Samples per micro-batch: the fixed or chosen size, 0 when off or not
+    // chosen yet
+    int get_micro_batch_size() const { return micro_batch_size < 0 ? auto_micro_batch : micro_batch_size; }
 
     float train_batch(const Tensor& X_batch, const Tensor& y_batch) {
-        Tensor y_pred = model.forward(X_batch);
-        float loss = loss_fn.calculate(y_pred, y_batch);
-        Tensor loss_grad = loss_fn.derivative(y_pred, y_batch);
-        model.backward(loss_grad);
+        Profiler::Scope step_scope("train_batch", Profiler::Phase::TrainStep);
+        const int micro = micro_batch_size < 0 ? auto_micro_batch : micro_batch_size;
+        const bool split = micro_batch_size < 0 ? micro < X_batch.shape[0] : micro > 0 && micro < X_batch.shape[0];
+        float loss = split ? train_micro_batches(X_batch, y_batch) : forward_backward(X_batch, y_batch, 1.0f);
+        Profiler::Scope scope(optimizer->get_optimizer_type() + " step", Profiler::Phase::OptimizerStep);
         optimizer->step(model);
         return loss;
     }
@@ -32,7 +136,13 @@ public:
              const std::vector<Tensor>& X_val, const std::vector<Tensor>& y_val,
              int epochs, int batch_size) {
         
-        for (int epoch = 1; epoch <= epochs; ++epoch) {
+        if (resuming && (resume_dataset_size != X_train.size() || resume_batch_size != batch_size)) {
+            throw std::runtime_error("Resumed checkpoint was taken with a different dataset size or batch size");
+        }
+
+        int first_epoch = resuming ? current_epoch : 1;
+        for (int epoch = first_epoch; epoch <= epochs; ++epoch) {
+            current_epoch = epoch;
             std::cout << "Epoch " << epoch << "/" << epochs << std::endl;
             
             // --- Training Phase ---
@@ -47,18 +157,115 @@ public:
                       << " - Val Loss: " << val_loss 
                       << " - Val Accuracy: " << val_accuracy * 100.0f << "%" << std::endl;
         }
+
+        if (checkpointer) {
+            checkpointer->wait();
+            checkpointer->print_summary();
+        }
     }
 
 private:
+    // Forward, loss and backward of one (micro-)batch, with the loss
+    // gradient scaled by `weight`, the micro-batch's share of its batch
+    float forward_backward(const Tensor& X, const Tensor& y, float weight) {
+        Tensor y_pred = model.forward(X);
+        float loss;
+        Tensor loss_grad;
+        {
+            Profiler::Scope scope("loss", Profiler::Phase::Loss);
+            loss = loss_fn.calculate(y_pred, y);
+            loss_grad = loss_fn.derivative(y_pred, y);
+            if (weight != 1.0f) {
+                for (auto& g : loss_grad.data) g *= weight;
+            }
+        }
+        model.backward(loss_grad);
+        return loss;
+    }
+
+    float train_micro_batches(const Tensor& X, const Tensor& y) {
+        struct StopAccumulating {
+            Sequential& model;
+            ~StopAccumulating() { model.set_accumulate_gradients(false); }
+        } stop{model};
+        model.zero_gradients();
+        model.set_accumulate_gradients(true);
+
+        const int batch = X.shape[0];
+        float loss = 0.0f;
+        for (int start = 0; start < batch;) {
+            int size = micro_batch_size > 0 ? micro_batch_size : std::max(auto_micro_batch, 1);
+            size = std::min(size, batch - start);
+            slice_rows(X, start, size, micro_X);
+            slice_rows(y, start, size, micro_y);
+            const float weight = static_cast<float>(size) / batch;
+            loss += weight * forward_backward(micro_X, micro_y, weight);
+            if (micro_batch_size < 0 && auto_micro_batch == 0) choose_micro_batch(size);
+            start += size;
+        }
+        return loss;
+    }
+
+    // Rows [start, start + count) of a batch
+    static void slice_rows(const Tensor& x, int start, int count, Tensor& out) {
+        std::vector<int> shape = x.shape;
+        shape[0] = count;
+        if (out.shape != shape) out.resize(shape);
+        const size_t row = x.data.size() / x.shape[0];
+        std::copy(x.data.begin() + start * row, x.data.begin() + (start + count) * row, out.data.begin());
+    }
+
+    // Automatic micro-batch size, from the activations the layers hold
+    // after a micro-batch of `samples`
+    void choose_micro_batch(int samples) {
+        const size_t per_sample = std::max<size_t>(2 * model.activation_bytes() / samples, 1);
+        size_t fixed = 0;
+        for (const auto& layer : model.layers) {
+            for (const Tensor* p : static_cast<const Layer&>(*layer).parameters()) fixed += 2 * p->data.size() * sizeof(float);
+        }
+        const size_t cache = micro_batch_cache ? micro_batch_cache : l2_cache_bytes();
+        // Parameters too large for the cache stream from memory either way
+        const size_t available = cache > 2 * fixed ? cache - fixed : cache / 2;
+        auto_micro_batch = static_cast<int>(std::max<size_t>(available / per_sample, 1));
+        std::cout << "Micro-batches of " << auto_micro_batch << " samples (" << per_sample / 1024.0
+                  << " KB per sample, cache " << cache / 1024 << " KB)" << std::endl;
+    }
+
+    // Per-core L2 cache size, 1 MB if unknown
+    static size_t l2_cache_bytes() {
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+        long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (size > 0) return static_cast<size_t>(size);
+#endif
+        std::ifstream file("/sys/devices/system/cpu/cpu0/cache/index2/size");
+        size_t value = 0;
+        std::string unit;
+        if (file >> value) {
+            file >> unit;
+            if (unit == "K") return value << 10;
+            if (unit == "M") return value << 20;
+            return value;
+        }
+        return size_t(1) << 20;
+    }
+
     float train_epoch(const std::vector<Tensor>& X, const std::vector<Tensor>& y, int batch_size) {
-        float total_loss = 0.0f;
-        int num_batches = 0;
-        
         std::vector<int> indices(X.size());
         std::iota(indices.begin(), indices.end(), 0);
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(indices.begin(), indices.end(), g);
+        if (resuming) {
+            // Replay the shuffle of the interrupted epoch
+            std::istringstream ss(epoch_rng_state);
+            ss >> rng;
+            resuming = false;
+        } else {
+            std::ostringstream ss;
+            ss << rng;
+            epoch_rng_state = ss.str();
+            next_sample = 0;
+            epoch_loss_sum = 0.0f;
+            epoch_batches = 0;
+        }
+        std::shuffle(indices.begin(), indices.end(), rng);
 
         // УЛУЧШЕНО: Создаем тензоры для батча один раз вне цикла для производительности
         const auto& first_x = X[0];
@@ -71,7 +278,7 @@ private:
         Tensor X_batch(x_batch_shape);
         Tensor y_batch(y_batch_shape);
 
-        for (size_t i = 0; i < X.size(); i += batch_size) {
+        for (size_t i = next_sample; i < X.size(); i += batch_size) {
             size_t end = std::min(i + batch_size, X.size());
             size_t current_batch_size = end - i;
 
@@ -84,22 +291,65 @@ private:
             }
 
             // Копируем данные в существующие тензоры батча
-            for (size_t j = 0; j < current_batch_size; ++j) {
-                const auto& x_sample = X[indices[i + j]];
-                const auto& y_sample = y[indices[i + j]];
-                std::copy(x_sample.data.begin(), x_sample.data.end(), X_batch.data.begin() + j * x_sample.data.size());
-                std::copy(y_sample.data.begin(), y_sample.data.end(), y_batch.data.begin() + j * y_sample.data.size());
+            {
+                Profiler::Scope scope("batch", Profiler::Phase::BatchAssembly);
+                for (size_t j = 0; j < current_batch_size; ++j) {
+                    const auto& x_sample = X[indices[i + j]];
+                    const auto& y_sample = y[indices[i + j]];
+                    std::copy(x_sample.data.begin(), x_sample.data.end(), X_batch.data.begin() + j * x_sample.data.size());
+                    std::copy(y_sample.data.begin(), y_sample.data.end(), y_batch.data.begin() + j * y_sample.data.size());
+                }
+                scope.set_work(0.0, 2.0 * (X_batch.data.size() + y_batch.data.size()) * sizeof(float));
             }
 
             float batch_loss = train_batch(X_batch, y_batch);
-            total_loss += batch_loss;
-            num_batches++;
+            epoch_loss_sum += batch_loss;
+            epoch_batches++;
+            next_sample = end;
+            global_step++;
+            if (checkpointer && checkpointer->due(global_step)) {
+                take_checkpoint(X.size(), batch_size);
+            }
             
-            std::cout << "\r" << "  Batch " << num_batches << "/" << (X.size() + batch_size - 1) / batch_size
+            std::cout << "\r" << "  Batch " << epoch_batches << "/" << (X.size() + batch_size - 1) / batch_size
                       << " - Batch Loss: " << batch_loss << std::flush;
         }
         std::cout << std::endl;
-        return total_loss / num_batches;
+        return (epoch_batches > 0) ? (epoch_loss_sum / epoch_batches) : 0.0f;
+    }
+
+    void take_checkpoint(size_t dataset_size, int batch_size) {
+        trainer_state.clear();
+        ModelFormat::put_u32(trainer_state, static_cast<uint32_t>(current_epoch));
+        ModelFormat::put_u64(trainer_state, next_sample);
+        ModelFormat::put_u64(trainer_state, dataset_size);
+        ModelFormat::put_u32(trainer_state, static_cast<uint32_t>(batch_size));
+        uint32_t loss_bits;
+        std::memcpy(&loss_bits, &epoch_loss_sum, sizeof(loss_bits));
+        ModelFormat::put_u32(trainer_state, loss_bits);
+        ModelFormat::put_u32(trainer_state, static_cast<uint32_t>(epoch_batches));
+        ModelFormat::put_string(trainer_state, epoch_rng_state);
+        ModelFormat::put_u32(trainer_state, static_cast<uint32_t>(model.layers.size()));
+        for (const auto& layer : model.layers) ModelFormat::put_string(trainer_state, layer->get_rng_state());
+        checkpointer->snapshot(global_step, model, *optimizer, trainer_state);
+    }
+
+    void read_trainer_state(const std::vector<char>& bytes) {
+        ModelFormat::Reader r(bytes.data(), bytes.size());
+        current_epoch = static_cast<int>(r.u32());
+        next_sample = r.u64();
+        resume_dataset_size = r.u64();
+        resume_batch_size = static_cast<int>(r.u32());
+        uint32_t loss_bits = r.u32();
+        std::memcpy(&epoch_loss_sum, &loss_bits, sizeof(loss_bits));
+        epoch_batches = static_cast<int>(r.u32());
+        epoch_rng_state = r.str();
+        uint32_t num_layers = r.u32();
+        if (num_layers != model.layers.size()) throw std::runtime_error("Layer count mismatch in checkpoint");
+        for (const auto& layer : model.layers) {
+            std::string state = r.str();
+            if (!state.empty()) layer->set_rng_state(state);
+        }
     }
 
     std::pair<float, float> evaluate(const std::vector<Tensor>& X, const std::vector<Tensor>& y, int batch_size) {
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Reductions over contiguous float arrays, eight lanes at a time with a
+// scalar tail. The lane-wise partial sums make results differ from a
+// sequential loop in the last bits.
+namespace VectorOps {
+
+#if defined(__AVX2__)
+    inline float horizontal_sum(__m256 v) {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+    }
+#endif
+
+    inline float sum(const float* p, size_t n) {
+        size_t i = 0;
+        float total = 0.0f;
+#if defined(__AVX2__)
+        __m256 acc = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8) acc = _mm256_add_ps(acc, _mm256_loadu_ps(p + i));
+        total = horizontal_sum(acc);
+#endif
+        for (; i < n; ++i) total += p[i];
+        return total;
+    }
+
+    inline float dot(const float* a, const float* b, size_t n) {
+        size_t i = 0;
+        float total = 0.0f;
+#if defined(__AVX2__)
+        __m256 acc = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8) acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        total = horizontal_sum(acc);
+#endif
+        for (; i < n; ++i) total += a[i] * b[i];
+        return total;
+    }
+
+    // Sum of (p[i] - mean)^2
+    inline float squared_deviation(const float* p, size_t n, float mean) {
+        size_t i = 0;
+        float total = 0.0f;
+#if defined(__AVX2__)
+        const __m256 m = _mm256_set1_ps(mean);
+        __m256 acc = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8) {
+            __m256 d = _mm256_sub_ps(_mm256_loadu_ps(p + i), m);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(d, d));
+        }
+        total = horizontal_sum(acc);
+#endif
+        for (; i < n; ++i) total += (p[i] - mean) * (p[i] - mean);
+        return total;
+    }
+
+} // namespace VectorOps
@@ -0,0 +1,106 @@
+// Checks that the hot path of acting and storing transitions does not touch
+// the heap once warmed up: DQNAgent::act/remember, DQNActor::act/remember
+// and ReplayBuffer::push with a full ring. Global operator new is replaced
+// by a counting version; the test fails if any call allocates.
+
+#include "DQNAgent.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+constexpr int STATE_SIZE = 8;
+constexpr int ACTION_SIZE = 3;
+constexpr size_t MEMORY_SIZE = 64;
+constexpr int CALLS = 2000;
+
+// One synthetic environment step: fills `next` from `state` and the action
+// and ends an episode every 25 steps
+bool step(int t, int action, const float* state, float* next) {
+    for (int i = 0; i < STATE_SIZE; ++i) next[i] = state[(i + 1) % STATE_SIZE] * 0.5f + 0.1f * action - 0.05f * i;
+    return t % 25 == 24;
+}
+
+// Runs `steps` act()/remember() calls on `who` with preallocated states
+template<typename Agent>
+int run(Agent& who, int steps, float* state, float* next) {
+    int sum = 0;
+    for (int t = 0; t < steps; ++t) {
+        const int action = who.act(state, STATE_SIZE);
+        const bool done = step(t, action, state, next);
+        who.remember(state, action, 0.1f * action - 0.2f, next, done);
+        std::copy(next, next + STATE_SIZE, state);
+        sum += action;
+    }
+    return sum;
+}
+
+int failures = 0;
+
+void expect_no_allocations(const char* what, size_t before) {
+    const size_t count = allocations.load() - before;
+    std::printf("%-40s %zu allocations over %d calls\n", what, count, CALLS);
+    if (count != 0) ++failures;
+}
+
+} // namespace
+
+int main() {
+    DQNConfig config;
+    config.memory_size = MEMORY_SIZE;
+    // Half the actions greedy, half random, so both branches of act() run
+    config.epsilon = 0.5f;
+    config.epsilon_min = 0.5f;
+    config.seed = 7;
+    DQNAgent agent(STATE_SIZE, ACTION_SIZE, config);
+    DQNActor actor(agent, 1);
+    actor.refresh_policy();
+
+    std::vector<float> state(STATE_SIZE, 0.25f), next(STATE_SIZE);
+
+    // Warm up the inference workspaces and wrap the replay ring
+    run(agent, 4 * MEMORY_SIZE, state.data(), next.data());
+    run(actor, 4 * MEMORY_SIZE, state.data(), next.data());
+    if (agent.get_memory().size() != MEMORY_SIZE) {
+        std::printf("replay ring not full after warm-up\n");
+        return 1;
+    }
+
+    size_t before = allocations.load();
+    int sink = run(agent, CALLS, state.data(), next.data());
+    expect_no_allocations("DQNAgent::act + remember", before);
+
+    before = allocations.load();
+    sink += run(actor, CALLS, state.data(), next.data());
+    expect_no_allocations("DQNActor::act + remember", before);
+
+    before = allocations.load();
+    for (int t = 0; t < CALLS; ++t) {
+        agent.get_memory().push(state.data(), STATE_SIZE, t % ACTION_SIZE, 1.0f, next.data(), t % 2 == 0, 0.9f);
+    }
+    expect_no_allocations("ReplayBuffer::push (full ring)", before);
+
+    std::printf("action checksum %d\n", sink);
+    return failures == 0 ? 0 : 1;
+}
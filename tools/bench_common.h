@@ -0,0 +1,209 @@
+// Shared pieces of the benchmark executables (edunet_bench,
+// edunet_train_bench): statistics over repeated samples, CPU pinning, the
+// run context and a reader for the JSON results they write.
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace Bench {
+
+    using clock = std::chrono::steady_clock;
+
+    inline double elapsed_ns(clock::time_point start) {
+        return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    }
+
+    // Nearest-rank percentile of already sorted values
+    inline double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    struct Stats {
+        size_t samples = 0;
+        double median = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        double mean = 0.0;
+        double stddev = 0.0;
+    };
+
+    inline Stats summarize(std::vector<double> values) {
+        Stats s;
+        s.samples = values.size();
+        if (values.empty()) return s;
+        std::sort(values.begin(), values.end());
+        s.median = percentile(values, 50.0);
+        s.p95 = percentile(values, 95.0);
+        s.p99 = percentile(values, 99.0);
+        s.min = values.front();
+        s.max = values.back();
+        for (double v : values) s.mean += v;
+        s.mean /= values.size();
+        for (double v : values) s.stddev += (v - s.mean) * (v - s.mean);
+        s.stddev = values.size() > 1 ? std::sqrt(s.stddev / (values.size() - 1)) : 0.0;
+        return s;
+    }
+
+    // Pins the calling thread to `cpu`, or to the first CPU it may run on
+    // when cpu < 0. Returns the CPU, or -1 where pinning is unsupported.
+    inline int pin_to_cpu(int cpu) {
+#if defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return -1;
+        if (cpu < 0) {
+            for (int c = 0; c < CPU_SETSIZE; ++c) {
+                if (CPU_ISSET(c, &allowed)) { cpu = c; break; }
+            }
+        }
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return -1;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            throw std::runtime_error("Cannot pin to CPU " + std::to_string(cpu));
+        }
+        return cpu;
+#else
+        (void)cpu;
+        return -1;
+#endif
+    }
+
+    // Restarts the peak RSS count at the current RSS, so that several
+    // workloads run in one process each report their own peak. Heap freed
+    // by an earlier workload is handed back first so it is not counted
+    // again. Returns false where the kernel does not support it.
+    inline bool reset_peak_rss() {
+#if defined(__GLIBC__)
+        malloc_trim(0);
+#endif
+#if defined(__linux__)
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        clear_refs << "5";
+        clear_refs.flush();
+        return static_cast<bool>(clear_refs);
+#else
+        return false;
+#endif
+    }
+
+    // Peak resident set size in bytes since the last reset_peak_rss() (since
+    // process start without one), 0 if unknown
+    inline long long peak_rss_bytes() {
+#if defined(__linux__)
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind("VmHWM:", 0) == 0) return std::atoll(line.c_str() + 6) * 1024;
+        }
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) == 0) return static_cast<long long>(usage.ru_maxrss) * 1024;
+#endif
+        return 0;
+    }
+
+    inline std::string cpu_model() {
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuinfo, line)) {
+            if (line.rfind("model name", 0) == 0) {
+                size_t colon = line.find(':');
+                if (colon != std::string::npos) return line.substr(line.find_first_not_of(' ', colon + 1));
+            }
+        }
+        return "unknown";
+    }
+
+    // Instruction sets the kernels were compiled for
+    inline std::string compiled_isa() {
+        std::string isa;
+        auto add = [&isa](const char* name) { isa += (isa.empty() ? "" : " ") + std::string(name); };
+#if defined(__AVX512F__)
+        add("avx512f");
+#endif
+#if defined(__AVX512VNNI__)
+        add("avx512vnni");
+#endif
+#if defined(__AVX512BF16__)
+        add("avx512bf16");
+#endif
+#if defined(__AVX2__)
+        add("avx2");
+#endif
+#if defined(__FMA__)
+        add("fma");
+#endif
+#if defined(__F16C__)
+        add("f16c");
+#endif
+        return isa.empty() ? "generic" : isa;
+    }
+
+    inline std::string json_escape(const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) < 0x20) continue;
+            out += c;
+        }
+        return out;
+    }
+
+    // "context" object shared by the JSON results
+    inline std::string context_json(int pinned_cpu) {
+        std::ostringstream os;
+        std::time_t now = std::time(nullptr);
+        char date[32];
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+        os << "{\"date\": \"" << date << "\", \"cpu\": \"" << json_escape(cpu_model()) << "\", \"isa\": \"" << compiled_isa()
+           << "\", \"compiler\": \"" << json_escape(__VERSION__) << "\", \"build_type\": \""
+#if defined(EDUNET_BUILD_TYPE)
+           << EDUNET_BUILD_TYPE
+#endif
+           << "\", \"pinned_cpu\": " << pinned_cpu << "}";
+        return os.str();
+    }
+
+    // Reads `field` of every result in a file written by these tools. The
+    // writers put one result object per line with "name" first, so a line
+    // scan is enough; this is not a general JSON parser.
+    inline std::map<std::string, double> read_results(const std::string& filename, const std::string& field) {
+        std::ifstream file(filename);
+        if (!file) throw std::runtime_error("Cannot open file: " + filename);
+        std::map<std::string, double> results;
+        std::string line;
+        const std::string name_key = "\"name\": \"", field_key = "\"" + field + "\": ";
+        while (std::getline(file, line)) {
+            size_t name_pos = line.find(name_key);
+            size_t field_pos = line.find(field_key);
+            if (name_pos == std::string::npos || field_pos == std::string::npos) continue;
+            size_t start = name_pos + name_key.size();
+            std::string name = line.substr(start, line.find('"', start) - start);
+            results[name] = std::strtod(line.c_str() + field_pos + field_key.size(), nullptr);
+        }
+        return results;
+    }
+
+} // namespace Bench
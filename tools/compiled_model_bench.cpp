@@ -0,0 +1,74 @@
+// Compares a model compiled by edunet_compile with the interpreted
+// Sequential it came from: output agreement and time per sample.
+// Built when EDUNET_COMPILE_MODEL is set (see the top-level CMakeLists.txt).
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include "Sequential.h"
+#include "compiled_model.h"
+
+template<typename F>
+static double time_per_call_us(F&& run, int calls) {
+    run();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) run();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / calls;
+}
+
+int main(int argc, char** argv) {
+    int samples = argc > 1 ? std::atoi(argv[1]) : 1000;
+    if (samples <= 0) samples = 1000;
+
+    Sequential model;
+    model.load_model(EDUNET_COMPILED_MODEL_PATH);
+    model.eval();
+
+    std::vector<int> shape = {1};
+    shape.insert(shape.end(), std::begin(compiled_model::INPUT_SHAPE), std::end(compiled_model::INPUT_SHAPE));
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    std::vector<Tensor> inputs;
+    for (int i = 0; i < samples; ++i) {
+        Tensor x(shape);
+        for (auto& v : x.data) v = dist(gen);
+        inputs.push_back(x);
+    }
+
+    // Agreement with the interpreted inference path
+    std::vector<Tensor> workspace;
+    std::vector<float> out(compiled_model::OUTPUT_SIZE);
+    double max_diff = 0.0;
+    int exact = 0;
+    for (const Tensor& x : inputs) {
+        const Tensor& ref = model.forward_into(x, workspace);
+        compiled_model::predict(x.data.data(), out.data());
+        double diff = 0.0;
+        for (int j = 0; j < compiled_model::OUTPUT_SIZE; ++j) diff = std::max(diff, std::abs(static_cast<double>(ref.data[j]) - out[j]));
+        max_diff = std::max(max_diff, diff);
+        if (diff == 0.0) exact++;
+    }
+
+    size_t next = 0;
+    auto pick = [&]() -> const Tensor& { next = (next + 1) % inputs.size(); return inputs[next]; };
+    int calls = std::max(100, samples);
+    double forward_us = time_per_call_us([&] { model.forward(pick()); }, calls);
+    double forward_into_us = time_per_call_us([&] { model.forward_into(pick(), workspace); }, calls);
+    double compiled_us = time_per_call_us([&] { compiled_model::predict(pick().data.data(), out.data()); }, calls);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Samples: " << samples << ", bit-exact outputs: " << exact << ", max abs difference: "
+              << std::scientific << max_diff << std::fixed << std::endl;
+    std::cout << "Sequential::forward       " << std::setw(10) << forward_us << " us/sample" << std::endl;
+    std::cout << "Sequential::forward_into  " << std::setw(10) << forward_into_us << " us/sample" << std::endl;
+    std::cout << "compiled predict          " << std::setw(10) << compiled_us << " us/sample  ("
+              << forward_into_us / compiled_us << "x vs forward_into)" << std::endl;
+    return 0;
+}
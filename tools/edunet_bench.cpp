@@ -0,0 +1,373 @@
+// Kernel microbenchmarks: Tensor::dot, layer forward/backward at the shapes
+// of the demo models, optimizer steps and data loading. Every case is warmed
+// up, calibrated so that one sample lasts at least --min-sample-ms, then
+// sampled --repetitions times on a pinned CPU; the table and the JSON
+// output report per-iteration median, p95 and min.
+// Usage: edunet_bench [--filter TEXT] [--json FILE] [--compare FILE] [options]
+
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Sequential.h"
+#include "Optimizer.h"
+#include "DataLoader.h"
+#include "ReplayBuffer.h"
+#include "Parallel.h"
+#include "bench_common.h"
+
+struct BenchCase {
+    std::string name;
+    std::function<void()> run;
+    double flops = 0.0;   // per iteration, for GFLOP/s
+    double bytes = 0.0;   // per iteration, for GB/s when flops is 0
+};
+
+struct BenchOptions {
+    std::string filter;
+    std::string json_path;
+    std::string compare_path;
+    int repetitions = 15;
+    int warmup = 3;
+    double min_sample_ms = 20.0;
+    int cpu = -1;
+    bool pin = true;
+    bool list = false;
+};
+
+static volatile float sink;
+
+static Tensor random_tensor(const std::vector<int>& shape, std::mt19937& gen) {
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    Tensor t(shape);
+    for (auto& v : t.data) v = dist(gen);
+    return t;
+}
+
+static std::string shape_name(const std::vector<int>& shape) {
+    std::string s;
+    for (size_t i = 0; i < shape.size(); ++i) s += (i ? "x" : "") + std::to_string(shape[i]);
+    return s;
+}
+
+static void add_dot(std::vector<BenchCase>& cases, const std::string& label, int m, int k, int n) {
+    std::mt19937 gen(1);
+    auto a = std::make_shared<Tensor>(random_tensor({m, k}, gen));
+    auto b = std::make_shared<Tensor>(random_tensor({k, n}, gen));
+    cases.push_back({"dot/" + label + "/" + std::to_string(m) + "x" + std::to_string(k) + "x" + std::to_string(n),
+                     [a, b] { sink = Tensor::dot(*a, *b).data[0]; }, 2.0 * m * k * n});
+}
+
+// forward, backward and (for batch 1) forward_into of one layer
+static void add_layer(std::vector<BenchCase>& cases, const std::string& label, std::shared_ptr<Layer> layer,
+                      const std::vector<int>& input_shape) {
+    std::mt19937 gen(2);
+    auto input = std::make_shared<Tensor>(random_tensor(input_shape, gen));
+    Tensor output = layer->forward(*input);
+    auto gradient = std::make_shared<Tensor>(random_tensor(output.shape, gen));
+    const double flops = layer->forward_flops(input->shape, output.shape);
+    const std::string name = label + "/" + layer->get_layer_type() + "/" + shape_name(input_shape);
+
+    cases.push_back({name + "/forward", [layer, input] { sink = layer->forward(*input).data[0]; }, flops});
+    cases.push_back({name + "/backward", [layer, input, gradient] { sink = layer->backward(*gradient).data[0]; },
+                     layer->parameters().empty() ? flops : 2.0 * flops});
+    if (input_shape[0] == 1) {
+        auto out = std::make_shared<Tensor>();
+        cases.push_back({name + "/forward_into", [layer, input, out] { layer->forward_into(*input, *out); sink = out->data[0]; }, flops});
+    }
+}
+
+static std::shared_ptr<Sequential> lenet() {
+    auto model = std::make_shared<Sequential>();
+    model->add(std::make_unique<Conv2DLayer>(1, 6, 5));
+    model->add(std::make_unique<ReLULayer>());
+    model->add(std::make_unique<MaxPooling2DLayer>(2));
+    model->add(std::make_unique<Conv2DLayer>(6, 16, 5));
+    model->add(std::make_unique<ReLULayer>());
+    model->add(std::make_unique<MaxPooling2DLayer>(2));
+    model->add(std::make_unique<FlattenLayer>());
+    model->add(std::make_unique<DenseLayer>(256, 120));
+    model->add(std::make_unique<ReLULayer>());
+    model->add(std::make_unique<DenseLayer>(120, 84));
+    model->add(std::make_unique<ReLULayer>());
+    model->add(std::make_unique<DenseLayer>(84, 10));
+    model->add(std::make_unique<SoftmaxLayer>());
+    return model;
+}
+
+static std::shared_ptr<Sequential> mlp(const std::vector<int>& sizes) {
+    auto model = std::make_shared<Sequential>();
+    for (size_t i = 0; i + 1 < sizes.size(); ++i) {
+        model->add(std::make_unique<DenseLayer>(sizes[i], sizes[i + 1]));
+        if (i + 2 < sizes.size()) model->add(std::make_unique<ReLULayer>());
+    }
+    return model;
+}
+
+static void add_optimizer(std::vector<BenchCase>& cases, const std::string& label, std::shared_ptr<Sequential> model,
+                          std::shared_ptr<Optimizer> optimizer) {
+    double params = 0.0;
+    for (const auto& layer : model->layers) {
+        for (const Tensor* p : static_cast<const Layer&>(*layer).parameters()) params += p->data.size();
+    }
+    // Adam reads parameter, gradient and both moments and writes three of them
+    const double bytes = params * sizeof(float) * (optimizer->get_optimizer_type() == "Adam" ? 7.0 : 3.0);
+    cases.push_back({"optimizer/" + label + "/" + optimizer->get_optimizer_type() + "/" + std::to_string(static_cast<long long>(params)),
+                     [model, optimizer] { optimizer->step(*model); }, 0.0, bytes});
+}
+
+// MNIST IDX files of `count` random images in the temp directory
+static std::string write_mnist_files(int count) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "edunet_bench";
+    fs::create_directories(dir);
+    std::mt19937 gen(3);
+    auto be32 = [](std::ofstream& f, uint32_t v) {
+        unsigned char b[4] = {static_cast<unsigned char>(v >> 24), static_cast<unsigned char>(v >> 16),
+                              static_cast<unsigned char>(v >> 8), static_cast<unsigned char>(v)};
+        f.write(reinterpret_cast<const char*>(b), 4);
+    };
+    std::ofstream images(dir / "images-idx3-ubyte", std::ios::binary);
+    be32(images, 2051); be32(images, count); be32(images, 28); be32(images, 28);
+    std::vector<char> pixels(28 * 28);
+    for (int i = 0; i < count; ++i) {
+        for (auto& p : pixels) p = static_cast<char>(gen() & 0xff);
+        images.write(pixels.data(), pixels.size());
+    }
+    std::ofstream labels(dir / "labels-idx1-ubyte", std::ios::binary);
+    be32(labels, 2049); be32(labels, count);
+    for (int i = 0; i < count; ++i) labels.put(static_cast<char>(gen() % 10));
+    return dir.string() + "/";
+}
+
+static void add_data_loaders(std::vector<BenchCase>& cases) {
+    const int count = 10000;
+    const std::string dir = write_mnist_files(count);
+    // The loaders log every call; keep that out of the benchmark output
+    auto quiet = [](const std::function<void()>& f) {
+        std::streambuf* saved = std::cout.rdbuf(nullptr);
+        f();
+        std::cout.rdbuf(saved);
+    };
+    cases.push_back({"data/mnist_images/" + std::to_string(count), [dir, quiet] {
+        quiet([&] { sink = MNISTDataLoader::load_images(dir + "images-idx3-ubyte")[0].data[0]; });
+    }, 0.0, count * 28.0 * 28.0});
+    cases.push_back({"data/mnist_labels/" + std::to_string(count), [dir, quiet] {
+        quiet([&] { sink = MNISTDataLoader::load_labels(dir + "labels-idx1-ubyte")[0].data[0]; });
+    }, 0.0, count * 1.0});
+
+    // DQN replay: 100k 8-float transitions, minibatches of 32
+    auto buffer = std::make_shared<ReplayBuffer>(100000);
+    std::mt19937 gen(4);
+    std::vector<float> state(8), next_state(8);
+    for (int i = 0; i < 100000; ++i) {
+        for (auto& v : state) v = static_cast<float>(gen() % 100) / 100.0f;
+        buffer->push(state.data(), state.size(), i % 3, 1.0f, next_state.data(), false, 0.99f);
+    }
+    auto batch = std::make_shared<TransitionBatch>();
+    auto rng = std::make_shared<std::mt19937>(5);
+    cases.push_back({"data/replay_sample/32", [buffer, batch, rng] {
+        buffer->sample(32, *rng, *batch);
+        sink = batch->states.data[0];
+    }, 0.0, 32.0 * (2 * 8 + 3) * sizeof(float)});
+}
+
+static std::vector<BenchCase> build_cases() {
+    std::vector<BenchCase> cases;
+
+    add_dot(cases, "dqn", 32, 24, 24);
+    add_dot(cases, "lenet_fc1", 64, 256, 120);
+    add_dot(cases, "mlp", 64, 1024, 1024);
+    add_dot(cases, "square", 512, 512, 512);
+
+    // MNIST LeNet (batch 64)
+    add_layer(cases, "lenet", std::make_shared<Conv2DLayer>(1, 6, 5), {64, 1, 28, 28});
+    add_layer(cases, "lenet", std::make_shared<ReLULayer>(), {64, 6, 24, 24});
+    add_layer(cases, "lenet", std::make_shared<MaxPooling2DLayer>(2), {64, 6, 24, 24});
+    add_layer(cases, "lenet", std::make_shared<Conv2DLayer>(6, 16, 5), {64, 6, 12, 12});
+    add_layer(cases, "lenet", std::make_shared<FusedConv2DLayer>(Conv2DLayer(6, 16, 5), 2, 2), {64, 6, 12, 12});
+    add_layer(cases, "lenet", std::make_shared<DenseLayer>(256, 120), {64, 256});
+    add_layer(cases, "lenet", std::make_shared<SoftmaxLayer>(), {64, 10});
+
+    // Snake DQN MLP 8-24-24-3: acting (batch 1) and replay (batch 32)
+    add_layer(cases, "dqn", std::make_shared<DenseLayer>(8, 24), {1, 8});
+    add_layer(cases, "dqn", std::make_shared<DenseLayer>(24, 24), {32, 24});
+
+    // Large MLP
+    add_layer(cases, "mlp", std::make_shared<DenseLayer>(1024, 1024), {64, 1024});
+    add_layer(cases, "mlp", std::make_shared<DenseLayer>(1024, 1024), {1, 1024});
+    add_layer(cases, "mlp", std::make_shared<DropoutLayer>(0.5f), {64, 1024});
+
+    // 3x3 conv stack on 32x32 feature maps
+    add_layer(cases, "conv3x3", std::make_shared<Conv2DLayer>(3, 16, 3, 1, 1), {16, 3, 32, 32});
+    add_layer(cases, "conv3x3", std::make_shared<Conv2DLayer>(16, 32, 3, 1, 1), {16, 16, 32, 32});
+    add_layer(cases, "conv3x3", std::make_shared<Conv2DLayer>(32, 32, 3, 1, 1), {16, 32, 16, 16});
+
+    // MobileNet-style separable block (3x3 depthwise + 1x1 pointwise) and a
+    // 4-group 3x3 conv, at the shape of the last dense conv3x3 case
+    add_layer(cases, "separable", std::make_shared<GroupedConv2DLayer>(32, 32, 3, 1, 1, 32), {16, 32, 16, 16});
+    add_layer(cases, "separable", std::make_shared<Conv2DLayer>(32, 32, 1), {16, 32, 16, 16});
+    add_layer(cases, "grouped", std::make_shared<GroupedConv2DLayer>(32, 32, 3, 1, 1, 4), {16, 32, 16, 16});
+
+    // Pooling at the same shape: 2x2 average and the global average head
+    add_layer(cases, "pool", std::make_shared<AveragePooling2DLayer>(2), {16, 32, 16, 16});
+    add_layer(cases, "pool", std::make_shared<GlobalAveragePoolingLayer>(), {16, 32, 16, 16});
+
+    add_optimizer(cases, "lenet", lenet(), std::make_shared<SGD>(0.01f));
+    add_optimizer(cases, "lenet", lenet(), std::make_shared<Adam>(0.001f));
+    add_optimizer(cases, "mlp", mlp({784, 1024, 1024, 10}), std::make_shared<SGD>(0.01f));
+    add_optimizer(cases, "mlp", mlp({784, 1024, 1024, 10}), std::make_shared<Adam>(0.001f));
+
+    add_data_loaders(cases);
+    return cases;
+}
+
+struct BenchResult {
+    std::string name;
+    long long iterations = 0;   // per sample
+    Bench::Stats ns;            // per iteration
+    double flops = 0.0;
+    double bytes = 0.0;
+};
+
+static BenchResult measure(const BenchCase& c, const BenchOptions& options) {
+    for (int i = 0; i < options.warmup; ++i) c.run();
+
+    // Grow the iteration count until one sample reaches min_sample_ms
+    long long iterations = 1;
+    const double target_ns = options.min_sample_ms * 1e6;
+    while (true) {
+        auto start = Bench::clock::now();
+        for (long long i = 0; i < iterations; ++i) c.run();
+        double ns = Bench::elapsed_ns(start);
+        if (ns >= target_ns || iterations >= (1LL << 30)) break;
+        iterations = ns > 0 ? std::max(iterations + 1, static_cast<long long>(iterations * target_ns * 1.2 / ns))
+                            : iterations * 10;
+    }
+
+    std::vector<double> samples;
+    for (int r = 0; r < options.repetitions; ++r) {
+        auto start = Bench::clock::now();
+        for (long long i = 0; i < iterations; ++i) c.run();
+        samples.push_back(Bench::elapsed_ns(start) / iterations);
+    }
+    return {c.name, iterations, Bench::summarize(samples), c.flops, c.bytes};
+}
+
+static std::string format_ns(double ns) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(ns < 1e3 ? 1 : 2);
+    if (ns < 1e3) os << ns << " ns";
+    else if (ns < 1e6) os << ns / 1e3 << " us";
+    else os << ns / 1e6 << " ms";
+    return os.str();
+}
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --filter TEXT        run only cases whose name contains TEXT\n"
+              << "  --list               list the cases and exit\n"
+              << "  --repetitions N      samples per case (default 15)\n"
+              << "  --warmup N           untimed runs before calibration (default 3)\n"
+              << "  --min-sample-ms MS   minimum duration of one sample (default 20)\n"
+              << "  --cpu N              CPU to pin to (default: first allowed CPU)\n"
+              << "  --no-pin             do not pin the benchmark thread\n"
+              << "  --json FILE          write the results as JSON\n"
+              << "  --compare FILE       print the change of each median against an earlier --json file\n"
+              << "  --help               show this message\n";
+}
+
+static BenchOptions parse_options(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "--filter") options.filter = value();
+        else if (arg == "--json") options.json_path = value();
+        else if (arg == "--compare") options.compare_path = value();
+        else if (arg == "--repetitions") options.repetitions = std::max(1, std::stoi(value()));
+        else if (arg == "--warmup") options.warmup = std::max(0, std::stoi(value()));
+        else if (arg == "--min-sample-ms") options.min_sample_ms = std::stod(value());
+        else if (arg == "--cpu") options.cpu = std::stoi(value());
+        else if (arg == "--no-pin") options.pin = false;
+        else if (arg == "--list") options.list = true;
+        else if (arg == "--help" || arg == "-h") { print_usage(argv[0]); std::exit(0); }
+        else throw std::runtime_error("Unknown option: " + arg);
+    }
+    return options;
+}
+
+int main(int argc, char** argv) {
+    try {
+        BenchOptions options = parse_options(argc, argv);
+        Random::seed(1);   // same weights, and so the same ReLU sparsity, in every run
+        std::vector<BenchCase> cases;
+        for (auto& c : build_cases()) {
+            if (c.name.find(options.filter) != std::string::npos) cases.push_back(std::move(c));
+        }
+        if (options.list) {
+            for (const auto& c : cases) std::cout << c.name << std::endl;
+            return 0;
+        }
+
+        int pinned_cpu = options.pin ? Bench::pin_to_cpu(options.cpu) : -1;
+        // Workers would inherit the one-CPU mask and only time-slice with us
+        if (pinned_cpu >= 0) Parallel::set_threads(1);
+        std::map<std::string, double> baseline;
+        if (!options.compare_path.empty()) baseline = Bench::read_results(options.compare_path, "median_ns");
+
+        std::cout << "CPU: " << Bench::cpu_model() << " (" << Bench::compiled_isa() << "), pinned to "
+                  << (pinned_cpu >= 0 ? std::to_string(pinned_cpu) : std::string("none")) << ", "
+                  << options.repetitions << " samples of >= " << options.min_sample_ms << " ms" << std::endl;
+        std::cout << std::left << std::setw(52) << "Benchmark" << std::right << std::setw(12) << "Median"
+                  << std::setw(12) << "p95" << std::setw(12) << "Min" << std::setw(14) << "Throughput"
+                  << (baseline.empty() ? "" : "    Change") << std::endl;
+
+        std::vector<BenchResult> results;
+        for (const auto& c : cases) {
+            BenchResult r = measure(c, options);
+            std::ostringstream throughput;
+            throughput << std::setprecision(3);
+            if (r.flops > 0) throughput << r.flops / r.ns.median << " GF/s";
+            else if (r.bytes > 0) throughput << r.bytes / r.ns.median << " GB/s";
+            std::cout << std::left << std::setw(52) << r.name << std::right << std::setw(12) << format_ns(r.ns.median)
+                      << std::setw(12) << format_ns(r.ns.p95) << std::setw(12) << format_ns(r.ns.min)
+                      << std::setw(14) << throughput.str();
+            auto old = baseline.find(r.name);
+            if (old != baseline.end() && old->second > 0) {
+                std::cout << std::setw(9) << std::showpos << std::fixed << std::setprecision(1)
+                          << 100.0 * (r.ns.median / old->second - 1.0) << "%" << std::noshowpos;
+            }
+            std::cout << std::endl;
+            results.push_back(r);
+        }
+
+        if (!options.json_path.empty()) {
+            std::ofstream json(options.json_path);
+            if (!json) throw std::runtime_error("Cannot open file for writing: " + options.json_path);
+            json << std::setprecision(6);
+            json << "{\n\"context\": " << Bench::context_json(pinned_cpu) << ",\n\"benchmarks\": [\n";
+            for (size_t i = 0; i < results.size(); ++i) {
+                const BenchResult& r = results[i];
+                json << "{\"name\": \"" << Bench::json_escape(r.name) << "\", \"iterations\": " << r.iterations
+                     << ", \"samples\": " << r.ns.samples << ", \"median_ns\": " << r.ns.median << ", \"p95_ns\": " << r.ns.p95
+                     << ", \"min_ns\": " << r.ns.min << ", \"mean_ns\": " << r.ns.mean << ", \"stddev_ns\": " << r.ns.stddev
+                     << ", \"flops\": " << r.flops << ", \"bytes\": " << r.bytes << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+            }
+            json << "]\n}\n";
+            std::cout << "Results written to " << options.json_path << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
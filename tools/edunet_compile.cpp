@@ -0,0 +1,434 @@
+// Ahead-of-time model compiler: turns a saved Sequential model into a
+// standalone C++ header with every shape a compile-time constant, the layer
+// calls unrolled, fixed activation buffers and the weights embedded.
+// Usage: edunet_compile MODEL OUTPUT --input SHAPE [--namespace NAME]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "Sequential.h"
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " MODEL OUTPUT --input SHAPE [options]\n"
+              << "  MODEL           model saved with Sequential::save_model\n"
+              << "  OUTPUT          header to generate\n"
+              << "  --input SHAPE   shape of one input sample, e.g. 1,28,28 or 11\n"
+              << "  --namespace N   namespace of the generated code (default compiled_model)\n"
+              << "  --help          show this message\n";
+}
+
+static std::vector<int> parse_shape(const std::string& text) {
+    std::vector<int> shape;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int dim = std::stoi(item);
+        if (dim <= 0) throw std::runtime_error("Non-positive dimension in input shape");
+        shape.push_back(dim);
+    }
+    if (shape.empty()) throw std::runtime_error("Empty input shape");
+    return shape;
+}
+
+static std::string join(const std::vector<int>& values) {
+    std::string out;
+    for (size_t i = 0; i < values.size(); ++i) out += (i ? "," : "") + std::to_string(values[i]);
+    return out;
+}
+
+static int element_count(const std::vector<int>& shape) {
+    int total = 1;
+    for (size_t i = 1; i < shape.size(); ++i) total *= shape[i];
+    return total;
+}
+
+// Kernels shared by every generated model. The per-output summation order
+// matches the interpreted layers, so results agree to the last bit unless
+// the compiler contracts multiply-adds differently.
+static const char* KERNELS = R"(namespace detail {
+
+template<int IN, int OUT>
+inline void dense(const float* __restrict x, const float* __restrict w, const float* __restrict b, float* __restrict y) {
+    for (int j = 0; j < OUT; ++j) y[j] = b[j];
+    for (int k = 0; k < IN; ++k) {
+        const float a = x[k];
+        const float* row = w + k * OUT;
+        for (int j = 0; j < OUT; ++j) y[j] += a * row[j];
+    }
+}
+
+template<int C_IN, int H, int W, int C_OUT, int K, int S, int P>
+inline void conv2d(const float* __restrict x, const float* __restrict w, const float* __restrict b, float* __restrict y) {
+    constexpr int H_OUT = (H + 2 * P - K) / S + 1;
+    constexpr int W_OUT = (W + 2 * P - K) / S + 1;
+    for (int co = 0; co < C_OUT; ++co) {
+        float* plane = y + co * H_OUT * W_OUT;
+        for (int i = 0; i < H_OUT * W_OUT; ++i) plane[i] = b[co];
+        for (int ci = 0; ci < C_IN; ++ci) {
+            for (int kh = 0; kh < K; ++kh) {
+                for (int kw = 0; kw < K; ++kw) {
+                    const float wv = w[((co * C_IN + ci) * K + kh) * K + kw];
+                    // Output columns whose input column lies inside the image
+                    int w_lo = 0;
+                    while (w_lo < W_OUT && w_lo * S + kw - P < 0) ++w_lo;
+                    int w_hi = W_OUT;
+                    while (w_hi > w_lo && (w_hi - 1) * S + kw - P >= W) --w_hi;
+                    for (int h = 0; h < H_OUT; ++h) {
+                        const int hi = h * S + kh - P;
+                        if (hi < 0 || hi >= H) continue;
+                        const float* in_row = x + (ci * H + hi) * W + kw - P;
+                        float* out_row = plane + h * W_OUT;
+                        for (int c = w_lo; c < w_hi; ++c) out_row[c] += in_row[c * S] * wv;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Output channel co reads input channels [co / (C_OUT / G) * (C_IN / G), +C_IN / G)
+template<int C_IN, int H, int W, int C_OUT, int K, int S, int P, int G>
+inline void grouped_conv2d(const float* __restrict x, const float* __restrict w, const float* __restrict b, float* __restrict y) {
+    constexpr int H_OUT = (H + 2 * P - K) / S + 1;
+    constexpr int W_OUT = (W + 2 * P - K) / S + 1;
+    constexpr int C_IN_G = C_IN / G, C_OUT_G = C_OUT / G;
+    for (int co = 0; co < C_OUT; ++co) {
+        float* plane = y + co * H_OUT * W_OUT;
+        for (int i = 0; i < H_OUT * W_OUT; ++i) plane[i] = b[co];
+        const int first = co / C_OUT_G * C_IN_G;
+        for (int cl = 0; cl < C_IN_G; ++cl) {
+            for (int kh = 0; kh < K; ++kh) {
+                for (int kw = 0; kw < K; ++kw) {
+                    const float wv = w[((co * C_IN_G + cl) * K + kh) * K + kw];
+                    int w_lo = 0;
+                    while (w_lo < W_OUT && w_lo * S + kw - P < 0) ++w_lo;
+                    int w_hi = W_OUT;
+                    while (w_hi > w_lo && (w_hi - 1) * S + kw - P >= W) --w_hi;
+                    for (int h = 0; h < H_OUT; ++h) {
+                        const int hi = h * S + kh - P;
+                        if (hi < 0 || hi >= H) continue;
+                        const float* in_row = x + ((first + cl) * H + hi) * W + kw - P;
+                        float* out_row = plane + h * W_OUT;
+                        for (int c = w_lo; c < w_hi; ++c) out_row[c] += in_row[c * S] * wv;
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<int C, int H, int W, int POOL, int S>
+inline void maxpool(const float* __restrict x, float* __restrict y) {
+    constexpr int H_OUT = (H - POOL) / S + 1;
+    constexpr int W_OUT = (W - POOL) / S + 1;
+    for (int c = 0; c < C; ++c) {
+        for (int h = 0; h < H_OUT; ++h) {
+            for (int w = 0; w < W_OUT; ++w) {
+                float m = -std::numeric_limits<float>::infinity();
+                for (int ph = 0; ph < POOL; ++ph) {
+                    for (int pw = 0; pw < POOL; ++pw) {
+                        m = std::max(m, x[(c * H + h * S + ph) * W + w * S + pw]);
+                    }
+                }
+                y[(c * H_OUT + h) * W_OUT + w] = m;
+            }
+        }
+    }
+}
+
+template<int C, int H, int W, int POOL, int S>
+inline void avgpool(const float* __restrict x, float* __restrict y) {
+    constexpr int H_OUT = (H - POOL) / S + 1;
+    constexpr int W_OUT = (W - POOL) / S + 1;
+    for (int c = 0; c < C; ++c) {
+        for (int h = 0; h < H_OUT; ++h) {
+            for (int w = 0; w < W_OUT; ++w) {
+                float sum = 0.0f;
+                for (int ph = 0; ph < POOL; ++ph) {
+                    for (int pw = 0; pw < POOL; ++pw) sum += x[(c * H + h * S + ph) * W + w * S + pw];
+                }
+                y[(c * H_OUT + h) * W_OUT + w] = sum * (1.0f / (POOL * POOL));
+            }
+        }
+    }
+}
+
+template<int C, int PLANE>
+inline void global_avgpool(const float* __restrict x, float* __restrict y) {
+    for (int c = 0; c < C; ++c) {
+        float sum = 0.0f;
+        for (int i = 0; i < PLANE; ++i) sum += x[c * PLANE + i];
+        y[c] = sum * (1.0f / PLANE);
+    }
+}
+
+template<int N>
+inline void relu(float* x) {
+    for (int i = 0; i < N; ++i) x[i] = x[i] > 0.0f ? x[i] : 0.0f;
+}
+
+template<int C, int INNER>
+inline void scale_shift(float* x, const float* __restrict scale, const float* __restrict shift) {
+    for (int c = 0; c < C; ++c) {
+        for (int i = 0; i < INNER; ++i) x[c * INNER + i] = x[c * INNER + i] * scale[c] + shift[c];
+    }
+}
+
+template<int N>
+inline void sigmoid(float* x) {
+    for (int i = 0; i < N; ++i) x[i] = 1.0f / (1.0f + exp(-x[i]));
+}
+
+template<int N>
+inline void softmax(const float* __restrict x, float* __restrict y) {
+    float max_val = x[0];
+    for (int i = 1; i < N; ++i) max_val = x[i] > max_val ? x[i] : max_val;
+    float sum_exp = 0.0f;
+    for (int i = 0; i < N; ++i) {
+        float val = exp(x[i] - max_val);
+        y[i] = val;
+        sum_exp += val;
+    }
+    for (int i = 0; i < N; ++i) y[i] /= sum_exp;
+}
+
+} // namespace detail
+)";
+
+// One generated array of weights; hex floats keep every value exact
+static void write_array(std::ostream& out, const std::string& name, const Tensor& t) {
+    out << "alignas(64) inline constexpr float " << name << "[" << t.data.size() << "] = {";
+    char buf[32];
+    for (size_t i = 0; i < t.data.size(); ++i) {
+        if (i % 8 == 0) out << "\n    ";
+        std::snprintf(buf, sizeof(buf), "%a", static_cast<double>(t.data[i]));
+        out << buf << "f,";
+    }
+    out << "\n};\n";
+}
+
+struct Generated {
+    std::ostringstream weights;
+    std::ostringstream body;
+    std::vector<std::string> summary;
+};
+
+int main(int argc, char** argv) {
+    std::string model_path, output_path, input_text, ns = "compiled_model";
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next_value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+        if (arg == "--input") {
+            input_text = next_value();
+        } else if (arg == "--namespace") {
+            ns = next_value();
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 2 || input_text.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    model_path = positional[0];
+    output_path = positional[1];
+
+    try {
+        std::vector<int> sample_shape = parse_shape(input_text);
+        Sequential model;
+        model.load_model(model_path);
+        model.eval();
+        // BatchNorm after Dense or convolution layers costs nothing once folded into their weights
+        const int folded = model.fold_batch_norm();
+        if (folded) std::cout << "Folded " << folded << " BatchNorm layers" << std::endl;
+
+        // One zero sample through the interpreted model gives every layer's
+        // output shape and checks that the input shape fits the model
+        std::vector<int> shape = {1};
+        shape.insert(shape.end(), sample_shape.begin(), sample_shape.end());
+        Tensor current(shape);
+        const int input_size = element_count(shape);
+
+        Generated gen;
+        std::vector<std::string> buffer_names = {"buf0", "buf1"};
+        int buffer_size = 1;
+        std::string cur = "input";      // expression holding the current activation
+        int free_buffer = 0;            // next ping-pong buffer to write
+        auto next_buffer = [&]() {
+            std::string name = buffer_names[free_buffer];
+            free_buffer = 1 - free_buffer;
+            return name;
+        };
+
+        for (size_t i = 0; i < model.layers.size(); ++i) {
+            Layer& layer = *model.layers[i];
+            const std::string type = layer.get_layer_type();
+            const std::string config = layer.get_config_string();
+            const bool is_conv = type == "Conv2DLayer" || type == "FusedConv2DLayer" || type == "GroupedConv2DLayer";
+            if (is_conv && (current.shape.size() != 4 ||
+                           current.shape[1] != std::stoi(Layer::config_value(config, "in_channels")))) {
+                throw std::runtime_error("Layer " + std::to_string(i) + " (" + type + ") expects " +
+                                         Layer::config_value(config, "in_channels") + " input channels");
+            }
+            Tensor next;
+            layer.forward_into(current, next);
+            const std::vector<int>& in = current.shape;
+            const int in_size = element_count(in);
+            const int out_size = element_count(next.shape);
+            buffer_size = std::max(buffer_size, out_size);
+            const std::string id = std::to_string(i);
+
+            if (type == "DenseLayer" || type == "FusedDenseLayer") {
+                auto params = layer.parameters();
+                write_array(gen.weights, "layer" + id + "_w", *params[0]);
+                write_array(gen.weights, "layer" + id + "_b", *params[1]);
+                std::string dst = next_buffer();
+                gen.body << "    detail::dense<" << in_size << ", " << out_size << ">(" << cur << ", weights::layer" << id
+                         << "_w, weights::layer" << id << "_b, " << dst << ");\n";
+                if (type == "FusedDenseLayer") gen.body << "    detail::relu<" << out_size << ">(" << dst << ");\n";
+                cur = dst;
+            } else if (is_conv) {
+                auto params = layer.parameters();
+                write_array(gen.weights, "layer" + id + "_w", *params[0]);
+                write_array(gen.weights, "layer" + id + "_b", *params[1]);
+                const int channels = std::stoi(Layer::config_value(config, "out_channels"));
+                const int k = std::stoi(Layer::config_value(config, "kernel_size"));
+                const int s = std::stoi(Layer::config_value(config, "stride"));
+                const int p = std::stoi(Layer::config_value(config, "padding"));
+                const int h_out = (in[2] + 2 * p - k) / s + 1, w_out = (in[3] + 2 * p - k) / s + 1;
+                buffer_size = std::max(buffer_size, channels * h_out * w_out);
+                std::string dst = next_buffer();
+                if (type == "GroupedConv2DLayer") {
+                    gen.body << "    detail::grouped_conv2d<" << in[1] << ", " << in[2] << ", " << in[3] << ", " << channels << ", "
+                             << k << ", " << s << ", " << p << ", " << Layer::config_value(config, "groups") << ">(" << cur
+                             << ", weights::layer" << id << "_w, weights::layer" << id << "_b, " << dst << ");\n";
+                } else {
+                    gen.body << "    detail::conv2d<" << in[1] << ", " << in[2] << ", " << in[3] << ", " << channels << ", "
+                             << k << ", " << s << ", " << p << ">(" << cur << ", weights::layer" << id << "_w, weights::layer"
+                             << id << "_b, " << dst << ");\n";
+                }
+                cur = dst;
+                if (type == "FusedConv2DLayer") {
+                    gen.body << "    detail::relu<" << channels * h_out * w_out << ">(" << cur << ");\n";
+                    const int pool = std::stoi(Layer::config_value(config, "pool_size"));
+                    if (pool) {
+                        dst = next_buffer();
+                        gen.body << "    detail::maxpool<" << channels << ", " << h_out << ", " << w_out << ", " << pool << ", "
+                                 << Layer::config_value(config, "pool_stride") << ">(" << cur << ", " << dst << ");\n";
+                        cur = dst;
+                    }
+                }
+            } else if (type == "MaxPooling2DLayer") {
+                if (in.size() != 4) throw std::runtime_error("MaxPooling2DLayer needs a C,H,W input");
+                std::string dst = next_buffer();
+                gen.body << "    detail::maxpool<" << in[1] << ", " << in[2] << ", " << in[3] << ", "
+                         << Layer::config_value(config, "pool_size") << ", " << Layer::config_value(config, "stride") << ">("
+                         << cur << ", " << dst << ");\n";
+                cur = dst;
+            } else if (type == "AveragePooling2DLayer") {
+                if (in.size() != 4) throw std::runtime_error("AveragePooling2DLayer needs a C,H,W input");
+                std::string dst = next_buffer();
+                gen.body << "    detail::avgpool<" << in[1] << ", " << in[2] << ", " << in[3] << ", "
+                         << Layer::config_value(config, "pool_size") << ", " << Layer::config_value(config, "stride") << ">("
+                         << cur << ", " << dst << ");\n";
+                cur = dst;
+            } else if (type == "GlobalAveragePoolingLayer") {
+                if (in.size() < 3) throw std::runtime_error("GlobalAveragePoolingLayer needs a C,H,W input");
+                std::string dst = next_buffer();
+                gen.body << "    detail::global_avgpool<" << in[1] << ", " << in_size / in[1] << ">(" << cur << ", " << dst << ");\n";
+                cur = dst;
+            } else if (type == "ReLULayer" || type == "SigmoidLayer") {
+                if (cur == "input") {
+                    std::string dst = next_buffer();
+                    gen.body << "    std::copy(input, input + " << in_size << ", " << dst << ");\n";
+                    cur = dst;
+                }
+                gen.body << "    detail::" << (type == "ReLULayer" ? "relu" : "sigmoid") << "<" << in_size << ">(" << cur << ");\n";
+            } else if (type == "SoftmaxLayer") {
+                if (next.shape.size() != 2) throw std::runtime_error("SoftmaxLayer needs a flat input");
+                std::string dst = next_buffer();
+                gen.body << "    detail::softmax<" << in_size << ">(" << cur << ", " << dst << ");\n";
+                cur = dst;
+            } else if (type == "BatchNormLayer") {
+                // Not preceded by a Dense or convolution layer, so not folded
+                std::vector<float> scale, shift;
+                static_cast<const BatchNormLayer&>(layer).folded_scale_shift(scale, shift);
+                const int channels = static_cast<int>(scale.size());
+                Tensor scale_t({channels}), shift_t({channels});
+                std::copy(scale.begin(), scale.end(), scale_t.data.begin());
+                std::copy(shift.begin(), shift.end(), shift_t.data.begin());
+                write_array(gen.weights, "layer" + id + "_scale", scale_t);
+                write_array(gen.weights, "layer" + id + "_shift", shift_t);
+                if (cur == "input") {
+                    std::string dst = next_buffer();
+                    gen.body << "    std::copy(input, input + " << in_size << ", " << dst << ");\n";
+                    cur = dst;
+                }
+                gen.body << "    detail::scale_shift<" << channels << ", " << in_size / channels << ">(" << cur
+                         << ", weights::layer" << id << "_scale, weights::layer" << id << "_shift);\n";
+            } else if (type == "FlattenLayer" || type == "DropoutLayer") {
+                // Same data, only the shape changes (Dropout is the identity in eval mode)
+            } else {
+                throw std::runtime_error("No generated kernel for " + type);
+            }
+            gen.summary.push_back(type + " [" + join(std::vector<int>(in.begin() + 1, in.end())) + "] -> [" +
+                                  join(std::vector<int>(next.shape.begin() + 1, next.shape.end())) + "]");
+            current = next;
+        }
+        const int output_size = element_count(current.shape);
+
+        std::ofstream out(output_path);
+        if (!out) throw std::runtime_error("Cannot open file for writing: " + output_path);
+        out << "// Generated by edunet_compile from " << model_path << ". Do not edit.\n";
+        for (size_t i = 0; i < gen.summary.size(); ++i) out << "// Layer " << i << ": " << gen.summary[i] << "\n";
+        out << "#pragma once\n#include <cmath>\n#include <limits>\n#include <algorithm>\n\n";
+        out << "namespace " << ns << " {\n\n";
+        out << "inline constexpr int INPUT_SHAPE[] = {" << join(sample_shape) << "};\n";
+        out << "inline constexpr int INPUT_SIZE = " << input_size << ";\n";
+        out << "inline constexpr int OUTPUT_SIZE = " << output_size << ";\n\n";
+        out << KERNELS << "\n";
+        out << "namespace weights {\n" << gen.weights.str() << "} // namespace weights\n\n";
+        out << "// One sample: INPUT_SIZE floats in, OUTPUT_SIZE floats out. The\n"
+            << "// activation buffers are per thread, so concurrent calls are safe.\n";
+        out << "inline void predict(const float* input, float* output) {\n";
+        out << "    alignas(64) static thread_local float buf0[" << buffer_size << "];\n";
+        out << "    alignas(64) static thread_local float buf1[" << buffer_size << "];\n";
+        out << gen.body.str();
+        out << "    std::copy(" << cur << ", " << cur << " + OUTPUT_SIZE, output);\n";
+        out << "}\n\n";
+        out << "// n samples stored back to back\n";
+        out << "inline void predict_batch(const float* input, float* output, int n) {\n";
+        out << "    for (int i = 0; i < n; ++i) predict(input + i * INPUT_SIZE, output + i * OUTPUT_SIZE);\n";
+        out << "}\n\n";
+        out << "} // namespace " << ns << "\n";
+        out.close();
+        if (!out) throw std::runtime_error("Failed to write " + output_path);
+
+        std::cout << "Compiled " << model.layers.size() << " layers (" << input_size << " -> " << output_size
+                  << ") into " << output_path << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "edunet_compile: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
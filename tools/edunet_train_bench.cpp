@@ -0,0 +1,354 @@
+// End-to-end training benchmark: fixed-seed MNIST LeNet training (the model
+// of run_mnist_training) for a number of steps and a fixed-length Snake DQN
+// run (the loop of run_snake_training). Reports samples/s, step latency
+// percentiles, peak RSS and the final loss, and checks them against a
+// baseline written by an earlier --json run.
+// Usage: edunet_train_bench [--json FILE] [--baseline FILE [--threshold PCT]] [options]
+
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Trainer.h"
+#include "DataLoader.h"
+#include "DQNAgent.h"
+#include "snake_app.h"
+#include "snake_env.hpp"
+#include "Parallel.h"
+#include "bench_common.h"
+
+struct TrainBenchOptions {
+    int mnist_steps = 200;
+    int batch_size = 64;
+    int warmup_steps = 5;          // run but left out of the latency statistics
+    long long dqn_env_steps = 500000;
+    unsigned int seed = 42;
+    std::string mnist_path;        // real MNIST instead of the generated digits
+    std::string only;              // "mnist" or "dqn"
+    std::string json_path;
+    std::string baseline_path;
+    double threshold = 10.0;       // allowed slowdown in percent
+    int cpu = -1;
+    bool pin = true;
+};
+
+struct TrainBenchResult {
+    std::string name;
+    long long steps = 0;
+    double seconds = 0.0;
+    double samples_per_s = 0.0;
+    Bench::Stats step_ms;
+    double final_loss = 0.0;
+    long long peak_rss_bytes = 0;
+};
+
+// Digit-like 28x28 images: each class is a few random strokes, every
+// sample a shifted, noisy copy of its class
+static void generate_digits(int count, std::vector<Tensor>& X, std::vector<Tensor>& y) {
+    Random::Stream gen = Random::stream("generate_digits");
+    std::uniform_real_distribution<float> coord(4.0f, 23.0f);
+    std::vector<std::vector<float>> prototypes(10, std::vector<float>(28 * 28, 0.0f));
+    for (auto& image : prototypes) {
+        for (int stroke = 0; stroke < 3; ++stroke) {
+            float x0 = coord(gen), y0 = coord(gen), x1 = coord(gen), y1 = coord(gen);
+            for (int t = 0; t <= 40; ++t) {
+                int cx = static_cast<int>(x0 + (x1 - x0) * t / 40), cy = static_cast<int>(y0 + (y1 - y0) * t / 40);
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        int px = cx + dx, py = cy + dy;
+                        if (px >= 0 && px < 28 && py >= 0 && py < 28) image[py * 28 + px] = 1.0f;
+                    }
+                }
+            }
+        }
+    }
+    std::uniform_int_distribution<int> label(0, 9), shift(-3, 3);
+    std::normal_distribution<float> noise(0.0f, 0.25f);
+    for (int i = 0; i < count; ++i) {
+        int c = label(gen), dx = shift(gen), dy = shift(gen);
+        Tensor image({1, 1, 28, 28});
+        for (int py = 0; py < 28; ++py) {
+            for (int px = 0; px < 28; ++px) {
+                int sx = px - dx, sy = py - dy;
+                float v = (sx >= 0 && sx < 28 && sy >= 0 && sy < 28) ? prototypes[c][sy * 28 + sx] : 0.0f;
+                image.data[py * 28 + px] = std::clamp(v * 0.8f + noise(gen), 0.0f, 1.0f);
+            }
+        }
+        Tensor target({1, 10});
+        target.data[c] = 1.0f;
+        X.push_back(std::move(image));
+        y.push_back(std::move(target));
+    }
+}
+
+static double mean_of_last(const std::vector<float>& values, size_t n) {
+    if (values.empty()) return 0.0;
+    n = std::min(n, values.size());
+    double sum = 0.0;
+    for (size_t i = values.size() - n; i < values.size(); ++i) sum += values[i];
+    return sum / n;
+}
+
+static TrainBenchResult run_mnist(const TrainBenchOptions& options) {
+    std::vector<Tensor> X, y;
+    if (!options.mnist_path.empty()) {
+        X = MNISTDataLoader::load_images(options.mnist_path + "train-images-idx3-ubyte");
+        y = MNISTDataLoader::load_labels(options.mnist_path + "train-labels-idx1-ubyte");
+    } else {
+        generate_digits(std::max(options.batch_size * 100, 6400), X, y);
+    }
+
+    Sequential model;
+    model.add(std::make_unique<Conv2DLayer>(1, 6, 5));
+    model.add(std::make_unique<ReLULayer>());
+    model.add(std::make_unique<MaxPooling2DLayer>(2));
+    model.add(std::make_unique<Conv2DLayer>(6, 16, 5));
+    model.add(std::make_unique<ReLULayer>());
+    model.add(std::make_unique<MaxPooling2DLayer>(2));
+    model.add(std::make_unique<FlattenLayer>());
+    model.add(std::make_unique<DenseLayer>(256, 120));
+    model.add(std::make_unique<ReLULayer>());
+    model.add(std::make_unique<DenseLayer>(120, 84));
+    model.add(std::make_unique<ReLULayer>());
+    model.add(std::make_unique<DenseLayer>(84, 10));
+    model.add(std::make_unique<SoftmaxLayer>());
+    model.fuse();
+    model.train();
+
+    CrossEntropyLoss loss_fn;
+    Trainer trainer(model, std::make_unique<Adam>(0.001f), loss_fn);
+
+    // Shuffled order, reshuffled every pass over the data
+    Random::Stream gen = Random::stream("edunet_train_bench");
+    std::vector<int> order(X.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), gen);
+    size_t next = 0;
+
+    const int batch = options.batch_size;
+    std::vector<int> x_shape = X[0].shape, y_shape = y[0].shape;
+    x_shape[0] = y_shape[0] = batch;
+    Tensor X_batch(x_shape), y_batch(y_shape);
+    const size_t x_size = X[0].data.size(), y_size = y[0].data.size();
+
+    std::vector<double> latencies;
+    std::vector<float> losses;
+    Bench::clock::time_point measured_start;
+    for (int step = 0; step < options.warmup_steps + options.mnist_steps; ++step) {
+        if (step == options.warmup_steps) measured_start = Bench::clock::now();
+        auto start = Bench::clock::now();
+        for (int j = 0; j < batch; ++j) {
+            if (next == order.size()) {
+                std::shuffle(order.begin(), order.end(), gen);
+                next = 0;
+            }
+            int i = order[next++];
+            std::copy(X[i].data.begin(), X[i].data.end(), X_batch.data.begin() + j * x_size);
+            std::copy(y[i].data.begin(), y[i].data.end(), y_batch.data.begin() + j * y_size);
+        }
+        float loss = trainer.train_batch(X_batch, y_batch);
+        if (step >= options.warmup_steps) {
+            latencies.push_back(Bench::elapsed_ns(start) / 1e6);
+            losses.push_back(loss);
+        }
+    }
+
+    TrainBenchResult result;
+    result.name = "mnist_lenet";
+    result.steps = options.mnist_steps;
+    result.seconds = Bench::elapsed_ns(measured_start) / 1e9;
+    result.samples_per_s = result.seconds > 0 ? static_cast<double>(options.mnist_steps) * batch / result.seconds : 0.0;
+    result.step_ms = Bench::summarize(latencies);
+    result.final_loss = mean_of_last(losses, 20);
+    result.peak_rss_bytes = Bench::peak_rss_bytes();
+    return result;
+}
+
+static TrainBenchResult run_dqn(const TrainBenchOptions& options) {
+    const int BATCH_SIZE = 32;
+    const int ACTION_SIZE = 3;
+
+    SnakeConfig config;
+    config.width = 30;
+    config.height = 30;
+    config.initial_length = 5;
+    config.max_steps_without_food = 100;
+    SnakeGame game(config);
+    DQNAgent agent(SnakeGame::STATE_SIZE, ACTION_SIZE);
+
+    std::vector<float> state(SnakeGame::STATE_SIZE), next_state(SnakeGame::STATE_SIZE);
+    std::vector<double> latencies;   // replay (train step) latency
+    std::vector<float> losses;
+    long long env_steps = 0;
+    int episode = 0;
+    auto start = Bench::clock::now();
+    while (env_steps < options.dqn_env_steps) {
+        episode++;
+        game.reset();
+        game.get_state(state.data());
+        for (int time = 0; time < 5000 && env_steps < options.dqn_env_steps; ++time) {
+            int action = agent.act(state.data(), state.size());
+            float reward = step_with_reward(game, action);
+            bool done = game.is_over();
+            game.get_state(next_state.data());
+            agent.remember(state.data(), action, reward, next_state.data(), done);
+            std::swap(state, next_state);
+            env_steps++;
+            if (done) break;
+        }
+        if (!game.is_over()) agent.end_episode();
+
+        auto replay_start = Bench::clock::now();
+        bool trained = agent.train_step(BATCH_SIZE);
+        if (trained) {
+            agent.decay_epsilon();
+            latencies.push_back(Bench::elapsed_ns(replay_start) / 1e6);
+            losses.push_back(agent.get_last_loss());
+        }
+        if (episode % 5 == 0) agent.update_target_model();
+    }
+
+    TrainBenchResult result;
+    result.name = "snake_dqn";
+    result.steps = env_steps;
+    result.seconds = Bench::elapsed_ns(start) / 1e9;
+    result.samples_per_s = result.seconds > 0 ? env_steps / result.seconds : 0.0;
+    result.step_ms = Bench::summarize(latencies);
+    result.final_loss = mean_of_last(losses, 20);
+    result.peak_rss_bytes = Bench::peak_rss_bytes();
+    return result;
+}
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --mnist-steps N    measured LeNet training steps (default 200)\n"
+              << "  --batch N          LeNet batch size (default 64)\n"
+              << "  --warmup N         LeNet steps run before measuring (default 5)\n"
+              << "  --dqn-steps N      Snake environment steps (default 500000)\n"
+              << "  --only NAME        run only mnist or dqn\n"
+              << "  --seed N           seed of data, weights and exploration (default 42)\n"
+              << "  --mnist DIR        train on MNIST from DIR instead of generated digits\n"
+              << "  --json FILE        write the results as JSON\n"
+              << "  --baseline FILE    compare with an earlier --json file, exit 2 on a regression\n"
+              << "  --threshold PCT    allowed slowdown against the baseline (default 10)\n"
+              << "  --cpu N            CPU to pin to (default: first allowed CPU)\n"
+              << "  --no-pin           do not pin the benchmark thread\n"
+              << "  --help             show this message\n";
+}
+
+static TrainBenchOptions parse_options(int argc, char** argv) {
+    TrainBenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "--mnist-steps") options.mnist_steps = std::max(1, std::stoi(value()));
+        else if (arg == "--batch") options.batch_size = std::max(1, std::stoi(value()));
+        else if (arg == "--warmup") options.warmup_steps = std::max(0, std::stoi(value()));
+        else if (arg == "--dqn-steps") options.dqn_env_steps = std::max(1LL, std::stoll(value()));
+        else if (arg == "--only") options.only = value();
+        else if (arg == "--seed") options.seed = static_cast<unsigned int>(std::stoul(value()));
+        else if (arg == "--mnist") options.mnist_path = value();
+        else if (arg == "--json") options.json_path = value();
+        else if (arg == "--baseline") options.baseline_path = value();
+        else if (arg == "--threshold") options.threshold = std::stod(value());
+        else if (arg == "--cpu") options.cpu = std::stoi(value());
+        else if (arg == "--no-pin") options.pin = false;
+        else if (arg == "--help" || arg == "-h") { print_usage(argv[0]); std::exit(0); }
+        else throw std::runtime_error("Unknown option: " + arg);
+    }
+    if (!options.only.empty() && options.only != "mnist" && options.only != "dqn") {
+        throw std::runtime_error("--only takes mnist or dqn");
+    }
+    if (!options.mnist_path.empty() && options.mnist_path.back() != '/') options.mnist_path += '/';
+    return options;
+}
+
+// Prints each metric against the baseline; returns false if throughput or
+// median step latency is worse by more than the threshold
+static bool compare_with_baseline(const std::vector<TrainBenchResult>& results, const TrainBenchOptions& options) {
+    auto throughput = Bench::read_results(options.baseline_path, "samples_per_s");
+    auto p50 = Bench::read_results(options.baseline_path, "step_p50_ms");
+    auto loss = Bench::read_results(options.baseline_path, "final_loss");
+    bool ok = true;
+    std::cout << "\nAgainst " << options.baseline_path << " (threshold " << std::fixed << std::setprecision(1) << options.threshold << "%):" << std::endl;
+    for (const auto& r : results) {
+        if (!throughput.count(r.name)) {
+            std::cout << "  " << r.name << ": not in baseline" << std::endl;
+            continue;
+        }
+        double speed = 100.0 * (r.samples_per_s / throughput[r.name] - 1.0);
+        double latency = p50[r.name] > 0 ? 100.0 * (r.step_ms.median / p50[r.name] - 1.0) : 0.0;
+        bool regressed = speed < -options.threshold || latency > options.threshold;
+        ok &= !regressed;
+        std::cout << "  " << std::left << std::setw(12) << r.name << std::right << std::showpos << std::fixed
+                  << std::setprecision(1) << " samples/s " << speed << "%, step p50 " << latency << "%" << std::noshowpos
+                  << (regressed ? "  REGRESSION" : "  ok") << std::endl;
+        if (loss.count(r.name) && std::abs(loss[r.name] - r.final_loss) > 1e-4 * std::max(1.0, std::abs(loss[r.name]))) {
+            std::cout << "  " << std::setw(12) << "" << " final loss " << std::setprecision(6) << r.final_loss
+                      << " differs from the baseline's " << loss[r.name] << " (numerics changed)" << std::endl;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    try {
+        TrainBenchOptions options = parse_options(argc, argv);
+        Random::seed(options.seed);
+        int pinned_cpu = options.pin ? Bench::pin_to_cpu(options.cpu) : -1;
+        // Workers would inherit the one-CPU mask and only time-slice with us
+        if (pinned_cpu >= 0) Parallel::set_threads(1);
+
+        std::vector<TrainBenchResult> results;
+        // Each run reports its own peak RSS, not the process-wide one
+        if (options.only.empty() || options.only == "mnist") {
+            Bench::reset_peak_rss();
+            results.push_back(run_mnist(options));
+        }
+        if (options.only.empty() || options.only == "dqn") {
+            Bench::reset_peak_rss();
+            results.push_back(run_dqn(options));
+        }
+
+        std::cout << std::left << std::setw(14) << "Run" << std::right << std::setw(10) << "Steps" << std::setw(12) << "Samples/s"
+                  << std::setw(11) << "p50 ms" << std::setw(11) << "p95 ms" << std::setw(11) << "p99 ms"
+                  << std::setw(12) << "Final loss" << std::setw(12) << "Peak RSS" << std::endl;
+        for (const auto& r : results) {
+            std::cout << std::left << std::setw(14) << r.name << std::right << std::setw(10) << r.steps << std::fixed
+                      << std::setprecision(1) << std::setw(12) << r.samples_per_s << std::setprecision(3)
+                      << std::setw(11) << r.step_ms.median << std::setw(11) << r.step_ms.p95
+                      << std::setw(11) << r.step_ms.p99 << std::setprecision(5) << std::setw(12) << r.final_loss
+                      << std::setw(9) << r.peak_rss_bytes / (1 << 20) << " MB" << std::endl;
+        }
+
+        if (!options.json_path.empty()) {
+            std::ofstream json(options.json_path);
+            if (!json) throw std::runtime_error("Cannot open file for writing: " + options.json_path);
+            json << std::setprecision(8);
+            json << "{\n\"context\": " << Bench::context_json(pinned_cpu) << ",\n\"seed\": " << options.seed
+                 << ",\n\"results\": [\n";
+            for (size_t i = 0; i < results.size(); ++i) {
+                const TrainBenchResult& r = results[i];
+                json << "{\"name\": \"" << r.name << "\", \"steps\": " << r.steps << ", \"seconds\": " << r.seconds
+                     << ", \"samples_per_s\": " << r.samples_per_s << ", \"step_p50_ms\": " << r.step_ms.median
+                     << ", \"step_p95_ms\": " << r.step_ms.p95 << ", \"step_p99_ms\": " << r.step_ms.p99
+                     << ", \"step_max_ms\": " << r.step_ms.max << ", \"final_loss\": " << r.final_loss
+                     << ", \"peak_rss_bytes\": " << r.peak_rss_bytes << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+            }
+            json << "]\n}\n";
+            std::cout << "Results written to " << options.json_path << std::endl;
+        }
+
+        if (!options.baseline_path.empty() && !compare_with_baseline(results, options)) return 2;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}